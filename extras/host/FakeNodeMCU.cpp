@@ -0,0 +1,1003 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#include "FakeNodeMCU.h"
+#include "HostClock.h"
+#include <algorithm>
+
+// What the NodeMCU writes when it (re)starts, ending with the Lua prompt
+#define BOOT_BANNER "\r\nNodeMCU 0.9.6 build 20150704  powered by Lua 5.1.4\r\nlua: cannot open init.lua\r\n> "
+
+// The prompt written after each line is executed
+#define PROMPT "> "
+
+// The helper's version, as defined by its first line and checked when it is loaded
+#define HELPER_VERSION_DEFINITION "wb={v="
+#define HELPER_VERSION_CHECK "wb.v=="
+
+// The prefixes of the send buffer commands, see Sodaq_WifiBee.cpp
+#define UPLOAD_PREFIX "sb=sb..\""
+#define UPLOAD_START "sb=\""
+#define UPLOAD_CLEAR "sb=\"\""
+
+// The station and access point reported by wb.q()
+#define NETWORK_REPORT "|NET|10.0.0.5|255.255.255.0|10.0.0.1|0a:bb:cc:dd:ee:ff|\r\n"
+
+// The station status while joining, and once the network has been joined
+#define STATUS_CONNECTING 1
+#define STATUS_GOT_IP 5
+
+// The time the host waits when it polls while nothing is received
+#define IDLE_POLL_US 20
+
+FakeNodeMCU::FakeNodeMCU()
+{
+  response = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+  bootBaudRate = 57600;
+  hostMaxBaudRate = 230400;
+  bootLatencyMS = 300;
+  lineLatencyMS = 0;
+  joinLatencyMS = 0;
+  connectLatencyMS = 0;
+  sendLatencyMS = 0;
+  serverLatencyMS = 0;
+  packetSize = 1460;
+  receiveQueueMax = 4096;
+  receiveQueueHold = 0;
+  inputBufferSize = 256;
+  failConnects = 0;
+  failFastJoin = false;
+
+  _powered = false;
+  _hostBaudRate = bootBaudRate;
+  _actionUS = 0;
+  _installing = false;
+
+  clearCounters();
+  restart();
+}
+
+void FakeNodeMCU::begin(unsigned long baudRate)
+{
+  _hostBaudRate = baudRate;
+}
+
+void FakeNodeMCU::end()
+{
+}
+
+size_t FakeNodeMCU::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+/*!
+* Each byte takes the time to transmit it at the host's baud rate.
+* The NodeMCU only receives it if it is on and awake, garbled unless
+* both ends run at the same rate.
+*/
+size_t FakeNodeMCU::write(const uint8_t* buffer, size_t size)
+{
+  writeCalls++;
+
+  for (size_t i = 0; i < size; i++) {
+    bytesFromHost++;
+    HostClock::advance(byteTime());
+    release();
+
+    if ((_powered) && (!_asleep) && (HostClock::now() >= _bootedUS)) {
+      if (garbled()) {
+        _lineLost = true;
+        receiveByte(0xFF);
+      }
+      else {
+        receiveByte(buffer[i]);
+      }
+    }
+  }
+
+  return size;
+}
+
+int FakeNodeMCU::available()
+{
+  release();
+
+  if ((!_powered) || (_asleep)) {
+    return 0;
+  }
+
+  size_t count = arrived();
+  if (count == 0) {
+    HostClock::advance(IDLE_POLL_US);
+  }
+
+  return count;
+}
+
+/*!
+* Reads a byte from the host's receive buffer, once it has arrived.
+*/
+int FakeNodeMCU::read()
+{
+  release();
+
+  if ((!_powered) || (_asleep) || (arrived() == 0)) {
+    HostClock::advance(IDLE_POLL_US);
+    return -1;
+  }
+
+  bytesToHost++;
+
+  uint8_t c = _output.front().second;
+  _output.pop_front();
+
+  return garbled() ? (c ^ 0x5A) : c;
+}
+
+int FakeNodeMCU::peek()
+{
+  release();
+
+  if ((!_powered) || (_asleep) || (arrived() == 0)) {
+    return -1;
+  }
+
+  uint8_t c = _output.front().second;
+
+  return garbled() ? (c ^ 0x5A) : c;
+}
+
+void FakeNodeMCU::flush()
+{
+}
+
+/*!
+* It boots at its boot rate, with its echo on, and writes the Lua prompt
+* after `bootLatencyMS`.
+*/
+void FakeNodeMCU::powerOn()
+{
+  if (_powered) {
+    return;
+  }
+
+  _powered = true;
+  restart();
+}
+
+void FakeNodeMCU::powerOff()
+{
+  _powered = false;
+  restart();
+}
+
+/*!
+* The server closes a connection.
+*/
+void FakeNodeMCU::disconnect(const uint8_t handle)
+{
+  Connection& connection = _connections[handle];
+
+  if (connection.open) {
+    connection.open = false;
+    emit(tag("DC", handle));
+  }
+}
+
+/*!
+* The access point is lost, which also closes the connections.
+*/
+void FakeNodeMCU::dropNetwork()
+{
+  _status = 0;
+  _ssid.clear();
+
+  for (uint8_t handle = 0; handle < FAKE_NODEMCU_HANDLES; handle++) {
+    disconnect(handle);
+  }
+}
+
+/*!
+* Writes text to the host as if the NodeMCU had written it, e.g. an
+* unexpected event.
+*/
+void FakeNodeMCU::inject(const std::string& text)
+{
+  emit(text);
+}
+
+void FakeNodeMCU::clearCounters()
+{
+  bytesFromHost = 0;
+  bytesToHost = 0;
+  writeCalls = 0;
+  lines = 0;
+  unknownLines = 0;
+  controlBytes = 0;
+  joins = 0;
+  fastJoins = 0;
+  installs = 0;
+  connects = 0;
+  readBacks = 0;
+  maxReadBack = 0;
+  maxInputPending = 0;
+  inputOverflows = 0;
+  sleepCommands = 0;
+  payloads = 0;
+  sent.clear();
+  lastPayload.clear();
+  lastHost.clear();
+  lastJoin.clear();
+}
+
+/*!
+* Decodes the contents of a Lua string literal.
+*/
+std::string FakeNodeMCU::luaUnescape(const std::string& text)
+{
+  std::string result;
+
+  for (size_t i = 0; i < text.size(); i++) {
+    char c = text[i];
+
+    if ((c != '\\') || (i + 1 >= text.size())) {
+      result += c;
+      continue;
+    }
+
+    c = text[++i];
+
+    if ((c >= '0') && (c <= '9')) {
+      // Up to three decimal digits
+      int value = 0;
+      for (uint8_t digits = 0; (digits < 3) && (i < text.size()) && (text[i] >= '0') && (text[i] <= '9'); digits++) {
+        value = value * 10 + (text[i++] - '0');
+      }
+      i--;
+      result += (char)value;
+      continue;
+    }
+
+    switch (c) {
+    case 'n':
+      result += '\n';
+      break;
+    case 'r':
+      result += '\r';
+      break;
+    case 'a':
+      result += '\a';
+      break;
+    case 'b':
+      result += '\b';
+      break;
+    case 'f':
+      result += '\f';
+      break;
+    case 't':
+      result += '\t';
+      break;
+    case 'v':
+      result += '\v';
+      break;
+    default:
+      result += c;
+      break;
+    }
+  }
+
+  return result;
+}
+
+bool FakeNodeMCU::garbled()
+{
+  return (_hostBaudRate != _baudRate) || (_hostBaudRate > hostMaxBaudRate);
+}
+
+/*!
+* The time to transmit a byte, with its start and stop bits.
+*/
+uint64_t FakeNodeMCU::byteTime()
+{
+  return 10000000ULL / _hostBaudRate;
+}
+
+/*!
+* The number of output bytes which have arrived at the host.
+*/
+size_t FakeNodeMCU::arrived()
+{
+  size_t count = 0;
+
+  while ((count < _output.size()) && (_output[count].first <= HostClock::now())) {
+    count++;
+  }
+
+  return count;
+}
+
+/*!
+* Writes text to the host. Each byte is transmitted after the output
+* before it.
+*/
+void FakeNodeMCU::emit(const std::string& text)
+{
+  if (!_powered) {
+    return;
+  }
+
+  for (size_t i = 0; i < text.size(); i++) {
+    _transmittedUS = std::max(_transmittedUS, now()) + byteTime();
+    _output.push_back(std::make_pair(_transmittedUS, (uint8_t)text[i]));
+  }
+}
+
+/*!
+* Schedules an action, which is run once the HostClock reaches `timeUS`.
+* Actions due at the same time run in the order they were scheduled.
+*/
+void FakeNodeMCU::at(const uint64_t timeUS, std::function<void()> action)
+{
+  _timed.insert(std::make_pair(timeUS, action));
+}
+
+/*!
+* Runs the actions which are due. Each one runs at its own time, even if
+* the host only looks later, e.g. after a delay().
+*/
+void FakeNodeMCU::release()
+{
+  uint64_t outerUS = _actionUS;
+
+  while ((!_timed.empty()) && (_timed.begin()->first <= HostClock::now())) {
+    std::function<void()> action = _timed.begin()->second;
+    _actionUS = _timed.begin()->first;
+    _timed.erase(_timed.begin());
+    action();
+  }
+
+  _actionUS = outerUS;
+}
+
+/*!
+* The emulated time, that of the action running if any.
+*/
+uint64_t FakeNodeMCU::now()
+{
+  return (_actionUS > 0) ? _actionUS : HostClock::now();
+}
+
+/*!
+* Forgets everything but the file system, as after a reset.
+* If it is powered, it boots again.
+*/
+void FakeNodeMCU::restart()
+{
+  _output.clear();
+  _transmittedUS = 0;
+  _timed.clear();
+
+  _bootedUS = now() + (uint64_t)bootLatencyMS * 1000;
+  _executedUS = 0;
+  _inputPending = 0;
+  _line.clear();
+  _lineEchoed = 0;
+  _lineLost = false;
+  _sendBuffer.clear();
+
+  for (uint8_t handle = 0; handle < FAKE_NODEMCU_HANDLES; handle++) {
+    _connections[handle] = Connection();
+  }
+
+  _asleep = false;
+  _echo = true;
+  _baudRate = bootBaudRate;
+  _status = 0;
+  _events = false;
+  _ssid.clear();
+  _installing = false;
+  _helperLoaded = false;
+
+  if (_powered) {
+    at(_bootedUS, [this]() { emit(BOOT_BANNER); });
+  }
+}
+
+/*!
+* Receives a byte from the host. While a line executes the input is
+* buffered, up to `inputBufferSize`, and the echo is delayed until
+* the REPL reads it.
+*/
+void FakeNodeMCU::receiveByte(const uint8_t c)
+{
+  if (now() < _executedUS) {
+    _inputPending++;
+    maxInputPending = std::max(maxInputPending, _inputPending);
+
+    if (_inputPending > inputBufferSize) {
+      _inputPending--;
+      if (!_lineLost) {
+        inputOverflows++;
+      }
+      _lineLost = true;
+      return;
+    }
+  }
+  else if ((_echo) && (_lineEchoed == _line.size())) {
+    emit(std::string(1, (char)c));
+    _lineEchoed++;
+  }
+
+  _line += (char)c;
+
+  if (c == '\n') {
+    lineReceived();
+  }
+}
+
+/*!
+* Queues a line for execution, after the lines before it.
+*/
+void FakeNodeMCU::lineReceived()
+{
+  std::string raw = _line;
+  size_t echoed = _lineEchoed;
+  bool lost = _lineLost;
+
+  _line.clear();
+  _lineEchoed = 0;
+  _lineLost = false;
+
+  std::string line = raw;
+  while ((!line.empty()) && ((line[line.size() - 1] == '\n') || (line[line.size() - 1] == '\r'))) {
+    line.erase(line.size() - 1);
+  }
+
+  uint64_t startUS = std::max(now(), _executedUS);
+  _executedUS = startUS + (uint64_t)lineLatencyMS * 1000;
+
+  at(startUS, [this, raw, echoed]() {
+    // The REPL reads the line from the input buffer
+    _inputPending -= std::min(_inputPending, raw.size() - echoed);
+    if (_echo) {
+      emit(raw.substr(echoed));
+    }
+  });
+
+  at(_executedUS, [this, line, lost]() {
+    execute(line, lost);
+
+    // Once idle, the REPL reads (and echoes) the next line as it arrives
+    if (now() >= _executedUS) {
+      _inputPending = 0;
+      if (_echo) {
+        emit(_line.substr(_lineEchoed));
+      }
+      _lineEchoed = _line.size();
+    }
+  });
+
+  release();
+}
+
+/*!
+* Executes a line, writing its output and the prompt.
+* Only the commands the library sends are known.
+*/
+void FakeNodeMCU::execute(const std::string& line, const bool lost)
+{
+  lines++;
+
+  for (size_t i = 0; i < line.size(); i++) {
+    if (((uint8_t)line[i] < 0x20) || ((uint8_t)line[i] == 0x7F)) {
+      controlBytes++;
+    }
+  }
+
+  bool known = !lost;
+
+  if ((!known) || (line.empty())) {
+    // Nothing to execute
+  }
+  else if (line.compare(0, 10, "file.open(") == 0) {
+    _installing = true;
+    _helperFile.clear();
+  }
+  else if ((line.compare(0, 19, "file.writeline([==[") == 0) && (line.size() >= 24)) {
+    if (_installing) {
+      _helperFile += line.substr(19, line.size() - 24) + "\n";
+    }
+  }
+  else if (line == "file.close()") {
+    if (_installing) {
+      _installing = false;
+      installs++;
+
+      size_t start = _helperFile.find(HELPER_VERSION_DEFINITION);
+      _helperVersion = (start != std::string::npos) ?
+        _helperFile.substr(start + 6, _helperFile.find('}', start) - start - 6) : "";
+    }
+  }
+  else if ((line.compare(0, 6, "if not") == 0) && (line.find(HELPER_VERSION_CHECK) != std::string::npos)) {
+    size_t start = line.find(HELPER_VERSION_CHECK) + 6;
+    std::string version = line.substr(start, line.find(')', start) - start);
+
+    _helperLoaded = (!_helperVersion.empty()) && (_helperVersion == version);
+    emit(_helperLoaded ? "|WB|\r\n" : "|NWB|\r\n");
+  }
+  else if (line.compare(0, 13, "uart.setup(0,") == 0) {
+    std::vector<std::string> args = splitArgs(line, 10);
+
+    known = (args.size() == 6);
+    if (known) {
+      _baudRate = strtoul(args[1].c_str(), NULL, 10);
+      _echo = (args[5] == "1");
+    }
+  }
+  else if (line.find("string.rep(\"U\", ") != std::string::npos) {
+    size_t count = strtoul(line.c_str() + line.find("string.rep(\"U\", ") + 16, NULL, 10);
+    emit("|SOF|" + std::string(count, 'U') + "|EOF|");
+  }
+  else if (line == "uart.write(0, \"OK\\r\\n\")") {
+    emit("OK\r\n");
+  }
+  else if (line == "wifi.setsleeptype(wifi.NONE_SLEEP) uart.write(0, \"OK\\r\\n\")") {
+    emit("OK\r\n");
+  }
+  else if (line == "wifi.setsleeptype(wifi.MODEM_SLEEP)") {
+    sleepCommands++;
+  }
+  else if (line.compare(0, 12, "node.dsleep(") == 0) {
+    uint64_t sleepUS = strtoull(line.c_str() + 12, NULL, 10);
+
+    _asleep = true;
+    _timed.clear();
+
+    // It restarts without RF calibration, and the station reconnects
+    // to the network it was joined to by itself
+    if (sleepUS > 0) {
+      std::string ssid = _ssid;
+      at(now() + sleepUS, [this, ssid]() {
+        restart();
+        if (!ssid.empty()) {
+          _ssid = ssid;
+          connectStation(false);
+        }
+      });
+    }
+    return;
+  }
+  else if (line == "wifi.sta.disconnect()") {
+    _status = 0;
+    _ssid.clear();
+  }
+  else if (line.compare(0, 3, "wb.") == 0) {
+    if (!_helperLoaded) {
+      unknownLines++;
+      emit("stdin:1: attempt to index global 'wb' (a nil value)\r\n" PROMPT);
+      return;
+    }
+
+    if (line.compare(0, 5, "wb.j(") == 0) {
+      lastJoin = line;
+      join(splitArgs(line, 4));
+    }
+    else if (line == "wb.t()") {
+      emit("|STS|" + std::to_string(_status) + "|\r\n");
+    }
+    else if (line == "wb.e()") {
+      _events = false;
+    }
+    else if (line == "wb.q()") {
+      emit(NETWORK_REPORT);
+    }
+    else {
+      known = connectionCommand(line);
+    }
+  }
+  else if (line == UPLOAD_CLEAR) {
+    _sendBuffer.clear();
+  }
+  else if ((line.compare(0, 8, UPLOAD_PREFIX) == 0) && (line[line.size() - 1] == '"') && (line.size() >= 9)) {
+    _sendBuffer += luaUnescape(line.substr(8, line.size() - 9));
+  }
+  else if ((line.compare(0, 4, UPLOAD_START) == 0) && (line[line.size() - 1] == '"') && (line.size() >= 5)) {
+    _sendBuffer = luaUnescape(line.substr(4, line.size() - 5));
+  }
+  else {
+    known = false;
+  }
+
+  if (!known) {
+    unknownLines++;
+    emit("stdin:1: unexpected symbol\r\n");
+  }
+
+  emit(PROMPT);
+}
+
+/*!
+* Executes a connection command of the helper, its events follow the prompt.
+* @return `true` if the command is known.
+*/
+bool FakeNodeMCU::connectionCommand(const std::string& line)
+{
+  std::vector<std::string> args = splitArgs(line, 4);
+  uint64_t nowUS = now();
+
+  if (line.compare(0, 5, "wb.o(") == 0) {
+    if (args.size() < 3) {
+      return false;
+    }
+
+    uint8_t handle = (args.size() > 3) ? atoi(args[3].c_str()) : 0;
+    if (handle >= FAKE_NODEMCU_HANDLES) {
+      return false;
+    }
+
+    _connections[handle] = Connection();
+
+    connects++;
+    lastHost = args[2];
+
+    // Without an IP address the connection fails as well
+    bool fail = (failConnects > 0) || (_status != STATUS_GOT_IP);
+    if (failConnects > 0) {
+      failConnects--;
+    }
+
+    at(nowUS + (uint64_t)connectLatencyMS * 1000, [this, handle, fail]() {
+      _connections[handle].open = !fail;
+      emit(tag(fail ? "DC" : "C", handle));
+    });
+
+    return true;
+  }
+
+  uint8_t handle = ((args.size() > 0) && (!args[0].empty())) ? atoi(args[0].c_str()) : 0;
+  size_t limit = (args.size() > 1) ? strtoul(args[1].c_str(), NULL, 10) : 0;
+
+  if (handle >= FAKE_NODEMCU_HANDLES) {
+    return false;
+  }
+
+  Connection& connection = _connections[handle];
+
+  if (line.compare(0, 5, "wb.s(") == 0) {
+    if (connection.open) {
+      sendPayload(handle, _sendBuffer);
+    }
+    _sendBuffer.clear();
+  }
+  else if (line.compare(0, 5, "wb.a(") == 0) {
+    if (connection.open) {
+      connection.sendQueue.push_back(_sendBuffer);
+      if (!connection.sending) {
+        sendNext(handle);
+      }
+    }
+    _sendBuffer.clear();
+  }
+  else if (line.compare(0, 5, "wb.r(") == 0) {
+    readBack(handle, limit, false);
+  }
+  else if (line.compare(0, 5, "wb.x(") == 0) {
+    readBack(handle, limit, true);
+  }
+  else if (line.compare(0, 5, "wb.c(") == 0) {
+    if (connection.open) {
+      connection.open = false;
+      at(nowUS, [this, handle]() { emit(tag("DC", handle)); });
+    }
+  }
+  else {
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+* Joins the network, as wb.j() does, unless it is still joined to it or
+* joining it.
+*/
+void FakeNodeMCU::join(const std::vector<std::string>& args)
+{
+  if (args.size() < 2) {
+    return;
+  }
+
+  const std::string& ssid = args[0];
+  bool events = (args.size() > 2) && (args[2] == "1");
+  bool fast = (args.size() > 3);
+
+  // A station joining the network already is left to it
+  if (((_status == STATUS_GOT_IP) || (_status == STATUS_CONNECTING)) && (_ssid == ssid)) {
+    if (events) {
+      _events = (_status == STATUS_CONNECTING);
+      emit("|STS|" + std::to_string(_status) + "|\r\n");
+    }
+    return;
+  }
+
+  joins++;
+  if (fast) {
+    fastJoins++;
+  }
+
+  _ssid = ssid;
+  _events = events;
+
+  connectStation(fast);
+
+  if (events) {
+    emit("|STS|" + std::to_string(_status) + "|\r\n");
+  }
+}
+
+/*!
+* Connects the station to `_ssid`, it gets its IP address once
+* `joinLatencyMS` has passed. A fast join fails if `failFastJoin` is set.
+*/
+void FakeNodeMCU::connectStation(const bool fast)
+{
+  if ((fast) && (failFastJoin)) {
+    _status = STATUS_CONNECTING;
+  }
+  else if (joinLatencyMS == 0) {
+    _status = STATUS_GOT_IP;
+  }
+  else {
+    _status = STATUS_CONNECTING;
+    at(now() + (uint64_t)joinLatencyMS * 1000, [this]() {
+      if (_status == STATUS_CONNECTING) {
+        _status = STATUS_GOT_IP;
+        if (_events) {
+          emit("|STS|5|\r\n");
+        }
+      }
+    });
+  }
+}
+
+/*!
+* Sends a payload, once the payload being sent has been sent.
+*/
+void FakeNodeMCU::sendPayload(const uint8_t handle, const std::string& payload)
+{
+  Connection& connection = _connections[handle];
+
+  payloads++;
+  sent += payload;
+  lastPayload = payload;
+
+  connection.sending = true;
+  connection.sentUS = std::max(now(), connection.sentUS) + (uint64_t)sendLatencyMS * 1000;
+
+  at(connection.sentUS, [this, handle, payload]() { payloadSent(handle, payload); });
+}
+
+/*!
+* Sends the next payload queued with wb.a(), if any.
+*/
+void FakeNodeMCU::sendNext(const uint8_t handle)
+{
+  Connection& connection = _connections[handle];
+
+  if (connection.sendQueue.empty()) {
+    connection.sending = false;
+    return;
+  }
+
+  std::string payload = connection.sendQueue.front();
+  connection.sendQueue.pop_front();
+
+  sendPayload(handle, payload);
+}
+
+/*!
+* Reports a payload as sent, passes it to the server and schedules the
+* server's answer.
+*/
+void FakeNodeMCU::payloadSent(const uint8_t handle, const std::string& payload)
+{
+  if (!_connections[handle].open) {
+    return;
+  }
+
+  emit(tag("DS", handle));
+
+  std::string answer;
+  if (server) {
+    answer = server(handle, payload);
+  }
+  else if (responses.count(handle) > 0) {
+    answer = responses[handle];
+  }
+  else {
+    answer = response;
+  }
+
+  if (!answer.empty()) {
+    at(now() + (uint64_t)serverLatencyMS * 1000, [this, handle, answer]() { deliver(handle, answer); });
+  }
+
+  sendNext(handle);
+}
+
+/*!
+* Receives data from the server, in packets of at most `packetSize`.
+*/
+void FakeNodeMCU::deliver(const uint8_t handle, const std::string& data)
+{
+  for (size_t start = 0; start < data.size(); start += packetSize) {
+    receivePacket(handle, data.substr(start, packetSize));
+  }
+}
+
+/*!
+* Receives a packet as the helper's receive callback does: it is queued,
+* or dropped if the queue is full, and reported. While the connection is
+* held the packets wait.
+*/
+void FakeNodeMCU::receivePacket(const uint8_t handle, const std::string& packet)
+{
+  Connection& connection = _connections[handle];
+
+  if (!connection.open) {
+    return;
+  }
+
+  if (connection.held) {
+    connection.heldPackets.push_back(packet);
+    return;
+  }
+
+  if (connection.queue.size() + packet.size() <= receiveQueueMax) {
+    connection.queue += packet;
+  }
+  else {
+    connection.dropped += packet.size();
+  }
+
+  if ((receiveQueueHold > 0) && (connection.queue.size() >= receiveQueueHold)) {
+    connection.held = true;
+  }
+
+  emit(std::to_string(packet.size()) + tag("DR", handle));
+}
+
+/*!
+* Unholds a connection, the packets which waited are received.
+*/
+void FakeNodeMCU::releaseHeld(const uint8_t handle)
+{
+  Connection& connection = _connections[handle];
+
+  connection.held = false;
+
+  while ((!connection.held) && (!connection.heldPackets.empty())) {
+    std::string packet = connection.heldPackets.front();
+    connection.heldPackets.pop_front();
+    receivePacket(handle, packet);
+  }
+}
+
+/*!
+* Writes the received data as wb.r() or wb.x() does, at most `limit`
+* bytes if it isn't 0. The rest stays queued.
+*/
+void FakeNodeMCU::readBack(const uint8_t handle, const size_t limit, const bool hex)
+{
+  Connection& connection = _connections[handle];
+
+  std::string data = connection.queue;
+  connection.queue.clear();
+
+  if ((limit > 0) && (data.size() > limit)) {
+    connection.queue = data.substr(limit);
+    data.resize(limit);
+  }
+
+  std::string text = "|SOF|" + std::to_string(connection.dropped) + "|";
+  connection.dropped = 0;
+
+  if (hex) {
+    char digits[3];
+    for (size_t i = 0; i < data.size(); i++) {
+      snprintf(digits, sizeof(digits), "%02X", (uint8_t)data[i]);
+      text += digits;
+    }
+  }
+  else {
+    text += std::to_string(data.size()) + "|" + data;
+  }
+  text += "|EOF|";
+
+  readBacks++;
+  maxReadBack = std::max(maxReadBack, text.size());
+  emit(text);
+
+  if ((connection.held) && (connection.queue.size() < receiveQueueHold)) {
+    at(now(), [this, handle]() { releaseHeld(handle); });
+  }
+}
+
+/*!
+* Returns an event as the helper prints it, e.g. "|DS2|".
+*/
+std::string FakeNodeMCU::tag(const char* event, const uint8_t handle)
+{
+  return std::string("|") + event + ((handle > 0) ? std::to_string(handle) : "") + "|\r\n";
+}
+
+/*!
+* Splits the arguments of a Lua call, from `start` (its opening
+* parenthesis) up to the closing one. The quotes of string arguments are
+* removed and their escapes decoded.
+*/
+std::vector<std::string> FakeNodeMCU::splitArgs(const std::string& line, const size_t start)
+{
+  std::vector<std::string> args;
+  std::string arg;
+  bool quoted = false;
+  bool given = false;
+
+  for (size_t i = start + 1; i < line.size(); i++) {
+    char c = line[i];
+
+    if (quoted) {
+      if ((c == '\\') && (i + 1 < line.size())) {
+        arg += c;
+        arg += line[++i];
+      }
+      else if (c == '"') {
+        quoted = false;
+        arg = luaUnescape(arg);
+      }
+      else {
+        arg += c;
+      }
+    }
+    else if (c == '"') {
+      quoted = true;
+      given = true;
+    }
+    else if (c == ',') {
+      args.push_back(arg);
+      arg.clear();
+      given = false;
+    }
+    else if (c == ')') {
+      // An empty argument list has no arguments
+      if ((given) || (!args.empty())) {
+        args.push_back(arg);
+      }
+      break;
+    }
+    else if (c != ' ') {
+      arg += c;
+      given = true;
+    }
+  }
+
+  return args;
+}
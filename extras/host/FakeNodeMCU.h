@@ -0,0 +1,218 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FAKE_NODEMCU_H_
+#define FAKE_NODEMCU_H_
+
+#include <Arduino.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "Sodaq_OnOffBee.h"
+
+/*!
+ * \def FAKE_NODEMCU_HANDLES
+ *
+ * The number of connection handles the emulator keeps, as the helper's
+ * tables allow any handle.
+ */
+#define FAKE_NODEMCU_HANDLES             8
+
+/*!
+ * \brief The server a FakeNodeMCU connection talks to.
+ *
+ * It is called with each payload sent, and returns the data to send
+ * back, if any. The default is the HTTP stand-in, which answers every
+ * payload with FakeNodeMCU::response.
+ */
+typedef std::function<std::string(uint8_t handle, const std::string& payload)> FakeServer;
+
+/*!
+ * \brief This class emulates a WifiBee running the NodeMCU firmware.
+ *
+ * It is the serial stream passed to Sodaq_WifiBee::init(). The lines
+ * written to it are interpreted as the Lua commands the library sends,
+ * including the wifibee.lua helper calls, and answered as the NodeMCU
+ * REPL would: the echo, the output, the prompt and the connection events.
+ * The network side is scripted, a FakeServer answers each payload sent.
+ *
+ * The UART is full duplex and runs at the emulated baud rate. Each byte
+ * written advances the HostClock, the output arrives at the host one byte
+ * time after another, as the host writes. Latencies can be set for the Lua execution of
+ * each line, the join, the server connection, and each payload sent.
+ * It counts what went over the UART, so tests can check the behaviour and
+ * benchmarks can report the bytes on the wire.
+ */
+class FakeNodeMCU : public HardwareSerial
+{
+public:
+  FakeNodeMCU();
+
+  // HardwareSerial implementations
+  void begin(unsigned long baudRate);
+  void end();
+  size_t write(uint8_t c);
+  size_t write(const uint8_t* buffer, size_t size);
+  int available();
+  int read();
+  int peek();
+  void flush();
+  using Print::write;
+
+  void powerOn();
+  void powerOff();
+  bool isPowered() { return _powered; }
+
+  void disconnect(const uint8_t handle);
+  void dropNetwork();
+  void inject(const std::string& text);
+
+  bool isOpen(const uint8_t handle) { return _connections[handle].open; }
+  size_t getQueued(const uint8_t handle) { return _connections[handle].queue.size(); }
+
+  // The scripted behaviour
+  std::string response;  /*!< The HTTP stand-in's answer to each payload. */
+  std::map<uint8_t, std::string> responses;  /*!< Answers by handle, instead of `response`. */
+  FakeServer server;  /*!< The server, the HTTP stand-in unless set. */
+  uint32_t bootBaudRate;  /*!< The rate the UART starts at. */
+  uint32_t hostMaxBaudRate;  /*!< Above this rate the host receives garbage. */
+  uint32_t bootLatencyMS;  /*!< The time from power on to the prompt. */
+  uint32_t lineLatencyMS;  /*!< The Lua execution time of each line. */
+  uint32_t joinLatencyMS;  /*!< The time a join takes. */
+  uint32_t connectLatencyMS;  /*!< The time to connect to a server. */
+  uint32_t sendLatencyMS;  /*!< The time to send each payload. */
+  uint32_t serverLatencyMS;  /*!< The time from a payload sent to the answer. */
+  size_t packetSize;  /*!< The size of the packets the answer arrives in. */
+  size_t receiveQueueMax;  /*!< The helper's RECEIVE_QUEUE_MAX. */
+  size_t receiveQueueHold;  /*!< The helper's RECEIVE_QUEUE_HOLD, 0 for firmware without hold(). */
+  size_t inputBufferSize;  /*!< The UART input buffered while a line executes. */
+  uint8_t failConnects;  /*!< The number of server connections which fail next. */
+  bool failFastJoin;  /*!< Set to let fast joins fail. */
+
+  // What happened, reset with clearCounters()
+  size_t bytesFromHost;  /*!< The bytes written by the host. */
+  size_t bytesToHost;  /*!< The bytes read by the host. */
+  size_t writeCalls;  /*!< The calls of write() by the host. */
+  size_t lines;  /*!< The Lua lines executed. */
+  size_t unknownLines;  /*!< The lines which are not a known command. */
+  size_t controlBytes;  /*!< The control characters in the lines, which the REPL mangles. */
+  size_t joins;  /*!< The joins started. */
+  size_t fastJoins;  /*!< The joins with a cached access point. */
+  size_t installs;  /*!< The times the helper was installed. */
+  size_t connects;  /*!< The server connections opened. */
+  size_t readBacks;  /*!< The read backs of received data. */
+  size_t maxReadBack;  /*!< The most bytes written by one read back, with its framing. */
+  size_t maxInputPending;  /*!< The most input buffered while executing a line. */
+  size_t inputOverflows;  /*!< The lines lost as the input buffer overflowed. */
+  size_t sleepCommands;  /*!< The modem sleep commands. */
+  size_t payloads;  /*!< The payloads sent to the server. */
+  std::string sent;  /*!< All the payloads sent to the server. */
+  std::string lastPayload;  /*!< The last payload sent. */
+  std::string lastHost;  /*!< The host of the last connection opened. */
+  std::string lastJoin;  /*!< The last join command. */
+
+  void clearCounters();
+
+  static std::string luaUnescape(const std::string& text);
+
+private:
+  struct Connection {
+    bool open;  /*!< Set while it is connected. */
+    std::string queue;  /*!< The received data, until it is read back. */
+    size_t dropped;  /*!< The bytes dropped since the last read back. */
+    bool held;  /*!< Set while the socket is held. */
+    std::deque<std::string> heldPackets;  /*!< The packets waiting while it is held. */
+    std::deque<std::string> sendQueue;  /*!< The payloads queued with wb.a(). */
+    bool sending;  /*!< Set while a payload is being sent. */
+    uint64_t sentUS;  /*!< When the payload being sent has been sent. */
+  };
+
+  std::deque<std::pair<uint64_t, uint8_t> > _output;  /*!< The output not yet read by the host, with the time each byte arrives. */
+  uint64_t _transmittedUS;  /*!< When the output emitted so far has been transmitted. */
+  std::multimap<uint64_t, std::function<void()> > _timed;  /*!< The output and events to come, by time. */
+  uint64_t _actionUS;  /*!< The time of the action running, 0 if none. */
+  uint64_t _bootedUS;  /*!< When it is ready for input after a restart. */
+  uint64_t _executedUS;  /*!< When the last line received has executed. */
+  size_t _inputPending;  /*!< The input received which is not yet executing. */
+  std::string _line;  /*!< The line being received, as received. */
+  size_t _lineEchoed;  /*!< The part of `_line` already echoed. */
+  bool _lineLost;  /*!< Set if part of `_line` was lost or garbled. */
+  std::string _sendBuffer;  /*!< The helper's send buffer, `sb`. */
+  Connection _connections[FAKE_NODEMCU_HANDLES];
+
+  bool _powered;
+  bool _asleep;
+  bool _echo;
+  uint32_t _baudRate;  /*!< The NodeMCU's UART rate. */
+  uint32_t _hostBaudRate;  /*!< The host's UART rate. */
+  uint8_t _status;  /*!< The station status, 5 once joined. */
+  bool _events;  /*!< Set while the status events are on. */
+  std::string _ssid;  /*!< The network joined. */
+  bool _installing;
+  std::string _helperFile;  /*!< The helper written to the file system. */
+  std::string _helperVersion;  /*!< The version of `_helperFile`. */
+  bool _helperLoaded;  /*!< Set once the helper has been loaded, until it restarts. */
+
+  bool garbled();
+  uint64_t byteTime();
+  size_t arrived();
+  void emit(const std::string& text);
+  void at(const uint64_t timeUS, std::function<void()> action);
+  void release();
+  uint64_t now();
+  void restart();
+  void receiveByte(const uint8_t c);
+  void lineReceived();
+  void execute(const std::string& line, const bool lost);
+  bool connectionCommand(const std::string& line);
+  void join(const std::vector<std::string>& args);
+  void connectStation(const bool fast);
+  void sendPayload(const uint8_t handle, const std::string& payload);
+  void sendNext(const uint8_t handle);
+  void payloadSent(const uint8_t handle, const std::string& payload);
+  void deliver(const uint8_t handle, const std::string& data);
+  void receivePacket(const uint8_t handle, const std::string& packet);
+  void releaseHeld(const uint8_t handle);
+  void readBack(const uint8_t handle, const size_t limit, const bool hex);
+  std::string tag(const char* event, const uint8_t handle);
+
+  static std::vector<std::string> splitArgs(const std::string& line, const size_t start);
+};
+
+/*!
+ * \brief This class switches a FakeNodeMCU on and off, as the Bee's
+ * power switch would.
+ */
+class FakeOnOff : public Sodaq_OnOffBee
+{
+public:
+  FakeOnOff(FakeNodeMCU& node) : _node(&node) {}
+
+  void on() { _node->powerOn(); }
+  void off() { _node->powerOff(); }
+  bool isOn() { return _node->isPowered(); }
+
+private:
+  FakeNodeMCU* _node;
+};
+
+#endif // FAKE_NODEMCU_H_
@@ -0,0 +1,134 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HOST_TEST_H_
+#define HOST_TEST_H_
+
+/*
+ * The helpers shared by the host tests and benchmarks. Each test or
+ * benchmark is a program of its own, which exits with 1 on the first
+ * failed check.
+ */
+
+#include <Arduino.h>
+#include <algorithm>
+#include "HostClock.h"
+#include "FakeNodeMCU.h"
+#include "Sodaq_WifiBee.h"
+
+#define CHECK(X) do { if (!(X)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #X); exit(1); } } while (0)
+
+// The time limit of runAsync(), longer than any request takes
+#define ASYNC_TIME_LIMIT 60000
+
+/*!
+ * \brief A Sodaq_WifiBee connected to a FakeNodeMCU, which it switches
+ * on and off.
+ */
+class HostBee
+{
+public:
+  HostBee(const size_t bufferSize = 256) : onOff(node)
+  {
+    node.begin(57600);
+    bee.init(node, -1, -1, -1, bufferSize);
+    bee.connectionSettings("ssid", "", "pw");
+    bee.setOnOff(onOff);
+  }
+
+  FakeNodeMCU node;
+  FakeOnOff onOff;
+  Sodaq_WifiBee bee;
+};
+
+namespace {
+
+bool completionDone;  // The completion callback was called
+bool completionResult;  // Its result
+uint16_t completionCode;  // Its HTTP code
+
+inline void onCompletion(bool result, uint16_t httpCode)
+{
+  completionDone = true;
+  completionResult = result;
+  completionCode = httpCode;
+}
+
+/*!
+ * Polls an asynchronous request until it completes, as a sketch's
+ * loop() would, once per millisecond.
+ * @return `true` if it completed successfully, `false` if it failed or
+ * didn't complete within ASYNC_TIME_LIMIT.
+ */
+inline bool runAsync(Sodaq_WifiBee& bee)
+{
+  completionDone = false;
+  bee.setCompletionCallback(onCompletion);
+
+  uint32_t startTS = millis();
+  while ((bee.isBusy()) && (millis() - startTS < ASYNC_TIME_LIMIT)) {
+    bee.poll();
+    delay(1);
+  }
+
+  return (completionDone) && (completionResult);
+}
+
+/*!
+ * Polls an asynchronous request until it completes, as runAsync() does.
+ * @param longestPollUS Set to the longest time one poll() call took.
+ * @return The time the request took in milliseconds.
+ */
+inline uint32_t timeAsync(Sodaq_WifiBee& bee, uint32_t& longestPollUS)
+{
+  completionDone = false;
+  bee.setCompletionCallback(onCompletion);
+  longestPollUS = 0;
+
+  uint32_t startTS = millis();
+  while ((bee.isBusy()) && (millis() - startTS < ASYNC_TIME_LIMIT)) {
+    uint32_t pollTS = micros();
+    bee.poll();
+    longestPollUS = std::max(longestPollUS, (uint32_t)(micros() - pollTS));
+    delay(1);
+  }
+
+  return millis() - startTS;
+}
+
+/*!
+ * Returns the body of an HTTP response read with readHTTPResponse().
+ */
+inline std::string responseBody(Sodaq_WifiBee& bee)
+{
+  char buffer[8192];
+  size_t length = 0;
+  uint16_t httpCode = 0;
+
+  if (!bee.readHTTPResponse(buffer, sizeof(buffer), length, httpCode)) {
+    return "";
+  }
+
+  return std::string(buffer, length);
+}
+
+} // namespace
+
+#endif // HOST_TEST_H_
@@ -0,0 +1,195 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#include "MockBroker.h"
+
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_PUBACK 0x40
+#define MQTT_PINGREQ 0xC0
+#define MQTT_PINGRESP 0xD0
+#define MQTT_DISCONNECT 0xE0
+
+#define MQTT_PASSWORD_FLAG 0x40
+#define MQTT_USERNAME_FLAG 0x80
+
+MockBroker::MockBroker()
+{
+  connectReturnCode = 0;
+  dropAcks = false;
+
+  reset();
+}
+
+/*!
+* Returns the broker as the server of a FakeNodeMCU.
+*/
+FakeServer MockBroker::server()
+{
+  return [this](uint8_t handle, const std::string& payload) { return receive(handle, payload); };
+}
+
+/*!
+* Receives a payload sent on a connection, and returns the packets sent
+* back for the whole packets it completes.
+*/
+std::string MockBroker::receive(const uint8_t handle, const std::string& payload)
+{
+  std::string& input = _input[handle];
+  std::string answer;
+
+  input += payload;
+
+  for (;;) {
+    // The fixed header, with a remaining length of up to four bytes
+    size_t length = 0;
+    size_t offset = 1;
+    uint8_t shift = 0;
+    uint8_t x;
+
+    do {
+      if ((offset >= input.size()) || (offset > 4)) {
+        return answer;
+      }
+      x = input[offset++];
+      length |= (size_t)(x & 0x7F) << shift;
+      shift += 7;
+    } while (x & 0x80);
+
+    if (input.size() < offset + length) {
+      return answer;
+    }
+
+    uint8_t type = input[0];
+    std::string body = input.substr(offset, length);
+    input.erase(0, offset + length);
+
+    switch (type & 0xF0) {
+    case MQTT_CONNECT: {
+      size_t position = 0;
+      std::string protocol;
+      uint8_t flags;
+
+      connects++;
+
+      if ((!readString(body, position, protocol)) || (protocol != "MQTT") || (body.size() < position + 4) ||
+        (body[position] != 4)) {
+        errors++;
+        break;
+      }
+      flags = body[position + 1];
+      keepAlive = ((uint8_t)body[position + 2] << 8) | (uint8_t)body[position + 3];
+      position += 4;
+
+      username.clear();
+      password.clear();
+      if ((!readString(body, position, clientId)) ||
+        ((flags & MQTT_USERNAME_FLAG) && (!readString(body, position, username))) ||
+        ((flags & MQTT_PASSWORD_FLAG) && (!readString(body, position, password))) ||
+        (position != body.size())) {
+        errors++;
+        break;
+      }
+
+      answer += packet(MQTT_CONNACK, std::string(1, '\0') + (char)connectReturnCode);
+      break;
+    }
+    case MQTT_PUBLISH: {
+      size_t position = 0;
+      MockMessage message;
+
+      message.qos = (type >> 1) & 3;
+      message.retain = type & 1;
+
+      if ((!readString(body, position, message.topic)) || (message.qos > 1) ||
+        (body.size() < position + 2 * message.qos)) {
+        errors++;
+        break;
+      }
+
+      std::string id = body.substr(position, 2 * message.qos);
+      message.payload = body.substr(position + id.size());
+      messages.push_back(message);
+
+      if ((message.qos == 1) && (!dropAcks)) {
+        answer += packet(MQTT_PUBACK, id);
+      }
+      break;
+    }
+    case MQTT_PINGREQ:
+      pings++;
+      answer += packet(MQTT_PINGRESP, "");
+      break;
+    case MQTT_DISCONNECT:
+      disconnects++;
+      break;
+    default:
+      errors++;
+      break;
+    }
+  }
+}
+
+/*!
+* Forgets the messages, the counters and any partial packets.
+*/
+void MockBroker::reset()
+{
+  _input.clear();
+
+  messages.clear();
+  clientId.clear();
+  username.clear();
+  password.clear();
+  keepAlive = 0;
+  connects = 0;
+  pings = 0;
+  disconnects = 0;
+  errors = 0;
+}
+
+/*!
+* Returns a packet with a body of less than 128 bytes.
+*/
+std::string MockBroker::packet(const uint8_t type, const std::string& body)
+{
+  return std::string(1, (char)type) + (char)body.size() + body;
+}
+
+/*!
+* Reads a length prefixed UTF-8 string from a packet body.
+*/
+bool MockBroker::readString(const std::string& body, size_t& offset, std::string& text)
+{
+  if (body.size() < offset + 2) {
+    return false;
+  }
+
+  size_t length = ((uint8_t)body[offset] << 8) | (uint8_t)body[offset + 1];
+  if (body.size() < offset + 2 + length) {
+    return false;
+  }
+
+  text = body.substr(offset + 2, length);
+  offset += 2 + length;
+
+  return true;
+}
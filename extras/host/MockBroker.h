@@ -0,0 +1,80 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MOCK_BROKER_H_
+#define MOCK_BROKER_H_
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "FakeNodeMCU.h"
+
+/*!
+ * \brief A message published to a MockBroker.
+ */
+struct MockMessage {
+  std::string topic;
+  std::string payload;
+  uint8_t qos;
+  bool retain;
+};
+
+/*!
+ * \brief This class is an MQTT 3.1.1 broker behind a FakeNodeMCU.
+ *
+ * It is set as the node's server with `node.server = broker.server()`.
+ * It parses the packets sent on each connection handle, however they are
+ * split into payloads, and answers CONNECT with CONNACK, QoS 1 PUBLISH
+ * with PUBACK and PINGREQ with PINGRESP. Any other packet, or a malformed
+ * one, is counted in `errors`.
+ */
+class MockBroker
+{
+public:
+  MockBroker();
+
+  FakeServer server();
+  std::string receive(const uint8_t handle, const std::string& payload);
+  void reset();
+
+  // The scripted behaviour
+  uint8_t connectReturnCode;  /*!< The CONNACK return code, 0 accepts the session. */
+  bool dropAcks;  /*!< Set to leave QoS 1 messages unacknowledged. */
+
+  // What happened, reset with reset()
+  std::vector<MockMessage> messages;  /*!< The messages published, in order. */
+  std::string clientId;  /*!< The client identifier of the last CONNECT. */
+  std::string username;  /*!< Its user name, if any. */
+  std::string password;  /*!< Its password, if any. */
+  uint16_t keepAlive;  /*!< Its keep alive interval in seconds. */
+  size_t connects;  /*!< The CONNECT packets. */
+  size_t pings;  /*!< The PINGREQ packets. */
+  size_t disconnects;  /*!< The DISCONNECT packets. */
+  size_t errors;  /*!< The unexpected and malformed packets. */
+
+private:
+  std::map<uint8_t, std::string> _input;  /*!< The data received by handle, until it is a whole packet. */
+
+  std::string packet(const uint8_t type, const std::string& body);
+  bool readString(const std::string& body, size_t& offset, std::string& text);
+};
+
+#endif // MOCK_BROKER_H_
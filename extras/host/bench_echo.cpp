@@ -0,0 +1,111 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The bytes the host reads with the REPL's echo on and off, at the baud
+// rates given as arguments (default 57600 115200 230400). The device is
+// kept on, so only the request itself is measured.
+
+#include "HostTest.h"
+
+// The body of the POST request and the TCP payload
+#define PAYLOAD_SIZE 600
+
+enum {
+  FLOW_GET,
+  FLOW_POST,
+  FLOW_TCP,
+  FLOW_COUNT
+};
+
+static const char* const FLOW_NAMES[] = { "GET", "POST", "TCP" };
+
+static bool runFlow(HostBee& host, const uint8_t flow, const char* payload)
+{
+  uint16_t code = 0;
+
+  switch (flow) {
+  case FLOW_GET:
+    return host.bee.HTTPGet("example.com", 80, "/", "", code);
+  case FLOW_POST:
+    return host.bee.HTTPPost("example.com", 80, "/", "", payload, code);
+  case FLOW_TCP:
+    return (host.bee.openTCP("example.com", 9000)) && (host.bee.sendTCPAscii(payload, true)) &&
+      (host.bee.closeTCP());
+  }
+
+  return false;
+}
+
+int main(int argc, char** argv)
+{
+  static const uint32_t DEFAULT_RATES[] = { 57600, 115200, 230400 };
+
+  std::vector<uint32_t> rates;
+  for (int i = 1; i < argc; i++) {
+    rates.push_back(strtoul(argv[i], NULL, 10));
+  }
+  if (rates.empty()) {
+    rates.assign(DEFAULT_RATES, DEFAULT_RATES + 3);
+  }
+
+  std::string payload(PAYLOAD_SIZE, 'p');
+
+  printf("%-7s %-5s %-5s %9s %9s %9s\n", "baud", "flow", "echo", "ms", "written", "read");
+
+  for (size_t r = 0; r < rates.size(); r++) {
+    for (uint8_t flow = 0; flow < FLOW_COUNT; flow++) {
+      uint32_t timeMS[2];
+      size_t bytesRead[2];
+
+      for (int echo = 1; echo >= 0; echo--) {
+        HostBee host;
+
+        host.node.bootBaudRate = rates[r];
+        host.node.begin(rates[r]);
+        host.bee.setBaudRate(rates[r]);
+        host.bee.setEcho(echo);
+        host.bee.setPowerPolicy(WIFIBEE_POWER_KEEP_ALIVE);
+
+        // Installs the helper, switches the echo off and leaves the device on
+        CHECK(runFlow(host, flow, payload.c_str()));
+        host.node.clearCounters();
+
+        uint32_t startTS = millis();
+        CHECK(runFlow(host, flow, payload.c_str()));
+        timeMS[echo] = millis() - startTS;
+        bytesRead[echo] = host.node.bytesToHost;
+
+        printf("%-7u %-5s %-5s %9u %9u %9u\n", (unsigned)rates[r], FLOW_NAMES[flow], echo ? "on" : "off",
+          (unsigned)timeMS[echo], (unsigned)host.node.bytesFromHost, (unsigned)bytesRead[echo]);
+
+        CHECK(host.node.unknownLines == 0);
+        if (flow != FLOW_GET) {
+          CHECK(host.node.lastPayload.find(payload) != std::string::npos);
+        }
+      }
+
+      // Without the echo the host only reads the output. The echo is read
+      // while the host writes, so the time hardly changes.
+      CHECK(bytesRead[0] < bytesRead[1]);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,137 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The UART bytes written to upload binary TCP payloads, compared to the
+// payload size and to escaping every byte as a decimal escape, at the
+// baud rates given as arguments (default 57600 115200 230400).
+
+#include "HostTest.h"
+
+enum {
+  PAYLOAD_ALL_BYTES,
+  PAYLOAD_TEXT,
+  PAYLOAD_RANDOM,
+  PAYLOAD_ZEROS,
+  PAYLOAD_COUNT
+};
+
+static const char* const PAYLOAD_NAMES[] = { "0..255", "text", "random", "zeros" };
+
+static std::string makePayload(const uint8_t type)
+{
+  static const char TEXT[] = "{\"t\":21.5,\"h\":\"60%\",\"id\":\"bee\\\\1\"}\r\n";
+
+  std::string payload;
+  uint32_t seed = 1;
+
+  switch (type) {
+  case PAYLOAD_ALL_BYTES:
+    for (int i = 0; i < 256; i++) {
+      payload += (char)i;
+    }
+    break;
+  case PAYLOAD_TEXT:
+    while (payload.size() < 1000) {
+      payload += TEXT;
+    }
+    break;
+  case PAYLOAD_RANDOM:
+    for (int i = 0; i < 1000; i++) {
+      seed = seed * 1103515245 + 12345;
+      payload += (char)(seed >> 16);
+    }
+    break;
+  case PAYLOAD_ZEROS:
+    payload.assign(1000, '\0');
+    break;
+  }
+
+  return payload;
+}
+
+// The size of the payload with every byte as a decimal escape, without
+// the framing of the lines
+static size_t decimalSize(const std::string& payload)
+{
+  size_t size = 0;
+
+  for (size_t i = 0; i < payload.size(); i++) {
+    uint8_t value = payload[i];
+    size += (value >= 100) ? 4 : (value >= 10) ? 3 : 2;
+  }
+
+  return size;
+}
+
+int main(int argc, char** argv)
+{
+  static const uint32_t DEFAULT_RATES[] = { 57600, 115200, 230400 };
+
+  std::vector<uint32_t> rates;
+  for (int i = 1; i < argc; i++) {
+    rates.push_back(strtoul(argv[i], NULL, 10));
+  }
+  if (rates.empty()) {
+    rates.assign(DEFAULT_RATES, DEFAULT_RATES + 3);
+  }
+
+  printf("%-7s %-7s %7s %9s %9s %7s %9s %6s\n", "baud", "payload", "bytes", "written", "decimal",
+    "ratio", "ms", "lines");
+
+  for (size_t r = 0; r < rates.size(); r++) {
+    HostBee host;
+
+    host.node.bootBaudRate = rates[r];
+    host.node.begin(rates[r]);
+    host.node.response = "ok";
+    host.bee.setBaudRate(rates[r]);
+
+    CHECK(host.bee.openTCP("example.com", 9000));
+
+    for (uint8_t type = 0; type < PAYLOAD_COUNT; type++) {
+      std::string payload = makePayload(type);
+
+      host.node.clearCounters();
+      uint32_t startTS = millis();
+      CHECK(host.bee.sendTCPBinary((const uint8_t*)payload.data(), payload.size(), true));
+      uint32_t timeMS = millis() - startTS;
+
+      printf("%-7u %-7s %7u %9u %9u %7.2f %9u %6u\n", (unsigned)rates[r], PAYLOAD_NAMES[type],
+        (unsigned)payload.size(), (unsigned)host.node.bytesFromHost, (unsigned)decimalSize(payload),
+        (double)host.node.bytesFromHost / payload.size(), (unsigned)timeMS, (unsigned)host.node.lines);
+
+      // The payload arrives intact, without any bytes the line editor mangles
+      CHECK(host.node.lastPayload == payload);
+      CHECK(host.node.controlBytes == 0 && host.node.unknownLines == 0);
+
+      // Only the bytes which need it are escaped, "\0" is as short as it gets
+      if (type == PAYLOAD_ZEROS) {
+        CHECK(host.node.bytesFromHost < 2.2 * payload.size());
+      }
+      else {
+        CHECK(host.node.bytesFromHost < decimalSize(payload) / 2);
+      }
+    }
+
+    CHECK(host.bee.closeTCP());
+  }
+
+  return 0;
+}
@@ -0,0 +1,109 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The end-to-end time and the bytes on the UART of each request type,
+// at the baud rates given as arguments (default 57600 115200 230400).
+// Each request starts with the device switched off, as by default, and
+// again with the device kept on.
+
+#include "HostTest.h"
+
+// The body of the POST and PUT requests, and the TCP and UDP payload
+#define PAYLOAD_SIZE 200
+
+enum {
+  FLOW_GET,
+  FLOW_POST,
+  FLOW_PUT,
+  FLOW_TCP,
+  FLOW_UDP,
+  FLOW_COUNT
+};
+
+static const char* const FLOW_NAMES[] = { "GET", "POST", "PUT", "TCP", "UDP" };
+
+static bool runFlow(HostBee& host, const uint8_t flow, const char* payload)
+{
+  uint16_t code = 0;
+
+  switch (flow) {
+  case FLOW_GET:
+    return host.bee.HTTPGet("example.com", 80, "/", "", code);
+  case FLOW_POST:
+    return host.bee.HTTPPost("example.com", 80, "/", "", payload, code);
+  case FLOW_PUT:
+    return host.bee.HTTPPut("example.com", 80, "/", "", payload, code);
+  case FLOW_TCP:
+    return (host.bee.openTCP("example.com", 9000)) && (host.bee.sendTCPAscii(payload, true)) &&
+      (host.bee.closeTCP());
+  case FLOW_UDP:
+    return (host.bee.openUDP("example.com", 9000)) && (host.bee.sendUDPAscii(payload, true)) &&
+      (host.bee.closeUDP());
+  }
+
+  return false;
+}
+
+int main(int argc, char** argv)
+{
+  static const uint32_t DEFAULT_RATES[] = { 57600, 115200, 230400 };
+
+  std::vector<uint32_t> rates;
+  for (int i = 1; i < argc; i++) {
+    rates.push_back(strtoul(argv[i], NULL, 10));
+  }
+  if (rates.empty()) {
+    rates.assign(DEFAULT_RATES, DEFAULT_RATES + 3);
+  }
+
+  std::string payload(PAYLOAD_SIZE, 'p');
+
+  printf("%-7s %-5s %-10s %9s %9s %9s %7s\n", "baud", "flow", "power", "ms", "written", "read", "lines");
+
+  for (size_t r = 0; r < rates.size(); r++) {
+    for (uint8_t flow = 0; flow < FLOW_COUNT; flow++) {
+      for (uint8_t policy = WIFIBEE_POWER_OFF; policy <= WIFIBEE_POWER_KEEP_ALIVE; policy++) {
+        HostBee host;
+
+        host.node.bootBaudRate = rates[r];
+        host.node.begin(rates[r]);
+        host.node.joinLatencyMS = 1500;
+        host.node.connectLatencyMS = 50;
+        host.node.sendLatencyMS = 20;
+        host.node.serverLatencyMS = 40;
+        host.bee.setBaudRate(rates[r]);
+        host.bee.setPowerPolicy(policy);
+
+        // Installs the helper, and for keep alive leaves the device on
+        CHECK(runFlow(host, flow, payload.c_str()));
+        host.node.clearCounters();
+
+        uint32_t startTS = millis();
+        CHECK(runFlow(host, flow, payload.c_str()));
+
+        printf("%-7u %-5s %-10s %9u %9u %9u %7u\n", (unsigned)rates[r], FLOW_NAMES[flow],
+          (policy == WIFIBEE_POWER_OFF) ? "off" : "keep alive", (unsigned)(millis() - startTS),
+          (unsigned)host.node.bytesFromHost, (unsigned)host.node.bytesToHost, (unsigned)host.node.lines);
+      }
+    }
+  }
+
+  return 0;
+}
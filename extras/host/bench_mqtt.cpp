@@ -0,0 +1,110 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The messages per minute published to the mock broker with QoS 0 and 1,
+// compared with one HTTP POST per message, at the baud rates given as
+// arguments (default 57600 115200 230400). The device is kept on.
+
+#include "HostTest.h"
+#include "MockBroker.h"
+#include "Sodaq_WifiBeeMQTT.h"
+
+#define MESSAGE_COUNT 100
+
+static void message(const int i, char* buffer)
+{
+  sprintf(buffer, "temp=21.5,seq=%03d", i);
+}
+
+int main(int argc, char** argv)
+{
+  static const uint32_t DEFAULT_RATES[] = { 57600, 115200, 230400 };
+
+  std::vector<uint32_t> rates;
+  for (int i = 1; i < argc; i++) {
+    rates.push_back(strtoul(argv[i], NULL, 10));
+  }
+  if (rates.empty()) {
+    rates.assign(DEFAULT_RATES, DEFAULT_RATES + 3);
+  }
+
+  printf("%-7s %-9s %9s %9s %9s %9s\n", "baud", "method", "ms", "msgs/min", "speed up", "payloads");
+
+  for (size_t r = 0; r < rates.size(); r++) {
+    HostBee host;
+    MockBroker broker;
+    Sodaq_WifiBeeMQTT mqtt(host.bee);
+    uint16_t code = 0;
+    char buffer[32];
+
+    host.node.bootBaudRate = rates[r];
+    host.node.begin(rates[r]);
+    host.node.connectLatencyMS = 50;
+    host.node.sendLatencyMS = 20;
+    host.node.serverLatencyMS = 40;
+    host.bee.setBaudRate(rates[r]);
+    host.bee.setPowerPolicy(WIFIBEE_POWER_KEEP_ALIVE);
+
+    // Installs the helper and leaves the device on
+    CHECK(host.bee.HTTPPost("example.com", 80, "/", "", "warm up", code));
+
+    uint32_t startTS = millis();
+    for (int i = 0; i < MESSAGE_COUNT; i++) {
+      message(i, buffer);
+      CHECK(host.bee.HTTPPost("example.com", 80, "/m", "", buffer, code) && code == 200);
+    }
+    uint32_t httpMS = millis() - startTS;
+
+    printf("%-7u %-9s %9u %9.0f %9s %9u\n", (unsigned)rates[r], "HTTP POST", (unsigned)httpMS,
+      MESSAGE_COUNT * 60000.0 / httpMS, "", (unsigned)MESSAGE_COUNT);
+
+    host.node.server = broker.server();
+    mqtt.setServer("broker.local", 1883);
+    CHECK(mqtt.connect("bee1"));
+
+    for (uint8_t qos = 0; qos < 2; qos++) {
+      broker.messages.clear();
+      host.node.clearCounters();
+
+      startTS = millis();
+      for (int i = 0; i < MESSAGE_COUNT; i++) {
+        message(i, buffer);
+        CHECK(mqtt.publish("wifibee/t", buffer, qos));
+      }
+      CHECK(mqtt.flush());
+      uint32_t timeMS = millis() - startTS;
+
+      printf("%-7u %-9s %9u %9.0f %8.1fx %9u\n", (unsigned)rates[r], qos ? "MQTT QoS1" : "MQTT QoS0",
+        (unsigned)timeMS, MESSAGE_COUNT * 60000.0 / timeMS, (double)httpMS / timeMS,
+        (unsigned)host.node.payloads);
+
+      CHECK(broker.messages.size() == MESSAGE_COUNT && broker.errors == 0);
+      message(MESSAGE_COUNT - 1, buffer);
+      CHECK(broker.messages.back().payload == buffer && mqtt.getInFlight() == 0);
+
+      // The session and the coalesced payloads save the round trips of HTTP
+      CHECK(httpMS > 5 * timeMS);
+    }
+
+    mqtt.disconnect();
+  }
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The time and the joins to upload a backlog of records with one HTTP
+// POST per record, against queueing them and forwarding the queue, with
+// the device switched off in between as by default.
+
+#include "HostTest.h"
+#include "Sodaq_WifiBeeQueue.h"
+
+#define RECORD_COUNT 60
+
+int main()
+{
+  HostBee host;
+  uint8_t storage[2048];
+  Sodaq_WifiBeeRAMStore store(storage, sizeof(storage));
+  Sodaq_WifiBeeQueue queue(host.bee, store);
+  uint16_t code = 0;
+  char record[32];
+
+  host.node.joinLatencyMS = 1500;
+  host.node.connectLatencyMS = 50;
+  host.node.sendLatencyMS = 20;
+  host.node.serverLatencyMS = 40;
+
+  // Installs the helper
+  CHECK(host.bee.HTTPPost("example.com", 80, "/t", "", "warm up", code));
+  host.node.clearCounters();
+
+  uint32_t startTS = millis();
+  for (int i = 0; i < RECORD_COUNT; i++) {
+    sprintf(record, "t=21.5,seq=%03d", i);
+    CHECK(host.bee.HTTPPost("example.com", 80, "/t", "", record, code) && code == 200);
+  }
+  uint32_t postMS = millis() - startTS;
+  size_t postJoins = host.node.joins;
+  size_t postBytes = host.node.bytesFromHost + host.node.bytesToHost;
+
+  queue.setTarget("example.com", 80, "/t");
+  for (int i = 0; i < RECORD_COUNT; i++) {
+    sprintf(record, "t=21.5,seq=%03d", i);
+    CHECK(queue.add(record));
+  }
+  host.node.clearCounters();
+
+  startTS = millis();
+  CHECK(queue.forward());
+  uint32_t forwardMS = millis() - startTS;
+
+  printf("%-8s %9s %9s %9s %9s\n", "method", "ms", "joins", "requests", "UART");
+  printf("%-8s %9u %9u %9u %9u\n", "POST", (unsigned)postMS, (unsigned)postJoins, (unsigned)RECORD_COUNT,
+    (unsigned)postBytes);
+  printf("%-8s %9u %9u %9u %9u\n", "forward", (unsigned)forwardMS, (unsigned)host.node.joins,
+    (unsigned)queue.getBatches(), (unsigned)(host.node.bytesFromHost + host.node.bytesToHost));
+
+  CHECK(queue.getCount() == 0 && queue.getForwarded() == RECORD_COUNT);
+  CHECK(host.node.joins == 1 && postJoins == RECORD_COUNT);
+  CHECK(forwardMS * 10 < postMS);
+
+  return 0;
+}
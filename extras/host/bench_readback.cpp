@@ -0,0 +1,110 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The read back of HTTP responses in raw and in HEX mode, at the baud
+// rates given as arguments (default 57600 115200 230400). The device is
+// kept on, so only the request and its read back are measured.
+
+#include "HostTest.h"
+
+// The serial receive buffer of an AVR host
+#define HOST_RX_BUFFER 64
+
+int main(int argc, char** argv)
+{
+  static const uint32_t DEFAULT_RATES[] = { 57600, 115200, 230400 };
+  static const size_t BODY_SIZES[] = { 100, 1000, 4000 };
+
+  // HEX, then raw with the default chunk, a larger one and no limit
+  static const struct {
+    const char* name;
+    bool raw;
+    size_t chunk;
+  } MODES[] = {
+    { "HEX", false, 0 },
+    { "raw48", true, WIFIBEE_READ_BACK_CHUNK },
+    { "raw240", true, 240 },
+    { "raw", true, 0 }
+  };
+  static const size_t MODE_COUNT = sizeof(MODES) / sizeof(MODES[0]);
+
+  std::vector<uint32_t> rates;
+  for (int i = 1; i < argc; i++) {
+    rates.push_back(strtoul(argv[i], NULL, 10));
+  }
+  if (rates.empty()) {
+    rates.assign(DEFAULT_RATES, DEFAULT_RATES + 3);
+  }
+
+  printf("%-7s %-6s %6s %9s %9s %9s %9s %9s %6s\n", "baud", "mode", "body", "ms", "read", "kB/s",
+    "readbacks", "largest", "gain");
+
+  for (size_t r = 0; r < rates.size(); r++) {
+    for (size_t b = 0; b < sizeof(BODY_SIZES) / sizeof(BODY_SIZES[0]); b++) {
+      uint32_t timeMS[MODE_COUNT];
+
+      std::string body;
+      for (size_t i = 0; i < BODY_SIZES[b]; i++) {
+        body += (char)('A' + i % 26);
+      }
+
+      for (size_t m = 0; m < MODE_COUNT; m++) {
+        HostBee host(4200);
+        uint16_t code = 0;
+
+        host.node.bootBaudRate = rates[r];
+        host.node.begin(rates[r]);
+        host.node.response = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body.size()) +
+          "\r\n\r\n" + body;
+        host.bee.setBaudRate(rates[r]);
+        host.bee.setPowerPolicy(WIFIBEE_POWER_KEEP_ALIVE);
+        host.bee.setRawReadBack(MODES[m].raw, MODES[m].chunk);
+
+        // Installs the helper and leaves the device on
+        CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code));
+        host.node.clearCounters();
+
+        uint32_t startTS = millis();
+        CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && code == 200);
+        timeMS[m] = millis() - startTS;
+        CHECK(responseBody(host.bee) == body);
+
+        // The gain is the throughput relative to HEX mode
+        printf("%-7u %-6s %6u %9u %9u %9.1f %9u %9u %6.2f\n", (unsigned)rates[r], MODES[m].name,
+          (unsigned)body.size(), (unsigned)timeMS[m], (unsigned)host.node.bytesToHost,
+          (double)body.size() / timeMS[m], (unsigned)host.node.readBacks,
+          (unsigned)host.node.maxReadBack, (double)timeMS[0] / timeMS[m]);
+
+        // A default raw chunk with its framing fits in the host's receive buffer
+        if (MODES[m].raw && (MODES[m].chunk == WIFIBEE_READ_BACK_CHUNK)) {
+          CHECK(host.node.maxReadBack <= HOST_RX_BUFFER);
+        }
+        if (m > 0) {
+          CHECK(timeMS[m] < timeMS[0]);
+        }
+      }
+
+      // Larger chunks take fewer read backs
+      CHECK(timeMS[3] <= timeMS[2] && timeMS[2] <= timeMS[1]);
+    }
+  }
+
+  return 0;
+}
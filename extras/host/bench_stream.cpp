@@ -0,0 +1,94 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The records per second streamed to a local TCP sink, which only
+// receives, with sendTCPBinary() for each record against streamTCPBinary()
+// with send windows of 1, 4 and 8, for network send latencies of 20 and
+// 50 ms.
+
+#include "HostTest.h"
+
+#define RECORD_COUNT 100
+#define RECORD_SIZE 64
+
+int main()
+{
+  static const uint32_t SEND_LATENCIES[] = { 20, 50 };
+  static const uint8_t WINDOWS[] = { 0, 1, 4, 8 };
+
+  std::string records;
+  uint32_t seed = 1;
+  for (int i = 0; i < RECORD_COUNT * RECORD_SIZE; i++) {
+    seed = seed * 1103515245 + 12345;
+    records += (char)(seed >> 16);
+  }
+
+  printf("%-7s %-7s %9s %9s %7s\n", "latency", "window", "ms", "records/s", "lines");
+
+  for (size_t l = 0; l < sizeof(SEND_LATENCIES) / sizeof(SEND_LATENCIES[0]); l++) {
+    uint32_t timeMS[sizeof(WINDOWS)];
+
+    for (size_t w = 0; w < sizeof(WINDOWS); w++) {
+      HostBee host;
+      std::string sink;
+
+      host.node.sendLatencyMS = SEND_LATENCIES[l];
+      host.node.server = [&sink](uint8_t handle, const std::string& payload) {
+        sink += payload;
+        return std::string();
+      };
+      if (WINDOWS[w] > 0) {
+        host.bee.setSendWindow(WINDOWS[w]);
+      }
+
+      CHECK(host.bee.openTCP("sink.local", 9000));
+      host.node.clearCounters();
+
+      uint32_t startTS = millis();
+      for (int i = 0; i < RECORD_COUNT; i++) {
+        const uint8_t* record = (const uint8_t*)records.data() + i * RECORD_SIZE;
+
+        // Window 0 sends each record and waits until it has been sent
+        if (WINDOWS[w] == 0) {
+          CHECK(host.bee.sendTCPBinary(record, RECORD_SIZE, false));
+        }
+        else {
+          CHECK(host.bee.streamTCPBinary(record, RECORD_SIZE));
+        }
+      }
+      CHECK(host.bee.flushTCP());
+      timeMS[w] = millis() - startTS;
+
+      printf("%-7u %-7s %9u %9.1f %7u\n", (unsigned)SEND_LATENCIES[l],
+        (WINDOWS[w] == 0) ? "send" : std::to_string(WINDOWS[w]).c_str(), (unsigned)timeMS[w],
+        RECORD_COUNT * 1000.0 / timeMS[w], (unsigned)host.node.lines);
+
+      CHECK(host.bee.closeTCP());
+      CHECK(sink == records);
+      CHECK(host.node.unknownLines == 0);
+    }
+
+    // A window of more than one payload overlaps the uploads with the sends,
+    // a wider one is as fast once the sends are the bottleneck
+    CHECK(timeMS[2] < timeMS[1] && timeMS[3] <= timeMS[2] + timeMS[2] / 100);
+  }
+
+  return 0;
+}
@@ -0,0 +1,94 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The upload of 1 KB, 4 KB and 16 KB POST bodies in send buffer chunk
+// lines, waiting for the prompt after every line (window 1) or with a
+// second line in flight (window 2), at the baud rates given as arguments
+// (default 57600 115200 230400). The second line is buffered by the NodeMCU
+// while it executes the first, which must never overflow its UART input
+// buffer.
+
+#include "HostTest.h"
+
+// The Lua execution time of each line
+#define LINE_LATENCY_MS 5
+
+int main(int argc, char** argv)
+{
+  static const uint32_t DEFAULT_RATES[] = { 57600, 115200, 230400 };
+  static const size_t BODY_SIZES[] = { 1024, 4096, 16384 };
+
+  std::vector<uint32_t> rates;
+  for (int i = 1; i < argc; i++) {
+    rates.push_back(strtoul(argv[i], NULL, 10));
+  }
+  if (rates.empty()) {
+    rates.assign(DEFAULT_RATES, DEFAULT_RATES + 3);
+  }
+
+  printf("%-7s %6s %-6s %9s %7s %9s %9s\n", "baud", "body", "window", "ms", "lines", "pending", "kB/s");
+
+  for (size_t r = 0; r < rates.size(); r++) {
+    for (size_t b = 0; b < sizeof(BODY_SIZES) / sizeof(BODY_SIZES[0]); b++) {
+      uint32_t timeMS[WIFIBEE_MAX_UPLOAD_WINDOW + 1];
+      size_t pending[WIFIBEE_MAX_UPLOAD_WINDOW + 1];
+
+      std::string body;
+      for (size_t i = 0; i < BODY_SIZES[b]; i++) {
+        body += (char)('a' + i % 26);
+      }
+
+      // The window above the maximum is limited to it
+      for (uint8_t window = 1; window <= WIFIBEE_MAX_UPLOAD_WINDOW + 1; window++) {
+        HostBee host;
+        uint16_t code = 0;
+
+        host.node.bootBaudRate = rates[r];
+        host.node.begin(rates[r]);
+        host.node.lineLatencyMS = LINE_LATENCY_MS;
+        host.bee.setBaudRate(rates[r]);
+        host.bee.setPowerPolicy(WIFIBEE_POWER_KEEP_ALIVE);
+        host.bee.setUploadWindow(window);
+
+        // Installs the helper and leaves the device on
+        CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code));
+        host.node.clearCounters();
+
+        uint32_t startTS = millis();
+        CHECK(host.bee.HTTPPost("example.com", 80, "/", "", body.c_str(), code) && code == 200);
+        timeMS[window - 1] = millis() - startTS;
+        pending[window - 1] = host.node.maxInputPending;
+
+        printf("%-7u %6u %-6u %9u %7u %9u %9.1f\n", (unsigned)rates[r], (unsigned)body.size(),
+          (unsigned)window, (unsigned)timeMS[window - 1], (unsigned)host.node.lines,
+          (unsigned)host.node.maxInputPending, (double)body.size() / timeMS[window - 1]);
+
+        CHECK(host.node.lastPayload.find("\r\n\r\n" + body) != std::string::npos);
+        CHECK(host.node.inputOverflows == 0 && host.node.unknownLines == 0);
+        CHECK(host.node.maxInputPending <= host.node.inputBufferSize);
+      }
+
+      CHECK(timeMS[1] < timeMS[0]);
+      CHECK(pending[0] == 0 && pending[WIFIBEE_MAX_UPLOAD_WINDOW] == pending[WIFIBEE_MAX_UPLOAD_WINDOW - 1]);
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The write() calls the library makes to the device's stream for each
+// request type, against the bytes written, i.e. the calls writing each
+// byte on its own would take. The device is kept on, so only the request
+// itself is counted.
+
+#include "HostTest.h"
+
+// The body of the POST and PUT requests, and the TCP payloads
+#define PAYLOAD_SIZE 600
+
+enum {
+  FLOW_GET,
+  FLOW_POST,
+  FLOW_PUT,
+  FLOW_ASYNC_POST,
+  FLOW_TCP_ASCII,
+  FLOW_TCP_BINARY,
+  FLOW_TCP_STREAM,
+  FLOW_COUNT
+};
+
+static const char* const FLOW_NAMES[] = { "GET", "POST", "PUT", "async POST", "TCP ascii", "TCP binary",
+  "TCP stream" };
+
+static bool runFlow(HostBee& host, const uint8_t flow, const std::string& text, const std::string& binary)
+{
+  uint16_t code = 0;
+
+  switch (flow) {
+  case FLOW_GET:
+    return host.bee.HTTPGet("example.com", 80, "/", "Accept: */*\r\n", code);
+  case FLOW_POST:
+    return host.bee.HTTPPost("example.com", 80, "/", "Accept: */*\r\n", text.c_str(), code);
+  case FLOW_PUT:
+    return host.bee.HTTPPut("example.com", 80, "/", "Accept: */*\r\n", text.c_str(), code);
+  case FLOW_ASYNC_POST:
+    return (host.bee.beginHTTPPost("example.com", 80, "/", "Accept: */*\r\n", text.c_str())) &&
+      (runAsync(host.bee));
+  case FLOW_TCP_ASCII:
+    return (host.bee.openTCP("example.com", 9000)) && (host.bee.sendTCPAscii(text.c_str(), true)) &&
+      (host.bee.closeTCP());
+  case FLOW_TCP_BINARY:
+    return (host.bee.openTCP("example.com", 9000)) &&
+      (host.bee.sendTCPBinary((const uint8_t*)binary.data(), binary.size(), true)) && (host.bee.closeTCP());
+  case FLOW_TCP_STREAM:
+    return (host.bee.openTCP("example.com", 9000)) &&
+      (host.bee.streamTCPBinary((const uint8_t*)binary.data(), binary.size())) &&
+      (host.bee.flushTCP()) && (host.bee.closeTCP());
+  }
+
+  return false;
+}
+
+int main()
+{
+  std::string text;
+  std::string binary;
+  uint32_t seed = 1;
+
+  for (int i = 0; i < PAYLOAD_SIZE; i++) {
+    text += (char)('a' + i % 26);
+    seed = seed * 1103515245 + 12345;
+    binary += (char)(seed >> 16);
+  }
+
+  printf("%-10s %9s %9s %9s %7s\n", "flow", "written", "calls", "per call", "lines");
+
+  for (uint8_t flow = 0; flow < FLOW_COUNT; flow++) {
+    HostBee host;
+
+    host.bee.setPowerPolicy(WIFIBEE_POWER_KEEP_ALIVE);
+
+    // Installs the helper and leaves the device on
+    CHECK(runFlow(host, flow, text, binary));
+    host.node.clearCounters();
+
+    CHECK(runFlow(host, flow, text, binary));
+
+    printf("%-10s %9u %9u %9.1f %7u\n", FLOW_NAMES[flow], (unsigned)host.node.bytesFromHost,
+      (unsigned)host.node.writeCalls, (double)host.node.bytesFromHost / host.node.writeCalls,
+      (unsigned)host.node.lines);
+
+    CHECK(host.node.unknownLines == 0);
+
+    // The payloads are written a line at a time
+    if (flow != FLOW_GET) {
+      CHECK(host.node.writeCalls * 20 < host.node.bytesFromHost);
+    }
+  }
+
+  return 0;
+}
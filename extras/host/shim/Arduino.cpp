@@ -0,0 +1,53 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "HostClock.h"
+
+uint64_t HostClock::_micros = 0;
+
+uint32_t millis()
+{
+  return (uint32_t)(HostClock::now() / 1000);
+}
+
+uint32_t micros()
+{
+  return (uint32_t)HostClock::now();
+}
+
+void delay(unsigned long ms)
+{
+  HostClock::advance((uint64_t)ms * 1000);
+}
+
+// The pins are not used by the emulated devices
+void pinMode(int pin, int mode)
+{
+}
+
+void digitalWrite(int pin, int value)
+{
+}
+
+int digitalRead(int pin)
+{
+  return LOW;
+}
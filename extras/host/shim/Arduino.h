@@ -0,0 +1,166 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARDUINO_H_
+#define ARDUINO_H_
+
+/*
+ * The subset of the Arduino core used by the library, for a host build.
+ * Time is emulated, see HostClock.h: it only advances with delay(), the
+ * emulated UART and HostClock::advance().
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <string>
+
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+#define INPUT 0
+#define DEC 10
+#define HEX 16
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// 32 bits wide, as the Arduino's unsigned long, so they wrap alike
+uint32_t millis();
+uint32_t micros();
+void delay(unsigned long ms);
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+
+class __FlashStringHelper;
+#define F(x) (reinterpret_cast<const __FlashStringHelper*>(x))
+
+class String
+{
+public:
+  String(const char* text = "") : _s(text ? text : "") {}
+  String(int value) : _s(std::to_string(value)) {}
+
+  const char* c_str() const { return _s.c_str(); }
+  unsigned int length() const { return _s.size(); }
+  void reserve(unsigned int size) { _s.reserve(size); }
+
+  char operator[](unsigned int index) const { return _s[index]; }
+  bool operator==(const char* text) const { return _s == text; }
+  bool operator==(const String& other) const { return _s == other._s; }
+  bool operator!=(const String& other) const { return _s != other._s; }
+  String& operator+=(const String& other) { _s += other._s; return *this; }
+  String& operator+=(const char* text) { _s += text; return *this; }
+  String& operator+=(char c) { _s += c; return *this; }
+
+private:
+  std::string _s;
+};
+
+class Print
+{
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+
+  virtual size_t write(const uint8_t* buffer, size_t size)
+  {
+    size_t count = 0;
+    while (size--) {
+      count += write(*buffer++);
+    }
+    return count;
+  }
+
+  size_t write(const char* text) { return text ? write((const uint8_t*)text, strlen(text)) : 0; }
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const char* text) { return write(text); }
+  size_t print(const String& text) { return write(text.c_str()); }
+  size_t print(const __FlashStringHelper* text) { return write((const char*)text); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC) { return printFormatted((base == HEX) ? "%lX" : "%ld", n); }
+  size_t print(unsigned long n, int base = DEC) { return printFormatted((base == HEX) ? "%lX" : "%lu", n); }
+  size_t print(double n, int digits = 2) { return printFormatted("%.*f", digits, n); }
+
+  size_t println() { return write("\r\n"); }
+  template<class T> size_t println(T value) { size_t n = print(value); return n + println(); }
+  template<class T> size_t println(T value, int base) { size_t n = print(value, base); return n + println(); }
+
+private:
+  template<class... T> size_t printFormatted(const char* format, T... values)
+  {
+    char text[40];
+    snprintf(text, sizeof(text), format, values...);
+    return write(text);
+  }
+};
+
+class Stream : public Print
+{
+public:
+  Stream() : _timeout(1000) {}
+
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout() { return _timeout; }
+
+  size_t readBytes(char* buffer, size_t length)
+  {
+    size_t count = 0;
+    uint32_t startTS = millis();
+    while ((count < length) && (millis() - startTS < _timeout)) {
+      int c = read();
+      if (c >= 0) {
+        buffer[count++] = c;
+        startTS = millis();
+      }
+    }
+    return count;
+  }
+
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+
+protected:
+  unsigned long _timeout;
+};
+
+class HardwareSerial : public Stream
+{
+public:
+  virtual void begin(unsigned long baudRate) = 0;
+  virtual void end() = 0;
+};
+
+#endif // ARDUINO_H_
@@ -0,0 +1,44 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HOST_CLOCK_H_
+#define HOST_CLOCK_H_
+
+#include <stdint.h>
+
+/*!
+ * \brief The emulated time of the host build.
+ *
+ * millis() and micros() return it. It starts at 0 and only advances when
+ * something takes time: delay(), and the emulated devices, e.g. for each
+ * byte on their UART.
+ */
+class HostClock
+{
+public:
+  static uint64_t now() { return _micros; }
+
+  static void advance(const uint64_t micros) { _micros += micros; }
+
+private:
+  static uint64_t _micros;  /*!< The time in microseconds. */
+};
+
+#endif // HOST_CLOCK_H_
@@ -0,0 +1,45 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef IPADDRESS_H_
+#define IPADDRESS_H_
+
+#include "Arduino.h"
+
+class IPAddress
+{
+public:
+  IPAddress() { memset(_address, 0, sizeof(_address)); }
+
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+  {
+    _address[0] = a;
+    _address[1] = b;
+    _address[2] = c;
+    _address[3] = d;
+  }
+
+  uint8_t operator[](int index) const { return _address[index]; }
+
+private:
+  uint8_t _address[4];
+};
+
+#endif // IPADDRESS_H_
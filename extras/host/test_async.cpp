@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The asynchronous requests: poll() doesn't block, and a request which
+// times out completes with a failure, after which the next one succeeds.
+
+#include "HostTest.h"
+
+static void testPollTime()
+{
+  HostBee host;
+  uint32_t longestPollUS = 0;
+
+  host.node.joinLatencyMS = 1500;
+  host.node.connectLatencyMS = 50;
+  host.node.serverLatencyMS = 200;
+
+  for (int i = 0; i < 2; i++) {
+    CHECK(host.bee.beginHTTPPost("example.com", 80, "/", "", std::string(600, 'p').c_str()));
+    uint32_t timeMS = timeAsync(host.bee, longestPollUS);
+    CHECK(completionDone && completionResult && completionCode == 200);
+
+    printf("async request in %u ms, longest poll %u us\n", (unsigned)timeMS, (unsigned)longestPollUS);
+
+    // Only the upload, the helper install and a read back take a while
+    CHECK(longestPollUS < 100000);
+  }
+
+  puts("poll time ok");
+}
+
+static void testTimeouts()
+{
+  static const char* const names[] = { "boot", "join", "connect", "server" };
+
+  uint32_t longestPollUS = 0;
+
+  for (int failure = 0; failure < 4; failure++) {
+    HostBee host;
+
+    switch (failure) {
+    case 0:
+      host.node.bootLatencyMS = 60000;
+      break;
+    case 1:
+      host.node.joinLatencyMS = 60000;
+      break;
+    case 2:
+      host.node.connectLatencyMS = 60000;
+      break;
+    case 3:
+      host.node.serverLatencyMS = 60000;
+      break;
+    }
+
+    CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+    uint32_t timeMS = timeAsync(host.bee, longestPollUS);
+    printf("%s timed out after %u ms, longest poll %u us\n", names[failure], (unsigned)timeMS,
+      (unsigned)longestPollUS);
+
+    // It gave up well before the device would have answered. As with a
+    // synchronous request, one which was sent succeeds without a response.
+    CHECK(completionDone && !host.bee.isBusy());
+    if (failure == 3) {
+      CHECK(completionResult && completionCode == 0 && responseBody(host.bee).empty());
+    }
+    else {
+      CHECK(!completionResult);
+    }
+    CHECK(timeMS < 30000 && longestPollUS < 100000);
+    CHECK(!host.onOff.isOn());
+
+    // The next request starts afresh
+    host.node.bootLatencyMS = 300;
+    host.node.joinLatencyMS = 0;
+    host.node.connectLatencyMS = 0;
+    host.node.serverLatencyMS = 0;
+
+    CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+    CHECK(runAsync(host.bee) && completionCode == 200);
+    CHECK(responseBody(host.bee) == "hello");
+  }
+
+  puts("timeouts ok");
+}
+
+// Advances the clock to a second before millis() wraps, after 2^32 ms
+static void advanceToWrap()
+{
+  const uint64_t wrapUS = (1ULL << 32) * 1000;
+
+  HostClock::advance(wrapUS - 1000000 - (HostClock::now() % wrapUS));
+}
+
+static void testClockWrap()
+{
+  HostBee host;
+  uint16_t code = 0;
+
+  host.node.joinLatencyMS = 1500;
+
+  // The requests span the wrap of millis()
+  for (int async = 0; async < 2; async++) {
+    advanceToWrap();
+
+    if (async) {
+      CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+      CHECK(runAsync(host.bee) && completionCode == 200);
+    }
+    else {
+      CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && code == 200);
+    }
+    CHECK(millis() < 10000);
+  }
+
+  // And the time the device is kept on
+  advanceToWrap();
+  host.bee.setPowerPolicy(WIFIBEE_POWER_KEEP_ALIVE, 5000);
+  CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && host.onOff.isOn());
+  delay(2000);
+  host.bee.poll();
+  CHECK(host.onOff.isOn());
+  delay(4000);
+  host.bee.poll();
+  CHECK(!host.onOff.isOn());
+
+  puts("clock wrap ok");
+}
+
+int main()
+{
+  testPollTime();
+  testTimeouts();
+  testClockWrap();
+
+  return 0;
+}
@@ -0,0 +1,93 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The baud rate negotiation: finding the NodeMCU's boot rate, switching
+// to the fastest rate both ends receive without errors, and the requests
+// at that rate.
+
+#include "HostTest.h"
+
+static void testNegotiation()
+{
+  static const uint32_t BOOT_RATES[] = { 9600, 38400, 74880, 115200 };
+  static const uint32_t HOST_MAX_RATES[] = { 230400, 115200, 921600 };
+
+  for (size_t b = 0; b < sizeof(BOOT_RATES) / sizeof(BOOT_RATES[0]); b++) {
+    for (size_t m = 0; m < sizeof(HOST_MAX_RATES) / sizeof(HOST_MAX_RATES[0]); m++) {
+      HostBee host;
+      uint16_t code = 0;
+
+      host.node.bootBaudRate = BOOT_RATES[b];
+      host.node.hostMaxBaudRate = HOST_MAX_RATES[m];
+
+      // The boot rate is unknown, the host starts at the default rate
+      CHECK(host.bee.negotiateBaudRate(host.node));
+      printf("boot %u, host max %u: %u baud, %u bytes/s\n", (unsigned)BOOT_RATES[b],
+        (unsigned)HOST_MAX_RATES[m], (unsigned)host.bee.getBaudRate(), (unsigned)host.bee.getThroughput());
+
+      uint32_t expected = std::max(BOOT_RATES[b], std::min(HOST_MAX_RATES[m], (uint32_t)WIFIBEE_MAX_BAUD_RATE));
+      CHECK(host.bee.getBaudRate() == expected);
+      CHECK(!host.onOff.isOn());
+
+      // The pings at the wrong rates were garbled
+      host.node.clearCounters();
+
+      // Ten bits per byte, the start of the measurement may be late by an idle delay
+      CHECK(host.bee.getThroughput() <= expected / 10 * 105 / 100);
+      CHECK(host.bee.getThroughput() >= expected / 10 * 90 / 100);
+
+      CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && code == 200);
+      CHECK(responseBody(host.bee) == "hello");
+      CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+      CHECK(runAsync(host.bee) && completionCode == 200);
+      CHECK(host.node.unknownLines == 0);
+    }
+  }
+
+  puts("negotiation ok");
+}
+
+static void testMaxRate()
+{
+  HostBee host;
+  uint16_t code = 0;
+
+  host.node.bootBaudRate = 38400;
+
+  // A lower limit set by the sketch, e.g. for a slower host UART
+  CHECK(host.bee.negotiateBaudRate(host.node, 57600));
+  CHECK(host.bee.getBaudRate() == 57600);
+  CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && code == 200);
+
+  // Without a device
+  host.node.bootLatencyMS = 60000;
+  CHECK(!host.bee.negotiateBaudRate(host.node));
+  CHECK(!host.onOff.isOn());
+
+  puts("max rate ok");
+}
+
+int main()
+{
+  testNegotiation();
+  testMaxRate();
+
+  return 0;
+}
@@ -0,0 +1,85 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The Arduino Client adapter
+
+#include "HostTest.h"
+#include "Sodaq_WifiBeeClient.h"
+
+int main()
+{
+  HostBee host;
+  std::string request;
+  std::string answer;
+
+  for (int i = 0; i < 200; i++) {
+    request += (char)('0' + i % 10);
+  }
+  for (int i = 0; i < 300; i++) {
+    answer += (char)('A' + i % 26);
+  }
+
+  // The server answers once the whole request has arrived
+  std::string received;
+  host.node.sendLatencyMS = 30;
+  host.node.server = [&](uint8_t handle, const std::string& payload) {
+    received += payload;
+    return (received.size() == request.size()) ? answer : std::string();
+  };
+
+  Sodaq_WifiBeeClient client(host.bee);
+  CHECK(client.connect(IPAddress(10, 0, 0, 2), 1883) == 1);
+  CHECK(client.connected() && host.node.lastHost == "10.0.0.2");
+
+  // Single byte writes are sent in a few payloads
+  size_t lines = host.node.lines;
+  for (size_t i = 0; i < request.size(); i++) {
+    CHECK(client.write((uint8_t)request[i]) == 1);
+  }
+  printf("client: %u lines for %u single byte writes\n", (unsigned)(host.node.lines - lines),
+    (unsigned)request.size());
+  CHECK(host.node.lines - lines <= 2);
+
+  std::string read;
+  uint32_t startTS = millis();
+  while ((read.size() < answer.size()) && (millis() - startTS < 10000)) {
+    int c = client.read();
+    if (c >= 0) {
+      read += (char)c;
+    }
+    else {
+      delay(1);
+    }
+  }
+  printf("client: %u payloads sent, %u bytes read with %u read backs\n", (unsigned)host.node.payloads,
+    (unsigned)read.size(), (unsigned)host.node.readBacks);
+
+  CHECK(received == request && host.node.payloads == 2);
+  CHECK(read == answer);
+  CHECK(client.available() == 0 && client.read() == -1);
+
+  client.stop();
+  CHECK(!client.connected() && !host.onOff.isOn());
+  CHECK(host.node.unknownLines == 0);
+
+  puts("client ok");
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The connection handles and the HTTP sessions
+
+#include "HostTest.h"
+
+static void testHandles()
+{
+  HostBee host;
+  char buffer[64];
+  size_t length = 0;
+  uint16_t code = 0;
+
+  CHECK(!host.bee.selectConnection(1));
+  CHECK(host.bee.setConnectionBuffer(1, 128) && host.bee.setConnectionBuffer(2, 128));
+
+  host.node.responses[0] = "zero";
+  host.node.responses[1] = "one";
+  host.node.responses[2] = "two";
+
+  CHECK(host.bee.openTCP("a.com", 80));
+  CHECK(host.bee.selectConnection(1) && host.bee.openTCP("b.com", 81));
+  CHECK(host.bee.selectConnection(2) && host.bee.openTCP("c.com", 82));
+  CHECK(host.node.joins == 1 && host.node.isOpen(0) && host.node.isOpen(1) && host.node.isOpen(2));
+
+  // Send on all of them without waiting, then read back each
+  for (uint8_t handle = 0; handle < 3; handle++) {
+    CHECK(host.bee.selectConnection(handle) && host.bee.sendTCPAscii("hi", false));
+  }
+  for (int handle = 2; handle >= 0; handle--) {
+    CHECK(host.bee.selectConnection(handle) && host.bee.readBackResponse());
+    CHECK(host.bee.readResponseAscii(buffer, sizeof(buffer), length));
+    CHECK(std::string(buffer) == host.node.responses[handle]);
+  }
+
+  // Each handle keeps its own buffer
+  CHECK(host.bee.selectConnection(1) && host.bee.sendTCPAscii("x", true));
+  CHECK(host.bee.selectConnection(2) && host.bee.sendTCPAscii("y", true));
+  CHECK(host.bee.selectConnection(1));
+  CHECK(host.bee.readResponseAscii(buffer, sizeof(buffer), length) && std::string(buffer) == "one");
+
+  // The device stays on while any connection is open
+  CHECK(host.bee.selectConnection(0) && host.bee.closeTCP() && host.onOff.isOn());
+  host.node.responses.erase(0);
+  CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && code == 200 && host.onOff.isOn());
+
+  CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+  CHECK(!host.bee.selectConnection(1));
+  CHECK(runAsync(host.bee) && completionCode == 200 && host.onOff.isOn());
+  CHECK(host.node.joins == 1);
+
+  CHECK(host.bee.selectConnection(1) && host.bee.closeTCP() && host.onOff.isOn());
+  CHECK(host.bee.selectConnection(2) && host.bee.closeTCP() && !host.onOff.isOn());
+
+  CHECK(host.node.unknownLines == 0);
+
+  puts("handles ok");
+}
+
+static void testSessionGuard()
+{
+  HostBee host;
+  uint16_t code = 0;
+
+  CHECK(host.bee.openHTTPSession("a.com", 80));
+  CHECK(!host.bee.HTTPGet("b.com", 80, "/", "", code) && host.onOff.isOn());
+  CHECK(!host.bee.beginHTTPGet("b.com", 80, "/", ""));
+
+  size_t connects = host.node.connects;
+  CHECK(host.bee.HTTPGet("a.com", 80, "/", "", code) && code == 200 && host.onOff.isOn());
+  CHECK(host.bee.HTTPGet("a.com", 80, "/", "", code) && code == 200);
+  CHECK(host.node.connects == connects);
+  CHECK(host.node.lastPayload.find("Connection: keep-alive\r\n") != std::string::npos);
+
+  CHECK(host.bee.closeHTTPSession() && !host.onOff.isOn());
+  CHECK(host.bee.HTTPGet("b.com", 80, "/", "", code) && code == 200);
+
+  CHECK(host.bee.openTCP("c.com", 80));
+  CHECK(!host.bee.openTCP("d.com", 80) && !host.bee.openHTTPSession("d.com", 80));
+  CHECK(host.bee.closeTCP());
+
+  puts("session guard ok");
+}
+
+static void testSessionRejoin()
+{
+  HostBee host;
+  uint16_t code = 0;
+
+  CHECK(host.bee.openHTTPSession("a.com", 80));
+
+  // The access point is lost, the session's connection with it
+  for (int async = 0; async < 2; async++) {
+    size_t joins = host.node.joins;
+    host.node.dropNetwork();
+    delay(1);  // The events have arrived before the request
+
+    if (async) {
+      CHECK(host.bee.beginHTTPGet("a.com", 80, "/", ""));
+      CHECK(runAsync(host.bee) && completionCode == 200);
+    }
+    else {
+      CHECK(host.bee.HTTPGet("a.com", 80, "/", "", code) && code == 200);
+    }
+
+    CHECK(host.node.joins == joins + 1 && host.onOff.isOn());
+  }
+
+  CHECK(host.bee.closeHTTPSession());
+
+  puts("session rejoin ok");
+}
+
+int main()
+{
+  testHandles();
+  testSessionGuard();
+  testSessionRejoin();
+
+  return 0;
+}
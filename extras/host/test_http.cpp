@@ -0,0 +1,225 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The HTTP, TCP and UDP requests, synchronous and asynchronous
+
+#include "HostTest.h"
+
+static void testSyncRequests()
+{
+  HostBee host;
+  uint16_t code = 0;
+
+  CHECK(host.bee.HTTPGet("example.com", 80, "/get", "", code));
+  CHECK(code == 200 && responseBody(host.bee) == "hello");
+  CHECK(host.node.lastPayload.find("GET /get HTTP/1.1\r\n") == 0);
+  CHECK(host.node.lastPayload.find("example.com") != std::string::npos);
+  CHECK(host.node.installs == 1 && host.node.joins == 1);
+  CHECK(!host.onOff.isOn());
+
+  CHECK(host.bee.HTTPPost("example.com", 80, "/post", "Accept: */*\r\n", "a\"b\\c[d]", code));
+  CHECK(code == 200 && responseBody(host.bee) == "hello");
+  CHECK(host.node.lastPayload.find("POST /post HTTP/1.1\r\n") == 0);
+  CHECK(host.node.lastPayload.find("\r\n\r\na\"b\\c[d]") != std::string::npos);
+
+  CHECK(host.bee.HTTPPut("example.com", 80, "/put", "", "x=1", code));
+  CHECK(code == 200 && host.node.lastPayload.find("PUT /put HTTP/1.1\r\n") == 0);
+
+  // The helper is only installed once
+  CHECK(host.node.installs == 1 && host.node.unknownLines == 0);
+
+  host.node.response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+  CHECK(host.bee.HTTPGet("example.com", 80, "/missing", "", code));
+  CHECK(code == 404);
+
+  puts("sync requests ok");
+}
+
+static void testTCPAndUDP()
+{
+  HostBee host;
+  uint8_t data[256];
+  char buffer[64];
+  size_t length = 0;
+
+  for (int i = 0; i < 256; i++) {
+    data[i] = i;
+  }
+
+  host.node.response = "xyz";
+  CHECK(host.bee.openTCP("example.com", 80));
+  CHECK(host.bee.sendTCPBinary(data, sizeof(data), true));
+  CHECK(host.node.lastPayload == std::string((char*)data, sizeof(data)));
+  CHECK(host.bee.readResponseAscii(buffer, sizeof(buffer), length) && std::string(buffer) == "xyz");
+  CHECK(host.bee.sendTCPAscii("hello\r\n", true));
+  CHECK(host.node.lastPayload == "hello\r\n");
+  CHECK(host.bee.closeTCP() && !host.onOff.isOn());
+
+  CHECK(host.bee.openUDP("example.com", 5000));
+  CHECK(host.bee.sendUDPAscii("ping", true));
+  CHECK(host.node.lastPayload == "ping");
+  CHECK(host.bee.readResponseAscii(buffer, sizeof(buffer), length) && std::string(buffer) == "xyz");
+  CHECK(host.bee.closeUDP());
+
+  CHECK(host.node.unknownLines == 0);
+
+  puts("tcp and udp ok");
+}
+
+static void testAsyncRequests()
+{
+  HostBee host;
+
+  CHECK(host.bee.beginHTTPGet("example.com", 80, "/get", ""));
+  CHECK(host.bee.isBusy());
+  CHECK(runAsync(host.bee) && completionCode == 200);
+  CHECK(responseBody(host.bee) == "hello");
+  CHECK(host.node.installs == 1 && !host.onOff.isOn());
+
+  CHECK(host.bee.beginHTTPPost("example.com", 80, "/post", "", "a=1"));
+  CHECK(runAsync(host.bee) && completionCode == 200);
+  CHECK(host.node.lastPayload.find("\r\n\r\na=1") != std::string::npos);
+
+  CHECK(host.bee.beginHTTPPut("example.com", 80, "/put", "", "b=2"));
+  CHECK(runAsync(host.bee) && completionCode == 200);
+
+  // Only one request at a time
+  CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+  CHECK(!host.bee.beginHTTPGet("example.com", 80, "/", ""));
+  CHECK(runAsync(host.bee));
+
+  CHECK(host.node.unknownLines == 0);
+
+  puts("async requests ok");
+}
+
+static void testReadBackModes()
+{
+  HostBee host(1024);
+  uint16_t code = 0;
+  std::string body;
+
+  for (int i = 0; i < 300; i++) {
+    body += (char)('A' + i % 26);
+  }
+  host.node.response = "HTTP/1.1 200 OK\r\nContent-Length: 300\r\n\r\n" + body;
+
+  // HEX and raw, with and without the status events
+  for (int mode = 0; mode < 4; mode++) {
+    host.bee.setRawReadBack(mode & 1);
+    host.bee.setStatusEvents(mode & 2);
+
+    CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code));
+    CHECK(code == 200 && responseBody(host.bee) == body);
+
+    CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+    CHECK(runAsync(host.bee) && completionCode == 200);
+    CHECK(responseBody(host.bee) == body);
+  }
+
+  CHECK(host.node.unknownLines == 0);
+
+  puts("read back modes ok");
+}
+
+static void testEchoOff()
+{
+  HostBee host;
+  uint16_t code = 0;
+
+  host.bee.setBaudRate(57600);
+  host.bee.setEcho(false);
+
+  CHECK(host.bee.HTTPPost("example.com", 80, "/post", "", "a=1", code));
+  CHECK(code == 200 && responseBody(host.bee) == "hello");
+
+  CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+  CHECK(runAsync(host.bee) && completionCode == 200);
+  CHECK(responseBody(host.bee) == "hello");
+
+  CHECK(host.node.unknownLines == 0);
+
+  puts("echo off ok");
+}
+
+static void testIncompleteResponses()
+{
+  HostBee host;
+  uint16_t code = 0;
+
+  // More than the NodeMCU's receive queue, the rest is dropped
+  host.node.response = "HTTP/1.1 200 OK\r\nContent-Length: 5000\r\n\r\n" + std::string(5000, 'z');
+
+  for (int raw = 0; raw < 2; raw++) {
+    host.bee.setRawReadBack(raw);
+    host.bee.resetStats();
+
+    // The packets which don't fit are dropped, the rest is read back
+    CHECK(!host.bee.HTTPGet("example.com", 80, "/", "", code));
+    uint32_t dropped = host.bee.getStats().bytesDropped;
+    CHECK(dropped > 0 && host.node.response.size() - dropped <= host.node.receiveQueueMax);
+
+    CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+    CHECK(!runAsync(host.bee) && completionDone);
+    CHECK(host.bee.getStats().bytesDropped == 2 * dropped);
+  }
+
+  // Shorter than its Content-Length
+  host.node.response = "HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nhello";
+  CHECK(!host.bee.HTTPGet("example.com", 80, "/", "", code) && code == 200);
+
+  host.node.response = "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+  CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && code == 200);
+
+  puts("incomplete responses ok");
+}
+
+static void testConnectFailure()
+{
+  HostBee host;
+  uint16_t code = 0;
+
+  host.node.failConnects = 1;
+  CHECK(!host.bee.HTTPGet("example.com", 80, "/", "", code));
+  CHECK(host.node.failConnects == 0);
+
+  host.node.failConnects = 1;
+  CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+  CHECK(!runAsync(host.bee) && completionDone);
+  CHECK(!host.onOff.isOn());
+
+  host.node.failConnects = 0;
+  CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && code == 200);
+
+  puts("connect failure ok");
+}
+
+int main()
+{
+  testSyncRequests();
+  testTCPAndUDP();
+  testAsyncRequests();
+  testReadBackModes();
+  testEchoOff();
+  testIncompleteResponses();
+  testConnectFailure();
+
+  return 0;
+}
@@ -0,0 +1,132 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The MQTT client against the mock broker
+
+#include "HostTest.h"
+#include "MockBroker.h"
+#include "Sodaq_WifiBeeMQTT.h"
+
+static void testPublish()
+{
+  HostBee host;
+  MockBroker broker;
+  Sodaq_WifiBeeMQTT mqtt(host.bee);
+  uint8_t binary[300];
+
+  host.node.server = broker.server();
+
+  for (size_t i = 0; i < sizeof(binary); i++) {
+    binary[i] = i;
+  }
+
+  mqtt.setServer("broker.local", 1883);
+  CHECK(!mqtt.publish("t", "x"));
+  CHECK(!mqtt.connect("bee1", NULL, "pass"));
+
+  CHECK(mqtt.connect("bee1", "user", "pass") && mqtt.isConnected());
+  CHECK(broker.connects == 1 && broker.clientId == "bee1");
+  CHECK(broker.username == "user" && broker.password == "pass");
+  CHECK(broker.keepAlive == WIFIBEE_MQTT_DEFAULT_KEEP_ALIVE);
+  CHECK(host.node.lastHost == "broker.local");
+
+  CHECK(mqtt.publish("wifibee/t", "21.5"));
+  CHECK(mqtt.publish("wifibee/h", "60", 1, true));
+  CHECK(mqtt.publish("wifibee/b", binary, sizeof(binary), 1));
+  CHECK(!mqtt.publish("wifibee/t", "x", 2));
+  CHECK(mqtt.flush() && mqtt.getInFlight() == 0);
+
+  CHECK(broker.messages.size() == 3 && broker.errors == 0);
+  CHECK(broker.messages[0].topic == "wifibee/t" && broker.messages[0].payload == "21.5");
+  CHECK(broker.messages[0].qos == 0 && !broker.messages[0].retain);
+  CHECK(broker.messages[1].payload == "60" && broker.messages[1].qos == 1 && broker.messages[1].retain);
+  CHECK(broker.messages[2].payload == std::string((char*)binary, sizeof(binary)));
+
+  // A topic too long to encode is refused before anything is written
+  CHECK(!mqtt.publish(std::string(65536, 't').c_str(), "x"));
+  CHECK(mqtt.isConnected() && mqtt.publish("wifibee/t", "22") && mqtt.flush());
+  CHECK(broker.messages.size() == 4 && broker.errors == 0);
+
+  // A packet which fails part way closes the session, it isn't left in flight
+  std::string large(4000, 'x');
+  host.node.powerOff();
+  CHECK(!mqtt.publish("wifibee/b", (const uint8_t*)large.data(), large.size(), 1));
+  CHECK(!mqtt.isConnected() && mqtt.getInFlight() == 0);
+  CHECK(mqtt.connect("bee1", "user", "pass"));
+
+  mqtt.disconnect();
+  CHECK(!mqtt.isConnected() && broker.disconnects == 1);
+  CHECK(!host.onOff.isOn());
+
+  // Refused by the broker
+  broker.connectReturnCode = 5;
+  CHECK(!mqtt.connect("bee1") && !mqtt.isConnected());
+  CHECK(!host.node.isOpen(0));
+
+  CHECK(host.node.unknownLines == 0);
+
+  puts("publish ok");
+}
+
+static void testKeepAlive()
+{
+  HostBee host;
+  MockBroker broker;
+  Sodaq_WifiBeeMQTT mqtt(host.bee);
+
+  host.node.server = broker.server();
+
+  mqtt.setServer("broker.local", 1883);
+  mqtt.setKeepAlive(1);
+  CHECK(mqtt.connect("bee1") && broker.keepAlive == 1);
+
+  CHECK(mqtt.loop() && broker.pings == 0);
+  delay(1100);
+  CHECK(mqtt.loop() && broker.pings == 1);
+  delay(200);
+  CHECK(mqtt.loop());
+  delay(900);
+  CHECK(mqtt.loop() && broker.pings == 2);
+
+  // Unacknowledged messages fill the window, then the session is closed
+  broker.dropAcks = true;
+  for (int i = 0; i < WIFIBEE_MQTT_IN_FLIGHT; i++) {
+    CHECK(mqtt.publish("wifibee/t", "x", 1));
+  }
+  CHECK(!mqtt.publish("wifibee/t", "x", 1));
+  CHECK(!mqtt.isConnected() && mqtt.getInFlight() == WIFIBEE_MQTT_IN_FLIGHT);
+
+  // A new session starts afresh
+  broker.dropAcks = false;
+  CHECK(mqtt.connect("bee1") && mqtt.getInFlight() == 0);
+  CHECK(mqtt.publish("wifibee/t", "y", 1) && mqtt.flush());
+  CHECK(broker.messages.back().payload == "y" && broker.errors == 0);
+  mqtt.disconnect();
+
+  puts("keep alive ok");
+}
+
+int main()
+{
+  testPublish();
+  testKeepAlive();
+
+  return 0;
+}
@@ -0,0 +1,176 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The power policies and the fast join
+
+#include "HostTest.h"
+
+static void testPowerPolicies()
+{
+  static const char* const names[] = { "off", "keep alive", "modem sleep", "deep sleep" };
+
+  // The joins of each request, the first one follows the previous policy
+  static const size_t JOINS[][3] = { { 1, 1, 1 }, { 1, 0, 0 }, { 0, 0, 0 }, { 0, 1, 0 } };
+
+  HostBee host;
+  uint16_t code = 0;
+
+  host.node.joinLatencyMS = 1500;
+
+  for (uint8_t policy = WIFIBEE_POWER_OFF; policy <= WIFIBEE_POWER_DEEP_SLEEP; policy++) {
+    host.bee.setPowerPolicy(policy, (policy == WIFIBEE_POWER_DEEP_SLEEP) ? 10000 : 0);
+
+    for (int i = 0; i < 3; i++) {
+      // The deep sleep has ended before the last request
+      if ((policy == WIFIBEE_POWER_DEEP_SLEEP) && (i == 2)) {
+        delay(20000);
+      }
+
+      size_t joins = host.node.joins;
+      size_t lines = host.node.lines;
+
+      CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && code == 200);
+      printf("%s #%d: wake %u ms, %u joins, %u lines\n", names[policy], i,
+        (unsigned)host.bee.getWakeLatency(), (unsigned)(host.node.joins - joins),
+        (unsigned)(host.node.lines - lines));
+
+      // Only a device which was kept on is still joined
+      CHECK((host.node.joins - joins) == JOINS[policy][i]);
+      CHECK(host.onOff.isOn() == (policy != WIFIBEE_POWER_OFF));
+    }
+
+    CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+    CHECK(runAsync(host.bee) && completionCode == 200);
+  }
+
+  CHECK(host.node.sleepCommands > 0);
+
+  // The device kept on is switched off once the time has passed
+  host.bee.setPowerPolicy(WIFIBEE_POWER_KEEP_ALIVE, 5000);
+  CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && host.onOff.isOn());
+  delay(6000);
+  host.bee.poll();
+  CHECK(!host.onOff.isOn());
+
+  CHECK(host.node.unknownLines == 0);
+
+  puts("power policies ok");
+}
+
+static void testDeepSleep()
+{
+  HostBee host;
+  uint16_t code = 0;
+  uint32_t wakeLatency[4];
+
+  host.node.joinLatencyMS = 1500;
+  host.bee.setPowerPolicy(WIFIBEE_POWER_DEEP_SLEEP, 10000);
+
+  // The first request boots and joins, each next one follows a deep sleep
+  // from which the device restarts and rejoins by itself
+  for (int i = 0; i < 4; i++) {
+    size_t joins = host.node.joins;
+
+    if (i < 3) {
+      CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && code == 200);
+    }
+    else {
+      CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+      CHECK(runAsync(host.bee) && completionCode == 200);
+    }
+
+    wakeLatency[i] = host.bee.getWakeLatency();
+    printf("deep sleep cycle #%d: wake %u ms, %u joins\n", i, (unsigned)wakeLatency[i],
+      (unsigned)(host.node.joins - joins));
+
+    CHECK((host.node.joins - joins) == ((i == 0) ? 1 : 0));
+    CHECK(host.onOff.isOn());
+
+    delay(10000);
+  }
+
+  // The wakes take as long each time, less than the first boot and join
+  for (int i = 2; i < 4; i++) {
+    CHECK(abs((int32_t)(wakeLatency[i] - wakeLatency[1])) < 100);
+  }
+  CHECK(wakeLatency[1] < wakeLatency[0]);
+  CHECK(host.node.unknownLines == 0);
+
+  puts("deep sleep ok");
+}
+
+static void testFastJoin()
+{
+  HostBee host;
+  uint16_t code = 0;
+
+  host.bee.setFastJoin(true);
+
+  // The first join caches the access point, the next ones use it
+  for (int i = 0; i < 3; i++) {
+    if (i == 2) {
+      host.node.failFastJoin = true;
+    }
+
+    CHECK(host.bee.HTTPGet("example.com", 80, "/", "", code) && code == 200);
+    CHECK(host.node.fastJoins == (size_t)i);
+  }
+
+  // The failed fast join was followed by a full one, which cached it again
+  CHECK(host.bee.getStats().fastJoins == 1 && host.bee.getStats().fastJoinFailures == 1);
+  CHECK(host.bee.getJoinCache().valid);
+  CHECK(host.bee.getJoinCache().bssid[0] == 0x0a && host.bee.getJoinCache().ip[3] == 5);
+  CHECK(host.node.lastJoin.find("0a:bb:cc:dd:ee:ff") == std::string::npos);
+
+  host.node.failFastJoin = false;
+  host.bee.setStatusEvents(true);
+
+  // The details are read again after the failed fast join, without
+  // poll() waiting for them
+  host.node.lineLatencyMS = 50;
+
+  for (int i = 0; i < 2; i++) {
+    if (i == 1) {
+      host.node.failFastJoin = true;
+    }
+
+    uint32_t longestPollUS = 0;
+    CHECK(host.bee.beginHTTPGet("example.com", 80, "/", ""));
+    timeAsync(host.bee, longestPollUS);
+    CHECK(completionDone && completionResult && completionCode == 200);
+    CHECK(longestPollUS < 50000);
+  }
+
+  CHECK(host.bee.getJoinCache().valid && host.bee.getJoinCache().bssid[5] == 0xff);
+
+  CHECK(host.bee.getStats().fastJoins == 2 && host.bee.getStats().fastJoinFailures == 2);
+  CHECK(host.node.unknownLines == 0);
+
+  puts("fast join ok");
+}
+
+int main()
+{
+  testPowerPolicies();
+  testDeepSleep();
+  testFastJoin();
+
+  return 0;
+}
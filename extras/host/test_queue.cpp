@@ -0,0 +1,168 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The RAM store and the store and forward queue
+
+#include "HostTest.h"
+#include "Sodaq_WifiBeeQueue.h"
+
+#define RECORD_COUNT 60
+
+static const char OK_RESPONSE[] = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+static const char ERROR_RESPONSE[] = "HTTP/1.1 500 Error\r\nContent-Length: 0\r\n\r\n";
+
+static std::string record(const int i)
+{
+  char buffer[32];
+
+  sprintf(buffer, "t=21.5,seq=%03d", i);
+
+  return buffer;
+}
+
+// The bodies of the POST requests sent, one after another
+static std::string postedBodies(const std::string& sent)
+{
+  std::string bodies;
+  size_t start = 0;
+
+  while ((start = sent.find("\r\n\r\n", start)) != std::string::npos) {
+    start += 4;
+    size_t end = sent.find("POST ", start);
+    bodies += sent.substr(start, (end == std::string::npos) ? std::string::npos : end - start);
+  }
+
+  return bodies;
+}
+
+static void testRAMStore()
+{
+  uint8_t ring[20];
+  Sodaq_WifiBeeRAMStore store(ring, sizeof(ring));
+  uint8_t buffer[16];
+  size_t length = 0;
+
+  // The records wrap around the end of the ring
+  for (int i = 0; i < 50; i++) {
+    std::string text = record(i).substr(7);
+
+    CHECK(store.append((const uint8_t*)text.data(), 4) && store.append((const uint8_t*)text.data(), 4));
+    CHECK(store.count() == 2);
+    CHECK(store.read(1, buffer, sizeof(buffer), length) && length == 4 && memcmp(buffer, text.data(), 4) == 0);
+    CHECK(store.remove(1));
+
+    // Too small a buffer reports the length
+    CHECK(!store.read(0, buffer, 3, length) && length == 4);
+
+    if (i % 3 == 0) {
+      // Full, with the length prefixes
+      CHECK(store.append((const uint8_t*)"abcdefghij", 10) && !store.append((const uint8_t*)"x", 1));
+      CHECK(store.read(1, buffer, sizeof(buffer), length) && length == 10);
+      CHECK(store.remove(2));
+    }
+    else {
+      CHECK(store.remove(1));
+    }
+  }
+
+  CHECK(store.count() == 0 && !store.remove(1) && !store.read(0, buffer, sizeof(buffer), length));
+
+  // Reads in any order, the cursor follows appends and removes
+  static const char* const TEXTS[] = { "a", "bb", "ccc" };
+  static const size_t ORDER[] = { 2, 0, 1, 1, 2 };
+
+  for (size_t i = 0; i < 3; i++) {
+    CHECK(store.append((const uint8_t*)TEXTS[i], strlen(TEXTS[i])));
+  }
+  for (size_t i = 0; i < sizeof(ORDER) / sizeof(ORDER[0]); i++) {
+    CHECK(store.read(ORDER[i], buffer, sizeof(buffer), length));
+    CHECK(std::string((char*)buffer, length) == TEXTS[ORDER[i]]);
+  }
+  CHECK(store.remove(1) && store.append((const uint8_t*)"dddd", 4));
+  CHECK(store.read(0, buffer, sizeof(buffer), length) && std::string((char*)buffer, length) == "bb");
+  CHECK(store.read(2, buffer, sizeof(buffer), length) && std::string((char*)buffer, length) == "dddd");
+  CHECK(store.remove(3) && store.count() == 0);
+
+  puts("ram store ok");
+}
+
+static void testQueue()
+{
+  HostBee host;
+  uint8_t storage[1024];
+  Sodaq_WifiBeeRAMStore store(storage, sizeof(storage));
+  Sodaq_WifiBeeQueue queue(host.bee, store);
+  std::string expected;
+
+  // Nothing to forward
+  CHECK(queue.forward() && queue.getBatches() == 0 && host.node.lines == 0);
+
+  // Adding doesn't use the device
+  for (int i = 0; i < RECORD_COUNT; i++) {
+    CHECK(queue.add(record(i).c_str()));
+    expected += record(i) + "\n";
+  }
+  CHECK(host.node.lines == 0 && queue.getCount() == RECORD_COUNT && !queue.add(""));
+
+  // Without a target
+  CHECK(!queue.forward() && host.node.lines == 0);
+  queue.setTarget("example.com", 80, "/t");
+
+  // The server refuses, the records stay queued
+  host.node.response = ERROR_RESPONSE;
+  CHECK(!queue.forward() && queue.getCount() == RECORD_COUNT && queue.getForwarded() == 0);
+  CHECK(!host.onOff.isOn());
+
+  // The server accepts the first request only, the rest is sent later
+  int requests = 0;
+  host.node.server = [&requests](uint8_t handle, const std::string& payload) {
+    return std::string((requests++ == 0) ? OK_RESPONSE : ERROR_RESPONSE);
+  };
+  host.node.clearCounters();
+  CHECK(!queue.forward());
+  size_t forwarded = queue.getForwarded();
+  CHECK(forwarded > 0 && queue.getCount() == RECORD_COUNT - forwarded);
+  std::string sent = host.node.sent;
+
+  host.node.server = FakeServer();
+  host.node.response = OK_RESPONSE;
+  host.node.clearCounters();
+  CHECK(queue.forward());
+  CHECK(queue.getCount() == 0 && queue.getForwarded() == RECORD_COUNT - forwarded);
+  CHECK(host.node.joins == 1 && queue.getBatches() <= 3 && !host.onOff.isOn());
+
+  // Each record is accepted once, in order (they are all the same length)
+  size_t accepted = forwarded * (record(0).size() + 1);
+  CHECK(postedBodies(sent).compare(0, accepted, expected, 0, accepted) == 0);
+  CHECK(postedBodies(host.node.sent) == expected.substr(accepted));
+
+  CHECK(queue.forward() && queue.getBatches() == 0);
+  CHECK(host.node.unknownLines == 0);
+
+  puts("queue ok");
+}
+
+int main()
+{
+  testRAMStore();
+  testQueue();
+
+  return 0;
+}
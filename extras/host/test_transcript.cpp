@@ -0,0 +1,109 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+// The transcript recording and replay
+
+#include "HostTest.h"
+#include "Sodaq_WifiBeeTranscript.h"
+
+/*!
+ * \brief A stream which reads back what was written to it.
+ */
+class MemoryStream : public Stream
+{
+public:
+  MemoryStream() : _position(0) {}
+
+  size_t write(uint8_t c) { _data += (char)c; return 1; }
+  int available() { return _data.size() - _position; }
+  int read() { return (_position < _data.size()) ? (uint8_t)_data[_position++] : -1; }
+  int peek() { return (_position < _data.size()) ? (uint8_t)_data[_position] : -1; }
+  void flush() {}
+
+  void rewind() { _position = 0; }
+  size_t size() { return _data.size(); }
+
+private:
+  std::string _data;
+  size_t _position;
+};
+
+int main()
+{
+  MemoryStream log;
+  FakeNodeMCU node;
+  FakeOnOff onOff(node);
+  uint16_t code = 0;
+  std::string body(2000, 'x');
+
+  // Record a request
+  Sodaq_WifiBeeRecorder recorder;
+  recorder.begin(node, log);
+
+  Sodaq_WifiBee bee;
+  bee.init(recorder, -1, -1, -1, 256);
+  bee.connectionSettings("ssid", "", "pw");
+  bee.setOnOff(onOff);
+
+  // The join then ends with an event, not after a fixed delay, which a
+  // replay can't speed up
+  bee.setStatusEvents(true);
+
+  uint32_t startTS = millis();
+  CHECK(bee.HTTPPost("example.com", 80, "/post", "", body.c_str(), code) && code == 200);
+  uint32_t recordedMS = millis() - startTS;
+  recorder.end();
+
+  printf("transcript of %u bytes, for %u written and %u read\n", (unsigned)log.size(),
+    (unsigned)node.bytesFromHost, (unsigned)node.bytesToHost);
+
+  // Replay it, in real time and four times faster
+  for (uint8_t speedUp = 1; speedUp <= 4; speedUp *= 4) {
+    log.rewind();
+
+    Sodaq_WifiBeeReplay replay;
+    CHECK(replay.begin(log, speedUp));
+
+    FakeNodeMCU unused;
+    FakeOnOff unusedOnOff(unused);
+
+    Sodaq_WifiBee replayed;
+    replayed.init(replay, -1, -1, -1, 256);
+    replayed.connectionSettings("ssid", "", "pw");
+    replayed.setOnOff(unusedOnOff);
+    replayed.setStatusEvents(true);
+
+    code = 0;
+    startTS = millis();
+    CHECK(replayed.HTTPPost("example.com", 80, "/post", "", body.c_str(), code) && code == 200);
+    uint32_t replayedMS = millis() - startTS;
+    printf("replayed with speed up %u in %u ms (recorded in %u ms)\n", (unsigned)speedUp,
+      (unsigned)replayedMS, (unsigned)recordedMS);
+    CHECK(replay.getMismatches() == 0 && replay.isFinished());
+
+    // It takes as long as the recording, the UART time included, or a
+    // quarter of that
+    CHECK(abs((int32_t)(replayedMS * speedUp - recordedMS)) < (int32_t)(recordedMS / 10));
+  }
+
+  puts("transcript ok");
+
+  return 0;
+}
@@ -20,9 +20,7 @@
 
 #include "Sodaq_WifiBee.h"
 
-#define ENABLE_RADIO_DIAG 1
-
-#if ENABLE_RADIO_DIAG
+#if WIFIBEE_DIAG_LEVEL >= 1
 #define diagPrint(...) { if (_diagStream) _diagStream->print(__VA_ARGS__); }
 #define diagPrintLn(...) { if (_diagStream) _diagStream->println(__VA_ARGS__); }
 #else
@@ -30,12 +28,32 @@
 #define diagPrintLn(...)
 #endif
 
+// The data received, one character at a time
+#if WIFIBEE_DIAG_LEVEL >= 2
+#define diagData(...) { if (_diagStream) _diagStream->print(__VA_ARGS__); }
+#else
+#define diagData(...) { (void)(__VA_ARGS__); }
+#endif
+
 // Lua command size limit 
 // Cannot be set to < 13
 #define LUA_COMMAND_MAX 255
 
+// Send buffer upload lines, sb=sb.."<data>"
+// The data ends before UPLOAD_DATA_END, leaving room for the closing quote
+// The line buffer also has room for the line ending, and an escape sequence
+#define UPLOAD_PREFIX "sb=sb..\""
+#define UPLOAD_PREFIX_LENGTH 8
+#define UPLOAD_START "sb=\"" // The first line of a streamed payload, replacing the send buffer
+#define UPLOAD_START_LENGTH 4
+#define UPLOAD_SUFFIX "\"\r\n"
+#define UPLOAD_SUFFIX_LENGTH 3
+#define UPLOAD_DATA_END (LUA_COMMAND_MAX - 1)
+#define UPLOAD_LINE_SIZE (LUA_COMMAND_MAX + 3)
+
 // Lua prompts
-#define LUA_PROMPT "\r\n> "
+#define LUA_PROMPT "\n> " // An event may split the echoed "\r\n", e.g. "\r|DS|\r\n\n> "
+#define NO_ECHO_PROMPT "> " // Without the echo the line ending isn't received
 #define OK_PROMPT "OK\r\n> "
 #define CONNECT_PROMPT "|C|"
 #define RECONNECT_PROMPT "|RC|"
@@ -43,14 +61,176 @@
 #define SENT_PROMPT "|DS|"
 #define RECEIVED_PROMPT "|DR|"
 #define STATUS_PROMPT "|STS|"
+#define NETWORK_PROMPT "|NET|"
 #define SOF_PROMPT "|SOF|"
 #define EOF_PROMPT "|EOF|" // Cannot start with a HEX character (0..9, A..F)
-
-// Lua connection callback scripts
+#define HELPER_PROMPT "|WB|\r\n> "
+#define NO_HELPER_PROMPT "|NWB|\r\n> "
+#define EOF_NO_ECHO_PROMPT EOF_PROMPT NO_ECHO_PROMPT // Includes the prompt which follows
+#define HEADER_END "\r\n\r\n" // Ends an HTTP header
+#define MAX_PROMPT_LENGTH 10 // The most characters in a prompt which is matched
+
+// The fall back table of HEADER_END, see preparePrompt()
+static const uint8_t HEADER_END_FALLBACK[] = { 0, 0, 1, 2 };
+
+// Lua prompt sets, matched in a single pass by skipTillEvent()
+// The first entry is the expected event, the others end the wait early
+#define MAX_EVENT_PROMPTS 4
+static const char* const CONNECT_EVENTS[] = { CONNECT_PROMPT, DISCONNECT_PROMPT, RECONNECT_PROMPT };
+static const char* const SENT_EVENTS[] = { SENT_PROMPT, DISCONNECT_PROMPT };
+static const char* const RECEIVED_EVENTS[] = { RECEIVED_PROMPT, DISCONNECT_PROMPT };
+static const char* const LUA_EVENTS[] = { LUA_PROMPT };
+static const char* const NO_ECHO_EVENTS[] = { NO_ECHO_PROMPT };
+static const char* const OK_EVENTS[] = { OK_PROMPT };
+static const char* const STATUS_EVENTS[] = { STATUS_PROMPT };
+static const char* const NETWORK_EVENTS[] = { NETWORK_PROMPT };
+static const char* const SOF_EVENTS[] = { SOF_PROMPT };
+static const char* const EOF_EVENTS[] = { EOF_PROMPT };
+static const char* const EOF_NO_ECHO_EVENTS[] = { EOF_NO_ECHO_PROMPT };
+static const char* const DISCONNECT_EVENTS[] = { DISCONNECT_PROMPT };
+static const char* const HELPER_EVENTS[] = { HELPER_PROMPT, NO_HELPER_PROMPT };
+#define EVENT_COUNT(X) (sizeof(X) / sizeof(X[0]))
+
+// The prompts of the selected connection, with their count
+// The prompts of connections other than 0 are tagged with the handle, e.g. "|DS2|"
+#define CONNECTION_EVENTS(X) connectionEvents(X, EVENT_COUNT(X)), EVENT_COUNT(X)
+#define DISCONNECT_PREFIX_LENGTH 3 // "|DC", followed by any handle
+
+// The maximum number of received bytes queued on the NodeMCU for each
+// connection until they are read back, further packets are dropped
+#define RECEIVE_QUEUE_MAX "4096"
+
+// Where the firmware supports it, the connection is held (the TCP window
+// closes) while this many bytes are queued, until they are read back
+#define RECEIVE_QUEUE_HOLD "2048"
+
+// Lua commands
 #define OK_COMMAND "uart.write(0, \"OK\\r\\n\")"
-#define RECEIVED_CALLBACK "function(s, d) if lastData==nil then lastData=d end print(d:len()..\"|DR|\") end" // Max length 231
-#define STATUS_CALLBACK "print(\"|\" .. \"STS|\" .. wifi.sta.status() .. \"|\")" // Max length 255
-#define READ_BACK "uart.write(0, \"|\" .. \"SOF|\") for i=1, lastData:len(), 1 do uart.write(0, string.format(\"%02X\", lastData:byte(i))) tmr.wdclr() end lastData=nil uart.write(0, \"|EOF|\")" // Max length 255
+#define MODEM_SLEEP_COMMAND "wifi.setsleeptype(wifi.MODEM_SLEEP)"
+#define NO_SLEEP_COMMAND "wifi.setsleeptype(wifi.NONE_SLEEP) " OK_COMMAND
+#define STATUS_CALLBACK "wb.t()"
+#define NETWORK_COMMAND "wb.q()"
+#define STATUS_EVENTS_STOP "wb.e()"
+
+// Lua connection commands, completed with the handle by sendConnectionCommand()
+#define READ_BACK_RAW "wb.r("
+#define READ_BACK "wb.x("
+#define SEND_COMMAND "wb.s("
+#define QUEUE_COMMAND "wb.a("
+#define CLOSE_COMMAND "wb.c("
+
+// The bytes reported by NETWORK_COMMAND: the IP address, netmask, gateway (4 each) and BSSID (6)
+#define NETWORK_BYTES 18
+
+// The helper script which is installed on the NodeMCU file system.
+// It defines the `wb` table, so that every later operation is a single
+// short call, instead of resending the callbacks and scripts each time.
+// Change HELPER_VERSION whenever the script changes, to reinstall it.
+// Each line is written with file.writeline([==[ ]==]), max length 231
+#define HELPER_FILE "wifibee.lua"
+#define HELPER_VERSION "6"
+static const char* const HELPER_SCRIPT[] = {
+  // Version, the connections, their received data queues (wr bytes, wd dropped) and send queues (sx while sending), by handle
+  "wb={v=" HELPER_VERSION "} wc={} wq={} wr={} wd={} sq={} sx={}",
+  // Open a connection, its events are tagged with the handle, except for handle 0
+  "function wb.o(t,p,h,c) c=c or 0 wq[c]={} wr[c]=0 wd[c]=0 sq[c]={} sx[c]=false local k=net.createConnection(t,false) wc[c]=k local x=c>0 and c or \"\"",
+  "for e,g in pairs({connection=\"C\",reconnection=\"RC\",disconnection=\"DC\",sent=\"DS\"}) do k:on(e,function() print(\"|\"..g..x..\"|\") if g==\"DS\" then wb.n(c) end end) end",
+  "k:on(\"receive\",function(s,d) if wr[c]+d:len()<=" RECEIVE_QUEUE_MAX " then table.insert(wq[c],d) wr[c]=wr[c]+d:len() else wd[c]=wd[c]+d:len() end if wr[c]>=" RECEIVE_QUEUE_HOLD " then pcall(s.hold,s) end print(d:len()..\"|DR\"..x..\"|\") end) k:connect(p,h) end",
+  // Send the send buffer, close a connection
+  "function wb.s(c) wc[c or 0]:send(sb) sb=\"\" end function wb.c(c) wc[c or 0]:close() end",
+  // Queue the send buffer, it is sent once the payloads before it have been sent
+  "function wb.a(c) c=c or 0 table.insert(sq[c],sb) sb=\"\" if not sx[c] then wb.n(c) end end",
+  "function wb.n(c) local d=table.remove(sq[c],1) sx[c]=d~=nil if d then wc[c]:send(d) end end",
+  // Read back a connection's received data, raw or as HEX, optionally at most m bytes
+  // The start reports the bytes dropped since the last read back, as the queue was full
+  "function wb.g(c,m) c=c or 0 local d,k=table.concat(wq[c]),wd[c] wq[c]={} wr[c]=0 wd[c]=0 if m and d:len()>m then wq[c]={d:sub(m+1)} wr[c]=d:len()-m d=d:sub(1,m) end",
+  "if wr[c]<" RECEIVE_QUEUE_HOLD " then pcall(wc[c].unhold,wc[c]) end return d,k end",
+  "function wb.r(c,m) local d,k=wb.g(c,m) uart.write(0,\"|SOF|\"..k..\"|\"..d:len()..\"|\",d,\"|EOF|\") end",
+  "function wb.x(c,m) local d,k=wb.g(c,m) uart.write(0,\"|SOF|\"..k..\"|\") for i=1,d:len() do uart.write(0,string.format(\"%02X\",d:byte(i))) tmr.wdclr() end uart.write(0,\"|EOF|\") end",
+  // Report the station status, start/stop the status events
+  "function wb.t() print(\"|STS|\"..wifi.sta.status()..\"|\") end",
+  "function wb.e(on) if wifi.sta.eventMonReg then if on then for s=0,5 do wifi.sta.eventMonReg(s,function() print(\"|STS|\"..s..\"|\") end) end wifi.sta.eventMonStart(100) else wifi.sta.eventMonStop(1) end end end",
+  // Join the network, optionally with status events, unless it is still joined or joining,
+  // e.g. by itself after a deep sleep. A fast join also sets the access point and a static IP configuration
+  "function wb.j(s,p,e,b,i,n,g) local t=wifi.sta.status() if (t==5 or t==1) and wifi.sta.getconfig()==s then if e then if t==1 then wb.e(true) end wb.t() end return end",
+  "wifi.setmode(wifi.STATION) if i then wifi.sta.setip({ip=i,netmask=n,gateway=g}) end if b then wifi.sta.config(s,p,1,b) else wifi.sta.config(s,p) end",
+  "if e then wb.e(true) end wifi.sta.connect() if e then wb.t() end end",
+  // Report the IP configuration and the access point, for a fast join
+  "function wb.q() local i,n,g=wifi.sta.getip() print(\"|NET|\"..(i or \"\")..\"|\"..(n or \"\")..\"|\"..(g or \"\")..\"|\"..wifi.sta.getbssid()..\"|\") end"
+};
+#define HELPER_LINES (sizeof(HELPER_SCRIPT) / sizeof(HELPER_SCRIPT[0]))
+
+// Loads the helper, unless this version is already loaded, and reports if it is available
+#define HELPER_LOAD "if not (wb and wb.v==" HELPER_VERSION ") then pcall(dofile, \"" HELPER_FILE "\") end print(\"|\" .. ((wb and wb.v==" HELPER_VERSION ") and \"\" or \"N\") .. \"WB|\")" // Max length 255
+
+// The number of commands which install the helper (open, lines, close)
+#define INSTALL_COMMANDS (HELPER_LINES + 2)
+
+// Asynchronous request states
+enum {
+  ASYNC_IDLE,
+  ASYNC_WAKE,
+  ASYNC_ALIVE,
+  ASYNC_BAUD_RATE,
+  ASYNC_BAUD_PING,
+  ASYNC_HELPER,
+  ASYNC_INSTALL,
+  ASYNC_ECHO_OFF,
+  ASYNC_STA_CONNECT,
+  ASYNC_JOIN,
+  ASYNC_EVENTS_STOP,
+  ASYNC_READ_NET,
+  ASYNC_READ_NET_END,
+  ASYNC_SERVER_CONNECT,
+  ASYNC_CREATE_BUFFER,
+  ASYNC_UPLOAD,
+  ASYNC_TRANSMIT,
+  ASYNC_SENT,
+  ASYNC_RESPONSE,
+  ASYNC_READ_BACK,
+  ASYNC_READ_END,
+  ASYNC_CLOSE
+};
+
+// Asynchronous read modes, how poll() handles received characters
+enum {
+  ASYNC_READ_PROMPTS,
+  ASYNC_READ_STATUS,
+  ASYNC_READ_DROPPED,
+  ASYNC_READ_LENGTH,
+  ASYNC_READ_RAW,
+  ASYNC_READ_HEX,
+  ASYNC_READ_ADDRESS
+};
+
+// The names of the trace event types, used by dumpTrace()
+static const char* const TRACE_NAMES[] = { "PROMPT", "TIMEOUT", "READ_BACK", "POWER" };
+
+// The phase of each asynchronous request state, used by the statistics
+static const uint8_t ASYNC_PHASES[] = {
+  WIFIBEE_PHASE_COUNT,  // IDLE
+  WIFIBEE_PHASE_POWER_ON,  // WAKE
+  WIFIBEE_PHASE_POWER_ON,  // ALIVE
+  WIFIBEE_PHASE_POWER_ON,  // BAUD_RATE
+  WIFIBEE_PHASE_POWER_ON,  // BAUD_PING
+  WIFIBEE_PHASE_POWER_ON,  // HELPER
+  WIFIBEE_PHASE_POWER_ON,  // INSTALL
+  WIFIBEE_PHASE_POWER_ON,  // ECHO_OFF
+  WIFIBEE_PHASE_JOIN,  // STA_CONNECT
+  WIFIBEE_PHASE_IP,  // JOIN
+  WIFIBEE_PHASE_JOIN,  // EVENTS_STOP
+  WIFIBEE_PHASE_JOIN,  // READ_NET
+  WIFIBEE_PHASE_JOIN,  // READ_NET_END
+  WIFIBEE_PHASE_SOCKET,  // SERVER_CONNECT
+  WIFIBEE_PHASE_UPLOAD,  // CREATE_BUFFER
+  WIFIBEE_PHASE_UPLOAD,  // UPLOAD
+  WIFIBEE_PHASE_UPLOAD,  // TRANSMIT
+  WIFIBEE_PHASE_UPLOAD,  // SENT
+  WIFIBEE_PHASE_SERVER_WAIT,  // RESPONSE
+  WIFIBEE_PHASE_READ_BACK,  // READ_BACK
+  WIFIBEE_PHASE_READ_BACK,  // READ_END
+  WIFIBEE_PHASE_CLOSE  // CLOSE
+};
 
 // Timeout constants
 #define RESPONSE_TIMEOUT 2000
@@ -61,7 +241,25 @@
 #define READBACK_TIMEOUT 2500
 #define WAKE_DELAY 2000
 #define STATUS_DELAY 1000
+#define FAST_JOIN_TIMEOUT 4000
+#define FAST_JOIN_STATUS_DELAY 250
 #define NEXT_PACKET_TIMEOUT 500
+#define PING_TIMEOUT 500
+#define BAUD_SWITCH_DELAY 50
+
+// The longest deep sleep, node.dsleep() takes a signed 32 bit microsecond count
+#define DEEP_SLEEP_MAX 2147483
+
+// The baud rates tried by negotiateBaudRate(), in ascending order
+static const uint32_t BAUD_RATES[] = { 9600, 19200, 38400, 57600, 74880, 115200, 230400, 460800, 921600 };
+#define BAUD_RATE_COUNT (sizeof(BAUD_RATES) / sizeof(BAUD_RATES[0]))
+
+// The number of bytes written back to measure the throughput
+#define THROUGHPUT_BYTES 1024
+
+// The delay of the wait loops while nothing is received, each prompt waited
+// for takes at least this long once the loop has started delaying
+#define IDLE_DELAY 1
 
 #define NIBBLE2BYTE(X) ((X >= 'A') ? X - 'A' + 10: X - '0')
 #define HEX2BYTE(H, L) ((NIBBLE2BYTE(H) << 4) + NIBBLE2BYTE(L))
@@ -87,6 +285,190 @@ private:
 
 static Sodaq_WifiBeeOnOff sodaq_wifibee_onoff;
 
+/*!
+* This function works out the fall back table of a prompt for
+* advancePrompt() (the KMP failure function). It is done once, before
+* the prompt is matched. Entry k is the length of the longest proper
+* prefix of the first k + 1 characters which is also their suffix.
+* @param prompt The prompt, at most MAX_PROMPT_LENGTH characters.
+* @param fallback The table is written to this buffer, one entry per character.
+*/
+static void preparePrompt(const char* prompt, uint8_t* fallback)
+{
+  uint8_t k = 0;
+
+  fallback[0] = 0;
+
+  for (uint8_t i = 1; (i < MAX_PROMPT_LENGTH) && (prompt[i] != '\0'); i++) {
+    while ((k > 0) && (prompt[i] != prompt[k])) {
+      k = fallback[k - 1];
+    }
+    if (prompt[i] == prompt[k]) {
+      k++;
+    }
+
+    fallback[i] = k;
+  }
+}
+
+/*!
+* This function advances a prompt match by one character.
+* On a mismatch it falls back to the longest prefix of the prompt
+* which is still a suffix of the matched text, using the table from
+* preparePrompt(). This avoids missing prompts which start within a
+* partial match.
+* @param prompt The prompt being matched.
+* @param fallback The fall back table of `prompt`.
+* @param index The number of prompt characters matched so far.
+* @param c The character read.
+* @return The new number of prompt characters matched.
+*/
+static size_t advancePrompt(const char* prompt, const uint8_t* fallback, size_t index, char c)
+{
+  while ((index > 0) && (prompt[index] != c)) {
+    index = fallback[index - 1];
+  }
+
+  return (prompt[index] == c) ? index + 1 : index;
+}
+
+/*!
+* This function parses an IP address or a MAC address, followed by a '|'.
+* @param text The text to parse, it is advanced past the '|'.
+* @param bytes The address is written to this buffer.
+* @param count The number of bytes in the address.
+* @param hex `true` for a MAC address (HEX, ':'), `false` for an IP
+* address (decimal, '.').
+* @return `true` if the address was parsed, otherwise `false`.
+*/
+static bool parseAddress(const char*& text, uint8_t* bytes, const size_t count,
+  const bool hex)
+{
+  for (size_t i = 0; i < count; i++) {
+    char* end;
+    unsigned long value = strtoul(text, &end, hex ? 16 : 10);
+
+    char separator = (i + 1 < count) ? (hex ? ':' : '.') : '|';
+    if ((end == text) || (value > 255) || (*end != separator)) {
+      return false;
+    }
+
+    bytes[i] = value;
+    text = end + 1;
+  }
+
+  return true;
+}
+
+/*!
+* This function writes an unsigned number as decimal text.
+* It replaces itoa()/utoa(), which aren't standard and which are
+* limited to an int (16 bits on AVR), e.g. ports above 32767 would
+* be written as negative numbers.
+* @param value The number to write.
+* @param text The text is written to this buffer (up to 11 bytes).
+* @return `text`.
+*/
+static char* formatUnsigned(uint32_t value, char* text)
+{
+  char digits[10];
+  size_t count = 0;
+
+  do {
+    digits[count++] = '0' + (value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  for (size_t i = 0; i < count; i++) {
+    text[i] = digits[count - 1 - i];
+  }
+  text[count] = '\0';
+
+  return text;
+}
+
+// The Lua letter escapes of the control characters, 0 if there is none
+static const char CONTROL_ESCAPES[32] = {
+  0, 0, 0, 0, 0, 0, 0, 'a', 'b', 't', 'n', 'v', 'f', 'r', 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+/*!
+* This function escapes one ASCII character for a double quoted Lua
+* string literal. Only specific Lua characters are escaped.
+* @param value The character to escape.
+* @param escaped The escaped characters are written to this buffer (2 bytes).
+* @return The number of characters written to `escaped`.
+*/
+static inline size_t escapeAsciiChar(char value, char* escaped)
+{
+  uint8_t index = value;
+  char code = 0;
+
+  if (index < sizeof(CONTROL_ESCAPES)) {
+    code = CONTROL_ESCAPES[index];
+  }
+  else if ((value == '\\') || (value == '\"') || (value == '\'') ||
+    (value == '[') || (value == ']')) {
+    code = value;
+  }
+
+  if (code == 0) {
+    escaped[0] = value;
+    return 1;
+  }
+
+  escaped[0] = '\\';
+  escaped[1] = code;
+
+  return 2;
+}
+
+/*!
+* This function escapes one byte for a double quoted Lua string literal.
+* Printable and 8-bit bytes are sent as they are. Quotes, back slashes,
+* and the control characters (which are handled by the NodeMCU line
+* editor) are escaped, in their shortest form.
+* @param value The byte to escape.
+* @param padded `true` to always use three digits for numeric escapes.
+* @param escaped The escaped characters are written to this buffer (4 bytes).
+* @return The number of characters written to `escaped`.
+*/
+static inline size_t escapeBinaryByte(uint8_t value, bool padded, char* escaped)
+{
+  if ((value >= ' ') && (value != 0x7F) && (value != '"') && (value != '\\')) {
+    escaped[0] = value;
+    return 1;
+  }
+
+  escaped[0] = '\\';
+
+  // Letter escapes for the control characters, '"' and '\' escape themselves
+  char code = 0;
+  if (value < sizeof(CONTROL_ESCAPES)) {
+    code = CONTROL_ESCAPES[value];
+  }
+  else if (value != 0x7F) {
+    code = value;
+  }
+
+  if (code != 0) {
+    escaped[1] = code;
+    return 2;
+  }
+
+  size_t length = 1;
+  if (padded || (value >= 100)) {
+    escaped[length++] = '0' + (value / 100);
+  }
+  if (padded || (value >= 10)) {
+    escaped[length++] = '0' + ((value / 10) % 10);
+  }
+  escaped[length++] = '0' + (value % 10);
+
+  return length;
+}
+
 /*!
 * Initialises member variables to default values,
 * including any pointers to NULL.
@@ -102,18 +484,98 @@ Sodaq_WifiBee::Sodaq_WifiBee()
   _bufferSize = 0;
   _bufferUsed = 0;
   _buffer = NULL;
+  _responseLength = 0;
+  _responseDropped = 0;
+
+  _uploadLine = NULL;
+  _uploadUsed = 0;
+
+  _traceBuffer = NULL;
+  _traceSize = 0;
+  _traceHead = 0;
+  _traceCount = 0;
+  _traceBytesOut = 0;
+  _traceBytesIn = 0;
+
+  _phase = WIFIBEE_PHASE_COUNT;
+  resetStats();
+
+  _responseSink = NULL;
+  _sinkSkipHeader = false;
+  _sinkHeaderIndex = 0;
+
+  _uploadWindow = WIFIBEE_DEFAULT_UPLOAD_WINDOW;
+  _uploadPending = 0;
+  _uploadStart = false;
+
+  _sendWindow = WIFIBEE_DEFAULT_SEND_WINDOW;
+  _sendsPending = 0;
+
+  _connectionOpen = false;
+
+  memset(_connections, 0, sizeof(_connections));
+  _handle = 0;
+
+  _statusEvents = false;
+
+  _rawReadBack = false;
+  _readBackChunk = WIFIBEE_READ_BACK_CHUNK;
+
+  _baudRate = 0;
+  _echo = true;
+  _echoOff = false;
+
+  _serial = NULL;
+  _fastBaudRate = 0;
+  _fastUART = false;
+  _throughput = 0;
+
+  _idleCallback = NULL;
+
+  _powerPolicy = WIFIBEE_POWER_OFF;
+  _powerTimeMS = 0;
+  _standby = false;
+  _sleeping = false;
+  _standbyTS = 0;
+  _joined = false;
+
+  _fastJoin = false;
+  _fastJoinTried = false;
+  memset(&_joinCache, 0, sizeof(_joinCache));
+
+  _waking = false;
+  _wakeTS = 0;
+  _wakeLatency = 0;
+
+  _completionCallback = NULL;
+  _asyncState = ASYNC_IDLE;
+  _asyncReadMode = ASYNC_READ_PROMPTS;
+  _asyncPromptCount = 0;
+
+  _sessionOpen = false;
+  _sessionServer = "";
+  _sessionPort = 0;
+  _sessionHandle = 0;
 
   _dataStream = NULL;
   _diagStream = NULL;
 }
 
 /*!
-* Frees any memory allocated to the internal buffer.
+* Frees any memory allocated to the internal buffers.
 */
 Sodaq_WifiBee::~Sodaq_WifiBee()
 {
-  if (_buffer) {
-    free(_buffer);
+  saveConnection();
+
+  for (uint8_t i = 0; i < WIFIBEE_MAX_CONNECTIONS; i++) {
+    if (_connections[i].buffer) {
+      free(_connections[i].buffer);
+    }
+  }
+
+  if (_uploadLine) {
+    free(_uploadLine);
   }
 }
 
@@ -133,12 +595,22 @@ void Sodaq_WifiBee::init(Stream& stream, int vcc33Pin, int onoffPin, int statusP
 
   _dataStream = &stream;
 
+  // The internal buffer belongs to connection 0
+  saveConnection();
+  _handle = 0;
+  loadConnection();
+
   _bufferSize = bufferSize;
   if (_buffer) {
     free(_buffer);
   }
   _buffer = (uint8_t*)malloc(_bufferSize);
 
+  if (!_uploadLine) {
+    _uploadLine = (char*)malloc(UPLOAD_LINE_SIZE);
+  }
+  _uploadUsed = 0;
+
   // TODO Do we want to do this here right now?
   off();
 }
@@ -155,6 +627,9 @@ void Sodaq_WifiBee::connectionSettings(const char* APN, const char* username,
   _APN = APN;
   _username = username;
   _password = password;
+
+  // The cached details belong to the previous network
+  _joinCache.valid = false;
 }
 
 /*!
@@ -176,548 +651,3072 @@ void Sodaq_WifiBee::setDiag(Stream& stream)
 }
 
 /*!
-* This method can be used to identify the specific Bee module.
-* @return The literal constant "WifiBee".
+* This method sets the number of send buffer lines which may be uploaded
+* before waiting for the NodeMCU's prompt. Larger values pipeline the
+* upload so that a payload no longer costs a full UART round-trip per chunk.
+* @param lines The number of lines in flight (1..WIFIBEE_MAX_UPLOAD_WINDOW).
 */
-const char* Sodaq_WifiBee::getDeviceType()
+void Sodaq_WifiBee::setUploadWindow(const uint8_t lines)
 {
-  return "WifiBee";
+  if (lines < 1) {
+    _uploadWindow = 1;
+  }
+  else if (lines > WIFIBEE_MAX_UPLOAD_WINDOW) {
+    _uploadWindow = WIFIBEE_MAX_UPLOAD_WINDOW;
+  }
+  else {
+    _uploadWindow = lines;
+  }
 }
 
 /*!
-* This method switches the WifiBee on.
-* It is called automatically, as required, by most methods.
-* It attempts to call _onoff::on().
-* @return `true` if the WifiBee is now on, `false` otherwise.
+* This method sets the number of streamed payloads which may be queued on
+* the NodeMCU, waiting to be sent. The next payload is uploaded while the
+* ones before it are sent, the upload only waits once the window is full.
+* @param count The number of payloads (1..WIFIBEE_MAX_SEND_WINDOW).
 */
-bool Sodaq_WifiBee::on()
+void Sodaq_WifiBee::setSendWindow(const uint8_t count)
 {
-  diagPrintLn("\r\nPower ON");
-  if (!isOn()) {
-    if (_onoff) {
-      _onoff->on();
-    }
+  if (count < 1) {
+    _sendWindow = 1;
   }
-  
-  bool result = skipTillPrompt(LUA_PROMPT, WAKE_DELAY);
-  // If it was already on, the above may have failed
-  // so we try with the isAlive() method.
-  if (!result) {
-    result |= isAlive();
+  else if (count > WIFIBEE_MAX_SEND_WINDOW) {
+    _sendWindow = WIFIBEE_MAX_SEND_WINDOW;
+  }
+  else {
+    _sendWindow = count;
   }
-
-  return result;
 }
 
 /*!
-* This method switches the WifiBee off.
-* It is called automatically, as required, by most methods.
-* It attempts to call _onoff::off().
-* @return `true` if the WifiBee is now off, `false` otherwise.
+* This method selects how the network join is monitored.
+* When enabled, the NodeMCU station event monitor pushes every status
+* change, so the join completes (or fails) as soon as the status changes.
+* Otherwise the status is polled every STATUS_DELAY milliseconds.
+* Firmware without the event monitor falls back to polling.
+* @param enabled `true` to use status events, `false` to poll.
 */
-bool Sodaq_WifiBee::off()
+void Sodaq_WifiBee::setStatusEvents(const bool enabled)
 {
-  diagPrintLn("\r\nPower OFF");
-
-  // No matter if it is on or off, turn it off.
-  if (_onoff) {
-    _onoff->off();
-  }
-
-  // TODO _echoOff = false;
-  return !isOn();
+  _statusEvents = enabled;
 }
 
 /*!
-* This method checkes if the WifiBee is on by sending
-* a status command which should return "OK".
-* @return `true` if an "OK" response was received, `false` otherwise.
+* This method selects how received data is read back from the NodeMCU.
+* HEX mode sends two HEX characters per byte, which doubles the transfer time,
+* but only uses printable characters. Raw mode sends the data as length prefixed
+* blocks of at most `chunkSize` bytes. The NodeMCU writes each block in one go,
+* so with its framing (about 16 bytes) it should fit in the host's serial receive
+* buffer while the host writes to the response sink.
+* @param enabled `true` for raw mode, `false` for HEX mode (default).
+* @param chunkSize The maximum size of a raw block, 0 for no limit.
 */
-bool Sodaq_WifiBee::isAlive()
+void Sodaq_WifiBee::setRawReadBack(const bool enabled, const size_t chunkSize)
 {
-  println(OK_COMMAND);
-  return skipTillPrompt(OK_PROMPT, RESPONSE_TIMEOUT);
+  _rawReadBack = enabled;
+  _readBackChunk = chunkSize;
 }
 
 /*!
-* This method replaces the default switching object for the WifiBee.
-* @param onoff A reference to the new switching control object.
+* This method sets the baud rate of the stream used to communicate with
+* the WifiBee. The NodeMCU's UART is set up with this rate when its
+* echo is switched off.
+* @param baudRate The baud rate the stream was opened with.
 */
-void Sodaq_WifiBee::setOnOff(Sodaq_OnOffBee & onoff)
-{ 
-  _onoff = &onoff; 
+void Sodaq_WifiBee::setBaudRate(const uint32_t baudRate)
+{
+  _baudRate = baudRate;
 }
 
 /*!
-*\overload
+* This method selects whether the NodeMCU echoes the commands sent.
+* Without the echo, the data received per request is roughly halved,
+* as every command (including the uploaded data) isn't read back.
+* The echo is switched off each time the WifiBee is switched on,
+* this requires the baud rate to be set with setBaudRate().
+* @param enabled `true` to keep the echo (default), `false` to switch it off.
 */
-void Sodaq_WifiBee::setOnOff(Sodaq_OnOffBee * onoff)
-{ 
-  _onoff = onoff; 
+void Sodaq_WifiBee::setEcho(const bool enabled)
+{
+  _echo = enabled;
 }
 
-// HTTP methods
 /*!
-* This method constructs and sends a HTTP GET request.
-* @param server The server/host to connect to (IP address or domain).
-* @param port The port to connect to.
-* @param URI The resource location on the server/host.
-* @param headers Any additional headers, each must be followed by a CRLF.
-* HOST header is added automatically.
-* @param httpCode The HTTP response code is written to this parameter (if a response is received).
-* @return `true` if a connection is established and the data is sent, `false` otherwise.
+* This method switches both ends of the UART to the highest baud rate
+* which works, up to `maxRate`.
+* The WifiBee is restarted and its boot rate is found by trying the
+* rates in turn (starting with the one set by setBaudRate()). The higher
+* rates are then tried, highest first, restarting it after each failure.
+* After this, the negotiated rate is set each time the WifiBee is
+* switched on, and the serial port is returned to the boot rate each
+* time it is switched off.
+* @param serial The serial port used to communicate with the WifiBee.
+* @param maxRate The highest baud rate to try.
+* @return `true` if the boot rate was found, otherwise `false`.
 */
-bool Sodaq_WifiBee::HTTPGet(const char* server, const uint16_t port,
-  const char* URI, const char* headers, uint16_t& httpCode)
+bool Sodaq_WifiBee::negotiateBaudRate(HardwareSerial& serial, const uint32_t maxRate)
 {
-  return HTTPAction(server, port, "GET", URI, headers, "", httpCode);
+  _serial = &serial;
+  _fastBaudRate = 0;
+  _throughput = 0;
+
+  restart();
+
+  bool result = false;
+
+  if (_baudRate > 0) {
+    _serial->begin(_baudRate);
+    result = ping();
+  }
+
+  for (uint8_t i = 0; (i < BAUD_RATE_COUNT) && (!result); i++) {
+    _serial->begin(BAUD_RATES[i]);
+    result = ping();
+
+    if (result) {
+      _baudRate = BAUD_RATES[i];
+    }
+  }
+
+  if (!result) {
+    diagPrintLn("\r\nBaud rate not found");
+    off();
+    return false;
+  }
+
+  diagPrint("\r\nBoot baud rate: ");
+  diagPrintLn(_baudRate);
+
+  for (int8_t i = BAUD_RATE_COUNT - 1; (i >= 0) && (BAUD_RATES[i] > _baudRate); i--) {
+    if (BAUD_RATES[i] > maxRate) {
+      continue;
+    }
+
+    if (switchBaudRate(BAUD_RATES[i])) {
+      _fastBaudRate = BAUD_RATES[i];
+      break;
+    }
+
+    // The NodeMCU only returns to its boot rate when it restarts
+    restart();
+  }
+
+  _throughput = measureThroughput();
+
+  diagPrint("\r\nBaud rate: ");
+  diagPrint(getBaudRate());
+  diagPrint(", throughput: ");
+  diagPrint(_throughput);
+  diagPrintLn(" bytes/s");
+
+  off();
+
+  return true;
 }
 
 /*!
-*\overload
+* This method returns the baud rate used while the WifiBee is on.
+* @return The negotiated baud rate, or the boot rate if none was
+* negotiated (0 if unknown).
 */
-bool Sodaq_WifiBee::HTTPGet(const String& server, const uint16_t port,
-  const String& URI, const String& headers, uint16_t& httpCode)
+uint32_t Sodaq_WifiBee::getBaudRate()
 {
-  return HTTPGet(server.c_str(), port, URI.c_str(), headers.c_str(), httpCode);
+  return (_fastBaudRate > 0) ? _fastBaudRate : _baudRate;
 }
 
 /*!
-* This method constructs and sends a HTTP POST request.
-* @param server The server/host to connect to (IP address or domain).
-* @param port The port to connect to.
-* @param URI The resource location on the server/host.
-* @param headers Any additional headers, each must be followed by a CRLF.
-* HOST & Content-Length headers are added automatically.
-* @param body The body (can be blank) to send with the request. Must not start with a CRLF.
-* @param httpCode The HTTP response code is written to this parameter (if a response is received).
-* @return `true` if a connection is established and the data is sent, `false` otherwise.
+* This method returns the throughput measured by negotiateBaudRate().
+* It is the rate at which the data written by the NodeMCU is received.
+* @return The throughput in bytes per second, 0 if unknown.
 */
-bool Sodaq_WifiBee::HTTPPost(const char* server, const uint16_t port,
-  const char* URI, const char* headers, const char* body,
-  uint16_t& httpCode)
+uint32_t Sodaq_WifiBee::getThroughput()
 {
-  return HTTPAction(server, port, "POST", URI, headers, body, httpCode);
+  return _throughput;
 }
 
 /*!
-*\overload
+* This method sets a function which is called while the library waits
+* for the device, instead of delaying for IDLE_DELAY ms at a time.
+* It is told the remaining time budget of the wait, so it can do other
+* work, or sleep until data is received from the device.
+* @param callback The function to call, NULL to delay.
 */
-bool Sodaq_WifiBee::HTTPPost(const String& server, const uint16_t port,
-  const String& URI, const String& headers, const String& body,
-  uint16_t& httpCode)
+void Sodaq_WifiBee::setIdleCallback(WifiBeeIdleCallback callback)
 {
-  return HTTPPost(server.c_str(), port, URI.c_str(), headers.c_str(),
-    body.c_str(), httpCode);
+  _idleCallback = callback;
 }
 
 /*!
-* This method constructs and sends a HTTP PUT request.
-* @param server The server/host to connect to (IP address or domain).
-* @param port The port to connect to.
-* @param URI The resource location on the server/host.
-* @param headers Any additional headers, each must be followed by a CRLF.
-* HOST & Content-Length headers are added automatically.
-* @param body The body (can be blank) to send with the request. Must not start with a CRLF.
-* @param httpCode The HTTP response code is written to this parameter (if a response is received).
-* @return `true` if a connection is established and the data is sent, `false` otherwise.
+* This method sets the power policy, what happens to the device after
+* each connection. Keeping it on, or letting it restart from a deep sleep,
+* saves part of the boot and the join of the next request, at the cost
+* of energy. getWakeLatency() reports the effect.
+* @param policy The policy, WIFIBEE_POWER_...
+* @param timeMS For WIFIBEE_POWER_KEEP_ALIVE and WIFIBEE_POWER_MODEM_SLEEP
+* the time after which poll() switches it off, 0 for no limit.
+* For WIFIBEE_POWER_DEEP_SLEEP the sleep time, up to 35 minutes, after
+* which the NodeMCU restarts by itself (GPIO16 must be connected to RST).
+* A request before then restarts it by switching it off and on, as does
+* any request with a sleep time of 0.
 */
-bool Sodaq_WifiBee::HTTPPut(const char* server, const uint16_t port,
-  const char* URI, const char* headers, const char* body,
-  uint16_t& httpCode)
+void Sodaq_WifiBee::setPowerPolicy(const uint8_t policy, const uint32_t timeMS)
 {
-  return HTTPAction(server, port, "PUT", URI, headers, body, httpCode);
+  _powerPolicy = policy;
+  _powerTimeMS = timeMS;
+
+  if ((policy == WIFIBEE_POWER_DEEP_SLEEP) && (timeMS > DEEP_SLEEP_MAX)) {
+    _powerTimeMS = DEEP_SLEEP_MAX;
+  }
 }
 
 /*!
-*\overload
+* This method returns the time the last wake took, from switching the
+* device on (or resuming it) until it was ready to connect to a server,
+* with the helper loaded and joined to the network.
+* @return The time in milliseconds, 0 if it hasn't been measured yet.
 */
-bool Sodaq_WifiBee::HTTPPut(const String& server, const uint16_t port,
-  const String& URI, const String& headers, const String& body,
-  uint16_t& httpCode)
+uint32_t Sodaq_WifiBee::getWakeLatency()
 {
-  return HTTPPut(server.c_str(), port, URI.c_str(), headers.c_str(),
-    body.c_str(), httpCode);
+  return _wakeLatency;
 }
 
-// TCP methods
 /*!
-* This method opens a TCP connection to a remote server.
-* @param server The server/host to connect to (IP address or domain).
-* @param port The port to connect to.
-* @return `true` if the connection was successfully opened, otherwise `false`.
+* This method enables the fast join. After a full join the access point
+* (BSSID) and the IP configuration are cached. The next join then uses
+* them, with a static IP address, which skips the scan and DHCP. If it
+* fails the cache is cleared, and the device is restarted (which turns
+* DHCP back on) for a full join. The statistics count both outcomes.
+* The IP address should be reserved for the device on the DHCP server.
+* @param enabled `true` to enable the fast join, `false` to disable it (default).
 */
-bool Sodaq_WifiBee::openTCP(const char* server, uint16_t port)
+void Sodaq_WifiBee::setFastJoin(const bool enabled)
 {
-  return openConnection(server, port, "net.TCP");
+  _fastJoin = enabled;
 }
 
 /*!
-* \overload
+* This method returns the network details cached for a fast join,
+* e.g. to keep them while the host sleeps or restarts.
+* @return The cached details, `valid` is `false` if there are none.
 */
-bool Sodaq_WifiBee::openTCP(const String& server, uint16_t port)
+const WifiBeeJoinCache& Sodaq_WifiBee::getJoinCache()
 {
-  return openTCP(server.c_str(), port);
+  return _joinCache;
 }
 
 /*!
-* This method sends an ASCII chunk of data over an open TCP connection.
-* @param data The buffer containing the data to be sent.
-* @param waitForResponse Expect/wait for a reply from the server, default = true.
-* @return `true` if the data was successfully sent, otherwise `false`.
+* This method sets the network details for a fast join, e.g. those
+* returned by getJoinCache() before the host restarted.
+* @param cache The details to use.
 */
-bool Sodaq_WifiBee::sendTCPAscii(const char* data, const bool waitForResponse)
+void Sodaq_WifiBee::setJoinCache(const WifiBeeJoinCache& cache)
 {
-  return transmitAsciiData(data, waitForResponse);
+  _joinCache = cache;
 }
 
 /*!
-* \overload
+* This method can be used to identify the specific Bee module.
+* @return The literal constant "WifiBee".
 */
-bool Sodaq_WifiBee::sendTCPAscii(const String& data, const bool waitForResponse)
+const char* Sodaq_WifiBee::getDeviceType()
 {
-  return sendTCPAscii(data.c_str(), waitForResponse);
+  return "WifiBee";
 }
 
 /*!
-* This method sends a binary chunk of data over an open TCP connection.
-* @param data The buffer containing the data to be sent.
-* @param length The number of bytes, contained in `data`, to send.
-* @param waitForResponse Expect/wait for a reply from the server, default = true.
-* @return `true` if the data was successfully sent, otherwise `false`.
+* This method switches the WifiBee on.
+* It is called automatically, as required, by most methods.
+* It attempts to call _onoff::on().
+* @return `true` if the WifiBee is now on, `false` otherwise.
 */
-bool Sodaq_WifiBee::sendTCPBinary(const uint8_t* data, const size_t length, const bool waitForResponse)
+bool Sodaq_WifiBee::on()
 {
-  return transmitBinaryData(data, length, waitForResponse);
-}
+  diagPrintLn("\r\nPower ON");
+  uint8_t outer = startPhase(WIFIBEE_PHASE_POWER_ON);
 
-/*!
-* This method closes an open TCP connection.
-* @return `true` if the connection was closed, otherwise `false`.
-* It will return `false` if the connection was already closed.
-*/
-bool Sodaq_WifiBee::closeTCP()
-{
-  return closeConnection();
-}
+  _waking = true;
+  _wakeTS = millis();
 
-// UDP methods
-/*!
-* This method opens a UDP connection to a remote server.
-* @param server The server/host to connect to (IP address or domain).
-* @param port The port to connect to.
-* @return `true` if the connection was successfully opened, otherwise `false`.
-*/
-bool Sodaq_WifiBee::openUDP(const char* server, uint16_t port)
-{
-  return openConnection(server, port, "net.UDP");
-}
+  // A device in standby only needs to be woken
+  bool result = (_standby) && (resume());
 
-/*!
-* \overload
-*/
-bool Sodaq_WifiBee::openUDP(const String& server, uint16_t port)
-{
-  return openUDP(server.c_str(), port);
-}
+  if (!result) {
+    result = start();
+  }
 
-/*!
-* This method sends an ASCII chunk of data over an open UDP connection.
-* @param data The buffer containing the data to be sent.
-* @param waitForResponse Expect/wait for a reply from the server, default = true.
-* @return `true` if the data was successfully sent, otherwise `false`.
-*/
-bool Sodaq_WifiBee::sendUDPAscii(const char* data, const bool waitForResponse)
-{
-  return transmitAsciiData(data, waitForResponse);
-}
+  endPhase(outer);
 
-/*!
-* \overload
-*/
-bool Sodaq_WifiBee::sendUDPAscii(const String& data, const bool waitForResponse)
-{
-  return sendUDPAscii(data.c_str(), waitForResponse);
+  return result;
 }
 
 /*!
-* This method sends a binary chunk of data over an open UDP connection.
-* @param data The buffer containing the data to be sent.
-* @param length The number of bytes, contained in `data`, to send.
-* @param waitForResponse Expect/wait for a reply from the server, default = true.
-* @return `true` if the data was successfully sent, otherwise `false`.
+* This method switches the WifiBee on, or wakes it from a deep sleep,
+* and prepares the NodeMCU: the baud rate, the helper and the echo.
+* @return `true` if it is now ready, `false` otherwise.
 */
-bool Sodaq_WifiBee::sendUDPBinary(const uint8_t* data, const size_t length, const bool waitForResponse)
+bool Sodaq_WifiBee::start()
 {
-  return transmitBinaryData(data, length, waitForResponse);
-}
+  bool result = false;
 
-/*!
-* This method closes an open UDP connection.
-* @return `true` if the connection was closed, otherwise `false`.
-* It will return `false` if the connection was already closed.
-*/
-bool Sodaq_WifiBee::closeUDP()
-{
-  return closeConnection();
-}
+  if (_sleeping) {
+    result = wakeFromSleep();
 
-/*!
-* This method copies the response data into a supplied buffer.
-* The amount of data copied is limited by the size of the supplied buffer.
-* Adds a terminating '\0'.
-* @param buffer The buffer to copy the data into.
-* @param size The size of `buffer`.
-* @param bytesRead The number of bytes copied is written to this parameter.
-* @return `false` if there is no data to copy, otherwise `true`.
-*/
-bool Sodaq_WifiBee::readResponseAscii(char* buffer, const size_t size, size_t& bytesRead)
-{
-  if (_bufferUsed == 0) {
-    return false;
+    // Otherwise it is restarted now
+    if (!result) {
+      off();
+    }
   }
 
-  bytesRead = ((size - 1) < _bufferUsed) ? (size - 1) : _bufferUsed;
-
-  memcpy(buffer, _buffer, bytesRead);
-  buffer[bytesRead] = '\0';
+  if (!result) {
+    if (!isOn()) {
+      if (_onoff) {
+        _onoff->on();
+      }
+    }
+    trace(WIFIBEE_TRACE_POWER, 1);
 
-  return true;
-}
+    result = skipTillPrompt(luaPrompt(), WAKE_DELAY);
+    // If it was already on, the above may have failed
+    // so we try with the isAlive() method.
+    if (!result) {
+      result |= isAlive();
+    }
+  }
 
-/*!
-* This method copies the response data into a supplied buffer.
-* The amount of data copied is limited by the size of the supplied buffer.
-* Does not add a terminating '\0'.
-* @param buffer The buffer to copy the data into.
-* @param size The size of `buffer`.
-* @param bytesRead The number of bytes copied is written to this parameter.
-* @return `false` if there is no data to copy, otherwise `true`.
-*/
-bool Sodaq_WifiBee::readResponseBinary(uint8_t* buffer, const size_t size, size_t& bytesRead)
-{
-  if (_bufferUsed == 0) {
-    return false;
+  // The echo setting is applied along with the baud rate
+  if ((result) && (_fastBaudRate > 0) && (!_fastUART)) {
+    result = switchBaudRate(_fastBaudRate);
   }
 
-  bytesRead = (size < _bufferUsed) ? size : _bufferUsed;
+  if (result) {
+    result = loadHelper();
+  }
 
-  memcpy(buffer, _buffer, bytesRead);
+  if ((result) && (!_echo) && (!_echoOff)) {
+    result = disableEcho();
+  }
 
-  return true;
+  return result;
 }
 
 /*!
-* This method copies the response data into a supplied buffer.
-* It skips the response and header lines and only copies the response body.
-* The amount of data copied is limited by the size of the supplied buffer.
-* Adds a terminating '\0'.
-* @param buffer The buffer to copy the data into.
-* @param size The size of `buffer`.
-* @param bytesRead The number of bytes copied is written to this parameter.
-* @param httpCode The HTTP response code is written to this parameter.
-* @return `false` if there is no data to copy, otherwise `true`.
-* It will return `false` if the body is empty or cannot be determined.
+* This method resumes a device which was kept on in standby.
+* It is switched off if it doesn't respond.
+* @return `true` if it is ready, `false` otherwise.
 */
-bool Sodaq_WifiBee::readHTTPResponse(char* buffer, const size_t size,
-  size_t& bytesRead, uint16_t& httpCode)
+bool Sodaq_WifiBee::resume()
 {
-  if (_bufferUsed == 0) {
-    return false;
-  }
-
-  // Read HTTP response code
-  parseHTTPResponse(httpCode);
+  bool result;
 
-  // Add 4 to start from after the double newline
-  char* startPos = strstr((char*)_buffer, "\r\n\r\n") + 4;
+  _standby = false;
 
-  size_t startIndex = startPos - (char*)_buffer;
+  // Drop the prompt which followed the standby command
+  flushInputStream();
 
-  if (startIndex < _bufferUsed) {
-    bytesRead = ((size - 1) < (_bufferUsed - startIndex)) ? (size - 1) : (_bufferUsed - startIndex);
+  if (_powerPolicy == WIFIBEE_POWER_MODEM_SLEEP) {
+    println(NO_SLEEP_COMMAND);
+    result = skipTillPrompt(OK_PROMPT, RESPONSE_TIMEOUT);
   }
   else {
-    bytesRead = 0;
+    result = isAlive();
   }
 
-  memcpy(buffer, startPos, bytesRead);
-  buffer[bytesRead] = '\0';
+  if (!result) {
+    off();
+  }
 
-  return true;
+  return result;
 }
 
-// Stream implementations
 /*!
-* Implementation of Stream::write(x) \n
-* If `_dataStream != NULL` it calls `_dataStream->write(x)`.
-* @param x Data to pass to `_dataStream->write(x)`.
-* @return result of `_dataStream->write(x)` or 0 if `_dataStream == NULL`.
+* This method waits for the NodeMCU to restart from a timed deep sleep.
+* It only waits if the sleep time (nearly) has ended. Until WAKE_DELAY
+* after the sleep time it may still be booting, so its prompt is
+* waited for instead of checking it with isAlive().
+* @return `true` if it has restarted, `false` if it is still asleep
+* or doesn't respond.
 */
-size_t Sodaq_WifiBee::write(uint8_t x)
+bool Sodaq_WifiBee::wakeFromSleep()
 {
-  if (_dataStream) {
-    return _dataStream->write(x);
+  _sleeping = false;
+
+  if (_powerTimeMS == 0) {
+    return false;
   }
-  else {
-    return 0;
+
+  uint32_t elapsed = millis() - _standbyTS;
+
+  if (elapsed < _powerTimeMS + WAKE_DELAY) {
+    return (elapsed + WAKE_DELAY >= _powerTimeMS) &&
+      (skipTillPrompt(luaPrompt(), _powerTimeMS + WAKE_DELAY - elapsed));
   }
+
+  // It has restarted a while ago, drop its boot output
+  flushInputStream();
+
+  return isAlive();
 }
 
 /*!
-* Implementation of Stream::available() \n
-* If `_dataStream != NULL` it calls `_dataStream->available()`.
-* @return result of `_dataStream->available()` or 0 if `_dataStream == NULL`.
+* This method applies the power policy after a connection has been closed.
 */
-int Sodaq_WifiBee::available()
+void Sodaq_WifiBee::standby()
 {
-  if (_dataStream) {
-    return _dataStream->available();
+  // It stays on as it is while another connection is open
+  if (otherConnectionOpen()) {
+    return;
   }
-  else {
-    return 0;
+
+  switch (_powerPolicy) {
+  case WIFIBEE_POWER_KEEP_ALIVE:
+    break;
+  case WIFIBEE_POWER_MODEM_SLEEP:
+    // The prompt is dropped when it is resumed
+    println(MODEM_SLEEP_COMMAND);
+    break;
+  case WIFIBEE_POWER_DEEP_SLEEP:
+    // Without RF calibration when it restarts
+    print("node.dsleep(");
+    print(_powerTimeMS);
+    println("000,2)");
+    flush();
+    trace(WIFIBEE_TRACE_POWER, 0);
+
+    // It restarts like after being switched off
+    clearDeviceState();
+    _sleeping = true;
+    _standbyTS = millis();
+    return;
+  default:
+    off();
+    return;
   }
+
+  _standby = true;
+  _standbyTS = millis();
 }
 
 /*!
-* Implementation of Stream::peek() \n
-* If `_dataStream != NULL` it calls `_dataStream->peek()`.
-* @return result of `_dataStream->peek()` or -1 if `_dataStream == NULL`.
+* This method checks if the time for which the device is kept on in
+* standby has passed.
+* @return `true` if it should be switched off, otherwise `false`.
 */
-int Sodaq_WifiBee::peek()
+bool Sodaq_WifiBee::standbyExpired()
 {
-  if (_dataStream) {
-    return _dataStream->peek();
-  }
-  else {
-    return -1;
-  }
+  return (_standby) && (_powerTimeMS > 0) && (timedOut32(_standbyTS, _powerTimeMS));
 }
 
 /*!
-* Implementation of Stream::read() \n
-* If `_dataStream != NULL` it calls `_dataStream->read()`.
-* @return result of `_dataStream->read()` or -1 if `_dataStream == NULL`.
+* This method forgets the NodeMCU's state once it has been switched off or
+* has gone into a deep sleep. It restarts with its echo on, at its boot
+* rate, and it has to rejoin the network.
 */
-int Sodaq_WifiBee::read()
+void Sodaq_WifiBee::clearDeviceState()
 {
-  if (_dataStream) {
-    return _dataStream->read();
+  _echoOff = false;
+
+  if (_fastUART) {
+    _serial->begin(_baudRate);
+    _fastUART = false;
   }
-  else {
-    return -1;
+
+  _standby = false;
+  _sleeping = false;
+  _joined = false;
+  _sendsPending = 0;
+
+  // Its connections are lost
+  for (uint8_t i = 0; i < WIFIBEE_MAX_CONNECTIONS; i++) {
+    _connections[i].open = false;
   }
+  _connectionOpen = false;
 }
 
 /*!
-* Implementation of Stream::flush() \n
-* If `_dataStream != NULL` it calls `_dataStream->flush()`.
+* This method records the wake latency, once the device is ready to
+* connect to a server after it was woken.
 */
-void Sodaq_WifiBee::flush() {
-  if (_dataStream) {
-    _dataStream->flush();
+void Sodaq_WifiBee::wakeDone()
+{
+  if (_waking) {
+    _wakeLatency = millis() - _wakeTS;
+    _waking = false;
   }
 }
 
-// Private methods
 /*!
-* This method checkes if the WifiBee is on.
-* It attempts to call _onoff::isOn().
-* @return `true` if the WifiBee is on, `false` otherwise.
+* This method switches the WifiBee off.
+* It is called automatically, as required, by most methods.
+* It attempts to call _onoff::off().
+* @return `true` if the WifiBee is now off, `false` otherwise.
 */
-bool Sodaq_WifiBee::isOn()
+bool Sodaq_WifiBee::off()
 {
+  diagPrintLn("\r\nPower OFF");
+
+  // No matter if it is on or off, turn it off.
   if (_onoff) {
-    return _onoff->isOn();
+    _onoff->off();
   }
+  trace(WIFIBEE_TRACE_POWER, 0);
 
-  // No onoff. Let's assume it is on.
-  return true;
+  // The echo and baud rate are reset when it restarts
+  clearDeviceState();
+
+  return !isOn();
 }
 
 /*!
-* This method reads and empties the input buffer of `_dataStream`.
-* It attempts to output the data it reads to `_diagStream`.
+* This method checkes if the WifiBee is on by sending
+* a status command which should return "OK".
+* @return `true` if an "OK" response was received, `false` otherwise.
 */
-void Sodaq_WifiBee::flushInputStream()
+bool Sodaq_WifiBee::isAlive()
 {
-  while (available()) {
-    diagPrint((char)read());
-  }
+  println(OK_COMMAND);
+  return skipTillPrompt(OK_PROMPT, RESPONSE_TIMEOUT);
 }
 
 /*!
-* This method reads and empties the input buffer of `_dataStream`.
-* It continues until the specified amount of time has elapsed.
-* It attempts to output the data it reads to `_diagStream`.
-* @param timeMS The time limit in milliseconds.
-* @return The number of bytes it read.
+* This method replaces the default switching object for the WifiBee.
+* @param onoff A reference to the new switching control object.
+*/
+void Sodaq_WifiBee::setOnOff(Sodaq_OnOffBee & onoff)
+{ 
+  _onoff = &onoff; 
+}
+
+/*!
+*\overload
+*/
+void Sodaq_WifiBee::setOnOff(Sodaq_OnOffBee * onoff)
+{ 
+  _onoff = onoff; 
+}
+
+// HTTP methods
+/*!
+* This method constructs and sends a HTTP GET request.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param URI The resource location on the server/host.
+* @param headers Any additional headers, each must be followed by a CRLF.
+* HOST header is added automatically.
+* @param httpCode The HTTP response code is written to this parameter (if a response is received).
+* @return `true` if a connection is established and the data is sent, `false` otherwise.
+*/
+bool Sodaq_WifiBee::HTTPGet(const char* server, const uint16_t port,
+  const char* URI, const char* headers, uint16_t& httpCode)
+{
+  return HTTPAction(server, port, "GET", URI, headers, "", httpCode);
+}
+
+/*!
+*\overload
+*/
+bool Sodaq_WifiBee::HTTPGet(const String& server, const uint16_t port,
+  const String& URI, const String& headers, uint16_t& httpCode)
+{
+  return HTTPGet(server.c_str(), port, URI.c_str(), headers.c_str(), httpCode);
+}
+
+/*!
+* This method constructs and sends a HTTP POST request.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param URI The resource location on the server/host.
+* @param headers Any additional headers, each must be followed by a CRLF.
+* HOST & Content-Length headers are added automatically.
+* @param body The body (can be blank) to send with the request. Must not start with a CRLF.
+* @param httpCode The HTTP response code is written to this parameter (if a response is received).
+* @return `true` if a connection is established and the data is sent, `false` otherwise.
+*/
+bool Sodaq_WifiBee::HTTPPost(const char* server, const uint16_t port,
+  const char* URI, const char* headers, const char* body,
+  uint16_t& httpCode)
+{
+  return HTTPAction(server, port, "POST", URI, headers, body, httpCode);
+}
+
+/*!
+*\overload
+*/
+bool Sodaq_WifiBee::HTTPPost(const String& server, const uint16_t port,
+  const String& URI, const String& headers, const String& body,
+  uint16_t& httpCode)
+{
+  return HTTPPost(server.c_str(), port, URI.c_str(), headers.c_str(),
+    body.c_str(), httpCode);
+}
+
+/*!
+* This method constructs and sends a HTTP PUT request.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param URI The resource location on the server/host.
+* @param headers Any additional headers, each must be followed by a CRLF.
+* HOST & Content-Length headers are added automatically.
+* @param body The body (can be blank) to send with the request. Must not start with a CRLF.
+* @param httpCode The HTTP response code is written to this parameter (if a response is received).
+* @return `true` if a connection is established and the data is sent, `false` otherwise.
+*/
+bool Sodaq_WifiBee::HTTPPut(const char* server, const uint16_t port,
+  const char* URI, const char* headers, const char* body,
+  uint16_t& httpCode)
+{
+  return HTTPAction(server, port, "PUT", URI, headers, body, httpCode);
+}
+
+/*!
+*\overload
+*/
+bool Sodaq_WifiBee::HTTPPut(const String& server, const uint16_t port,
+  const String& URI, const String& headers, const String& body,
+  uint16_t& httpCode)
+{
+  return HTTPPut(server.c_str(), port, URI.c_str(), headers.c_str(),
+    body.c_str(), httpCode);
+}
+
+// HTTP session methods
+/*!
+* This method opens an HTTP session with a remote server.
+* The device is switched on, joins the network and connects to the server.
+* HTTPGet(), HTTPPost() and HTTPPut() calls for the same server and port
+* then reuse the connection, instead of each reconnecting and switching
+* the device off. The connection is only reopened if the server closes it.
+* The session is kept on the selected connection, requests only reuse it
+* while that connection is selected. Requests to another server on that
+* connection are refused until the session is closed.
+* Any session already open is closed first.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @return `true` if the connection was successfully opened, otherwise `false`.
+* It will return `false` if the selected connection is already open.
+*/
+bool Sodaq_WifiBee::openHTTPSession(const char* server, const uint16_t port)
+{
+  if (_sessionOpen) {
+    closeHTTPSession();
+  }
+
+  _sessionOpen = openConnection(server, port, "net.TCP");
+
+  if (_sessionOpen) {
+    _sessionServer = server;
+    _sessionPort = port;
+    _sessionHandle = _handle;
+  }
+
+  return _sessionOpen;
+}
+
+/*!
+* \overload
+*/
+bool Sodaq_WifiBee::openHTTPSession(const String& server, const uint16_t port)
+{
+  return openHTTPSession(server.c_str(), port);
+}
+
+/*!
+* This method closes the HTTP session and applies the power policy.
+* @return `true` if the connection was closed, otherwise `false`.
+* It will return `false` if the connection was already closed.
+*/
+bool Sodaq_WifiBee::closeHTTPSession()
+{
+  if (!_sessionOpen) {
+    return false;
+  }
+
+  // The session may be on another connection than the selected one
+  uint8_t handle = _handle;
+  if (!selectConnection(_sessionHandle)) {
+    return false;
+  }
+
+  _sessionOpen = false;
+
+  bool result = closeConnection();
+
+  selectConnection(handle);
+
+  return result;
+}
+
+// Asynchronous HTTP methods
+/*!
+* This method starts an asynchronous HTTP GET request.
+* It returns immediately, poll() must then be called until the
+* request completes, which is reported to the completion callback.
+* The strings passed must remain valid until the request completes.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param URI The resource location on the server/host.
+* @param headers Any additional headers, each must be followed by a CRLF.
+* HOST header is added automatically.
+* @return `true` if the request was started, `false` if a request
+* is already in progress, or if the selected connection is open for
+* another server.
+*/
+bool Sodaq_WifiBee::beginHTTPGet(const char* server, const uint16_t port,
+  const char* URI, const char* headers)
+{
+  return beginHTTPAction(server, port, "GET", URI, headers, "");
+}
+
+/*!
+* This method starts an asynchronous HTTP POST request.
+* It returns immediately, poll() must then be called until the
+* request completes, which is reported to the completion callback.
+* The strings passed must remain valid until the request completes.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param URI The resource location on the server/host.
+* @param headers Any additional headers, each must be followed by a CRLF.
+* HOST & Content-Length headers are added automatically.
+* @param body The body (can be blank) to send with the request. Must not start with a CRLF.
+* @return `true` if the request was started, `false` if a request
+* is already in progress, or if the selected connection is open for
+* another server.
+*/
+bool Sodaq_WifiBee::beginHTTPPost(const char* server, const uint16_t port,
+  const char* URI, const char* headers, const char* body)
+{
+  return beginHTTPAction(server, port, "POST", URI, headers, body);
+}
+
+/*!
+* This method starts an asynchronous HTTP PUT request.
+* It returns immediately, poll() must then be called until the
+* request completes, which is reported to the completion callback.
+* The strings passed must remain valid until the request completes.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param URI The resource location on the server/host.
+* @param headers Any additional headers, each must be followed by a CRLF.
+* HOST & Content-Length headers are added automatically.
+* @param body The body (can be blank) to send with the request. Must not start with a CRLF.
+* @return `true` if the request was started, `false` if a request
+* is already in progress, or if the selected connection is open for
+* another server.
+*/
+bool Sodaq_WifiBee::beginHTTPPut(const char* server, const uint16_t port,
+  const char* URI, const char* headers, const char* body)
+{
+  return beginHTTPAction(server, port, "PUT", URI, headers, body);
+}
+
+/*!
+* This method sets the function which is called when an asynchronous
+* request completes. The response can then be read with the
+* readResponse methods, as for the blocking requests.
+* @param callback The function to call, NULL for none.
+*/
+void Sodaq_WifiBee::setCompletionCallback(WifiBeeCompletionCallback callback)
+{
+  _completionCallback = callback;
+}
+
+/*!
+* This method checks if an asynchronous request is in progress.
+* @return `true` if a request is in progress, otherwise `false`.
+*/
+bool Sodaq_WifiBee::isBusy()
+{
+  return (_asyncState != ASYNC_IDLE);
+}
+
+/*!
+* This method advances an asynchronous request.
+* It handles the data which has been received, and any time out,
+* without waiting. It should be called regularly, e.g. from loop().
+* Between requests it switches off a device kept on for too long.
+*/
+void Sodaq_WifiBee::poll()
+{
+  if ((_asyncState == ASYNC_IDLE) && (standbyExpired())) {
+    off();
+  }
+
+  while ((_asyncState != ASYNC_IDLE) && (available())) {
+    if (_asyncReadMode == ASYNC_READ_RAW) {
+      asyncReadRaw();
+      continue;
+    }
+
+    char c = readInput();
+    diagData(c);
+
+    if (_asyncReadMode != ASYNC_READ_PROMPTS) {
+      _asyncTS = millis();
+      asyncReadData(c);
+      continue;
+    }
+
+    for (uint8_t i = 0; i < _asyncPromptCount; i++) {
+      _asyncPromptIndex[i] = advancePrompt(_asyncPrompts[i], _asyncPromptFallback[i],
+        _asyncPromptIndex[i], c);
+
+      if (_asyncPrompts[i][_asyncPromptIndex[i]] == '\0') {
+        if (strncmp(_asyncPrompts[i], DISCONNECT_PROMPT, DISCONNECT_PREFIX_LENGTH) == 0) {
+          _connectionOpen = false;
+        }
+
+        trace(WIFIBEE_TRACE_PROMPT, i);
+        countWait(true);
+        asyncNext(i);
+        break;
+      }
+    }
+  }
+
+  if ((_asyncState != ASYNC_IDLE) && (timedOut32(_asyncTS, _asyncTimeout))) {
+    _asyncReadMode = ASYNC_READ_PROMPTS;
+    trace(WIFIBEE_TRACE_TIMEOUT, 0);
+    countWait(false);
+    asyncNext(-1);
+  }
+}
+
+// Connection handles
+/*!
+* This method allocates the buffer for the data received on a connection.
+* It must be called before a handle other than 0 is selected,
+* connection 0 uses the buffer allocated by init().
+* @param handle The connection's handle, 1 to WIFIBEE_MAX_CONNECTIONS - 1.
+* @param bufferSize The amount of memory to allocate to the buffer.
+* @return `true` if the buffer was allocated, otherwise `false`.
+*/
+bool Sodaq_WifiBee::setConnectionBuffer(const uint8_t handle, const size_t bufferSize)
+{
+  if ((handle == 0) || (handle >= WIFIBEE_MAX_CONNECTIONS) || (isBusy())) {
+    return false;
+  }
+
+  if (handle == _handle) {
+    saveConnection();
+  }
+
+  WifiBeeConnection& connection = _connections[handle];
+
+  if (connection.buffer) {
+    free(connection.buffer);
+  }
+  connection.buffer = (uint8_t*)malloc(bufferSize);
+  connection.bufferSize = (connection.buffer) ? bufferSize : 0;
+  connection.bufferUsed = 0;
+  connection.responseLength = 0;
+  connection.responseDropped = 0;
+
+  if (handle == _handle) {
+    loadConnection();
+  }
+
+  return (connection.buffer != NULL);
+}
+
+/*!
+* This method selects the connection used by the TCP, UDP and HTTP methods.
+* Each connection has its own socket on the NodeMCU and its own received
+* data, so several can be open at once and used in turn. Any data
+* streamed on the previously selected connection is sent first.
+* @param handle The connection's handle, 0 to WIFIBEE_MAX_CONNECTIONS - 1.
+* @return `true` if it is selected, `false` if the handle is out of range,
+* has no buffer, or a request is in progress.
+*/
+bool Sodaq_WifiBee::selectConnection(const uint8_t handle)
+{
+  if ((handle >= WIFIBEE_MAX_CONNECTIONS) || (isBusy())) {
+    return false;
+  }
+
+  if (handle == _handle) {
+    return true;
+  }
+
+  if (!_connections[handle].buffer) {
+    return false;
+  }
+
+  // The sent events are only counted for the selected connection
+  waitForSends(0);
+
+  saveConnection();
+  _handle = handle;
+  loadConnection();
+
+  return true;
+}
+
+/*!
+* This method returns the handle of the selected connection.
+* @return The handle, 0 to WIFIBEE_MAX_CONNECTIONS - 1.
+*/
+uint8_t Sodaq_WifiBee::getConnection()
+{
+  return _handle;
+}
+
+// TCP methods
+/*!
+* This method opens a TCP connection to a remote server.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @return `true` if the connection was successfully opened, otherwise `false`.
+*/
+bool Sodaq_WifiBee::openTCP(const char* server, uint16_t port)
+{
+  return openConnection(server, port, "net.TCP");
+}
+
+/*!
+* \overload
+*/
+bool Sodaq_WifiBee::openTCP(const String& server, uint16_t port)
+{
+  return openTCP(server.c_str(), port);
+}
+
+/*!
+* This method sends an ASCII chunk of data over an open TCP connection.
+* @param data The buffer containing the data to be sent.
+* @param waitForResponse Expect/wait for a reply from the server, default = true.
+* @return `true` if the data was successfully sent, otherwise `false`.
+*/
+bool Sodaq_WifiBee::sendTCPAscii(const char* data, const bool waitForResponse)
+{
+  return transmitAsciiData(data, waitForResponse);
+}
+
+/*!
+* \overload
+*/
+bool Sodaq_WifiBee::sendTCPAscii(const String& data, const bool waitForResponse)
+{
+  return sendTCPAscii(data.c_str(), waitForResponse);
+}
+
+/*!
+* This method sends a binary chunk of data over an open TCP connection.
+* @param data The buffer containing the data to be sent.
+* @param length The number of bytes, contained in `data`, to send.
+* @param waitForResponse Expect/wait for a reply from the server, default = true.
+* @return `true` if the data was successfully sent, otherwise `false`.
+*/
+bool Sodaq_WifiBee::sendTCPBinary(const uint8_t* data, const size_t length, const bool waitForResponse)
+{
+  return transmitBinaryData(data, length, waitForResponse);
+}
+
+/*!
+* This method closes an open TCP connection.
+* @return `true` if the connection was closed, otherwise `false`.
+* It will return `false` if the connection was already closed.
+*/
+bool Sodaq_WifiBee::closeTCP()
+{
+  return closeConnection();
+}
+
+// TCP streaming methods
+/*!
+* This method queues an ASCII chunk of data to be sent over an open TCP
+* connection. It returns once the data has been uploaded, without waiting
+* for it to be sent, unless the send window is full.
+* @param data The buffer containing the data to be sent.
+* @return `true` if the data was queued, otherwise `false`.
+*/
+bool Sodaq_WifiBee::streamTCPAscii(const char* data)
+{
+  if (*data == '\0') {
+    return true;
+  }
+
+  if (!beginStream()) {
+    return false;
+  }
+
+  uint8_t outer = startPhase(WIFIBEE_PHASE_UPLOAD);
+
+  sendEscapedAscii(data);
+  queueSendBuffer();
+
+  endPhase(outer);
+
+  return true;
+}
+
+/*!
+* \overload
+*/
+bool Sodaq_WifiBee::streamTCPAscii(const String& data)
+{
+  return streamTCPAscii(data.c_str());
+}
+
+/*!
+* This method queues a binary chunk of data to be sent over an open TCP
+* connection. It returns once the data has been uploaded, without waiting
+* for it to be sent, unless the send window is full.
+* @param data The buffer containing the data to be sent.
+* @param length The number of bytes, contained in `data`, to send.
+* @return `true` if the data was queued, otherwise `false`.
+*/
+bool Sodaq_WifiBee::streamTCPBinary(const uint8_t* data, const size_t length)
+{
+  if (length == 0) {
+    return true;
+  }
+
+  if (!beginStream()) {
+    return false;
+  }
+
+  uint8_t outer = startPhase(WIFIBEE_PHASE_UPLOAD);
+
+  sendEscapedBinary(data, length);
+  queueSendBuffer();
+
+  endPhase(outer);
+
+  return true;
+}
+
+/*!
+* This method waits until all the streamed data has been sent.
+* @return `true` if it was sent, `false` if the wait timed out or the
+* connection was closed.
+*/
+bool Sodaq_WifiBee::flushTCP()
+{
+  return waitForSends(0);
+}
+
+// UDP methods
+/*!
+* This method opens a UDP connection to a remote server.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @return `true` if the connection was successfully opened, otherwise `false`.
+*/
+bool Sodaq_WifiBee::openUDP(const char* server, uint16_t port)
+{
+  return openConnection(server, port, "net.UDP");
+}
+
+/*!
+* \overload
+*/
+bool Sodaq_WifiBee::openUDP(const String& server, uint16_t port)
+{
+  return openUDP(server.c_str(), port);
+}
+
+/*!
+* This method sends an ASCII chunk of data over an open UDP connection.
+* @param data The buffer containing the data to be sent.
+* @param waitForResponse Expect/wait for a reply from the server, default = true.
+* @return `true` if the data was successfully sent, otherwise `false`.
+*/
+bool Sodaq_WifiBee::sendUDPAscii(const char* data, const bool waitForResponse)
+{
+  return transmitAsciiData(data, waitForResponse);
+}
+
+/*!
+* \overload
+*/
+bool Sodaq_WifiBee::sendUDPAscii(const String& data, const bool waitForResponse)
+{
+  return sendUDPAscii(data.c_str(), waitForResponse);
+}
+
+/*!
+* This method sends a binary chunk of data over an open UDP connection.
+* @param data The buffer containing the data to be sent.
+* @param length The number of bytes, contained in `data`, to send.
+* @param waitForResponse Expect/wait for a reply from the server, default = true.
+* @return `true` if the data was successfully sent, otherwise `false`.
+*/
+bool Sodaq_WifiBee::sendUDPBinary(const uint8_t* data, const size_t length, const bool waitForResponse)
+{
+  return transmitBinaryData(data, length, waitForResponse);
+}
+
+/*!
+* This method closes an open UDP connection.
+* @return `true` if the connection was closed, otherwise `false`.
+* It will return `false` if the connection was already closed.
+*/
+bool Sodaq_WifiBee::closeUDP()
+{
+  return closeConnection();
+}
+
+/*!
+* This method copies the response data into a supplied buffer.
+* The amount of data copied is limited by the size of the supplied buffer.
+* Adds a terminating '\0'.
+* @param buffer The buffer to copy the data into.
+* @param size The size of `buffer`.
+* @param bytesRead The number of bytes copied is written to this parameter.
+* @return `false` if there is no data to copy, otherwise `true`.
+*/
+bool Sodaq_WifiBee::readResponseAscii(char* buffer, const size_t size, size_t& bytesRead)
+{
+  if (_bufferUsed == 0) {
+    return false;
+  }
+
+  bytesRead = ((size - 1) < _bufferUsed) ? (size - 1) : _bufferUsed;
+
+  memcpy(buffer, _buffer, bytesRead);
+  buffer[bytesRead] = '\0';
+
+  return true;
+}
+
+/*!
+* This method copies the response data into a supplied buffer.
+* The amount of data copied is limited by the size of the supplied buffer.
+* Does not add a terminating '\0'.
+* @param buffer The buffer to copy the data into.
+* @param size The size of `buffer`.
+* @param bytesRead The number of bytes copied is written to this parameter.
+* @return `false` if there is no data to copy, otherwise `true`.
+*/
+bool Sodaq_WifiBee::readResponseBinary(uint8_t* buffer, const size_t size, size_t& bytesRead)
+{
+  if (_bufferUsed == 0) {
+    return false;
+  }
+
+  bytesRead = (size < _bufferUsed) ? size : _bufferUsed;
+
+  memcpy(buffer, _buffer, bytesRead);
+
+  return true;
+}
+
+/*!
+* This method reads back the data received on the selected connection,
+* replacing the data stored. The NodeMCU queues the data of each
+* connection, so data can be sent on several connections without waiting
+* for a response, and their responses read back afterwards.
+* @param maxLength The maximum number of bytes to read back, the rest stays
+* queued on the NodeMCU. It is limited to the buffer size less one, the
+* space left for the terminating '\0'. 0 reads back all of it, dropping
+* what doesn't fit in the buffer.
+* @return `true` if the data was read back, otherwise `false`.
+*/
+bool Sodaq_WifiBee::readBackResponse(const size_t maxLength)
+{
+  if ((isBusy()) || (!_dataStream) || (_bufferSize < 2)) {
+    return false;
+  }
+
+  // Anything dequeued beyond the space for the data would be lost
+  size_t space = _bufferSize - 1;
+
+  return readServerResponse(false, (maxLength < space) ? maxLength : space);
+}
+
+/*!
+* This method reads any pending input, without waiting, for the events
+* of the selected connection.
+* @param received Set to `true` if data was reported received, otherwise
+* left unchanged. The report may have been skipped while waiting for
+* another prompt, so data may be queued without it.
+* @return `true` if the connection is open, otherwise `false`.
+*/
+bool Sodaq_WifiBee::pollConnection(bool& received)
+{
+  if ((!isBusy()) && (checkForEvents())) {
+    received = true;
+  }
+
+  return _connectionOpen;
+}
+
+/*!
+* This method copies the response data into a supplied buffer.
+* It skips the response and header lines and only copies the response body.
+* The amount of data copied is limited by the size of the supplied buffer.
+* Adds a terminating '\0'.
+* @param buffer The buffer to copy the data into.
+* @param size The size of `buffer`.
+* @param bytesRead The number of bytes copied is written to this parameter.
+* @param httpCode The HTTP response code is written to this parameter.
+* @return `false` if there is no data to copy, otherwise `true`.
+* It will return `false` if the body is empty or cannot be determined.
+*/
+bool Sodaq_WifiBee::readHTTPResponse(char* buffer, const size_t size,
+  size_t& bytesRead, uint16_t& httpCode)
+{
+  if (_bufferUsed == 0) {
+    return false;
+  }
+
+  // Read HTTP response code
+  parseHTTPResponse(httpCode);
+
+  // Add 4 to start from after the double newline
+  char* startPos = strstr((char*)_buffer, "\r\n\r\n") + 4;
+
+  size_t startIndex = startPos - (char*)_buffer;
+
+  if (startIndex < _bufferUsed) {
+    bytesRead = ((size - 1) < (_bufferUsed - startIndex)) ? (size - 1) : (_bufferUsed - startIndex);
+  }
+  else {
+    bytesRead = 0;
+  }
+
+  memcpy(buffer, startPos, bytesRead);
+  buffer[bytesRead] = '\0';
+
+  return true;
+}
+
+/*!
+* This method sets a sink which received data is written to as it is
+* read back from the device. The response can then be larger than the
+* internal buffer, which still holds the start of the response.
+* For HTTP requests only the response body is written to the sink. \n
+* The NodeMCU holds the connection while 2 KB are queued, where the
+* firmware supports it (net socket hold()). Otherwise at most 4 KB can
+* be received between read backs, the request then fails as the rest is
+* dropped, see readHTTPResponseData().
+* @param sink A reference to the sink, e.g. a file or a stream.
+*/
+void Sodaq_WifiBee::setResponseSink(Print& sink)
+{
+  _responseSink = &sink;
+}
+
+/*!
+* \overload
+* @param sink A pointer to the sink, NULL to remove the sink.
+*/
+void Sodaq_WifiBee::setResponseSink(Print* sink)
+{
+  _responseSink = sink;
+}
+
+// Tracing
+/*!
+* This method sets the ring buffer in which protocol events are traced.
+* Each event is a few bytes, recorded without any output, so tracing
+* can stay on without changing the timing. When the buffer is full the
+* oldest events are overwritten.
+* @param buffer The buffer, NULL to switch tracing off.
+* @param count The number of events `buffer` can hold.
+*/
+void Sodaq_WifiBee::setTraceBuffer(WifiBeeTraceEvent* buffer, const size_t count)
+{
+  _traceBuffer = (count > 0) ? buffer : NULL;
+  _traceSize = count;
+  _traceHead = 0;
+  _traceCount = 0;
+  _traceBytesOut = _stats.bytesOut;
+  _traceBytesIn = _stats.bytesIn;
+}
+
+/*!
+* This method prints the traced events, oldest first, one per line:
+* timestamp, type, detail, bytes written, bytes read.
+* @param stream The stream to print the events to.
+*/
+void Sodaq_WifiBee::dumpTrace(Print& stream)
+{
+  for (size_t i = 0; i < _traceCount; i++) {
+    const WifiBeeTraceEvent& event = _traceBuffer[(_traceHead + _traceSize - _traceCount + i) % _traceSize];
+
+    stream.print(event.timestamp);
+    stream.print(' ');
+    stream.print(TRACE_NAMES[event.type]);
+    stream.print(' ');
+    stream.print(event.detail);
+    stream.print(' ');
+    stream.print(event.bytesOut);
+    stream.print(' ');
+    stream.println(event.bytesIn);
+  }
+}
+
+/*!
+* This method returns the statistics collected since they were last reset.
+* The phase which is in progress, if any, is included up to now.
+* @return The statistics.
+*/
+const WifiBeeStats& Sodaq_WifiBee::getStats()
+{
+  updatePhase();
+
+  return _stats;
+}
+
+/*!
+* This method clears the statistics.
+*/
+void Sodaq_WifiBee::resetStats()
+{
+  memset(&_stats, 0, sizeof(_stats));
+
+  _phaseTS = millis();
+  _phaseBytesOut = 0;
+  _phaseBytesIn = 0;
+
+  _traceBytesOut = 0;
+  _traceBytesIn = 0;
+}
+
+// Stream implementations
+/*!
+* Implementation of Stream::write(x) \n
+* If `_dataStream != NULL` it calls `_dataStream->write(x)`.
+* @param x Data to pass to `_dataStream->write(x)`.
+* @return result of `_dataStream->write(x)` or 0 if `_dataStream == NULL`.
+*/
+size_t Sodaq_WifiBee::write(uint8_t x)
+{
+  if (_dataStream) {
+    _stats.bytesOut++;
+    return _dataStream->write(x);
+  }
+  else {
+    return 0;
+  }
+}
+
+/*!
+* Implementation of Print::write(buffer, size) \n
+* If `_dataStream != NULL` it calls `_dataStream->write(buffer, size)`.
+* @param buffer Data to pass to `_dataStream->write(buffer, size)`.
+* @param size The size of `buffer`.
+* @return result of `_dataStream->write(buffer, size)` or 0 if `_dataStream == NULL`.
+*/
+size_t Sodaq_WifiBee::write(const uint8_t* buffer, size_t size)
+{
+  if (_dataStream) {
+    _stats.bytesOut += size;
+    return _dataStream->write(buffer, size);
+  }
+  else {
+    return 0;
+  }
+}
+
+/*!
+* Implementation of Stream::available() \n
+* If `_dataStream != NULL` it calls `_dataStream->available()`.
+* @return result of `_dataStream->available()` or 0 if `_dataStream == NULL`.
+*/
+int Sodaq_WifiBee::available()
+{
+  if (_dataStream) {
+    return _dataStream->available();
+  }
+  else {
+    return 0;
+  }
+}
+
+/*!
+* Implementation of Stream::peek() \n
+* If `_dataStream != NULL` it calls `_dataStream->peek()`.
+* @return result of `_dataStream->peek()` or -1 if `_dataStream == NULL`.
+*/
+int Sodaq_WifiBee::peek()
+{
+  if (_dataStream) {
+    return _dataStream->peek();
+  }
+  else {
+    return -1;
+  }
+}
+
+/*!
+* Implementation of Stream::read() \n
+* If `_dataStream != NULL` it calls `_dataStream->read()`.
+* @return result of `_dataStream->read()` or -1 if `_dataStream == NULL`.
+*/
+int Sodaq_WifiBee::read()
+{
+  if (_dataStream) {
+    return _dataStream->read();
+  }
+  else {
+    return -1;
+  }
+}
+
+/*!
+* Implementation of Stream::flush() \n
+* If `_dataStream != NULL` it calls `_dataStream->flush()`.
+*/
+void Sodaq_WifiBee::flush() {
+  if (_dataStream) {
+    _dataStream->flush();
+  }
+}
+
+// Private methods
+/*!
+* This method checkes if the WifiBee is on.
+* It attempts to call _onoff::isOn().
+* @return `true` if the WifiBee is on, `false` otherwise.
+*/
+bool Sodaq_WifiBee::isOn()
+{
+  if (_onoff) {
+    return _onoff->isOn();
+  }
+
+  // No onoff. Let's assume it is on.
+  return true;
+}
+
+/*!
+* This method reads and empties the input buffer of `_dataStream`.
+* It attempts to output the data it reads to `_diagStream`.
+*/
+void Sodaq_WifiBee::flushInputStream()
+{
+  while (available()) {
+    char c = readInput();
+    diagData(c);
+  }
+}
+
+/*!
+* This method reads and empties the input buffer of `_dataStream`.
+* It continues until the specified amount of time has elapsed.
+* It attempts to output the data it reads to `_diagStream`.
+* @param timeMS The time limit in milliseconds.
+* @return The number of bytes it read.
+*/
+int Sodaq_WifiBee::skipForTime(const uint32_t timeMS)
+{
+  if (!_dataStream) {
+    return 0;
+  }
+
+  int count = 0;
+  uint32_t startTS = millis();
+
+  while (!timedOut32(startTS, timeMS)) {
+    if (available()) {
+      char c = readInput();
+      diagData(c);
+      count++;
+    }
+    else {
+      idle(startTS, timeMS);
+    }
+  }
+
+  return count;
+}
+
+/*!
+* This method reads and empties the input buffer of `_dataStream`.
+* It continues until it finds the specified prompt or until
+* the specified amount of time has elapsed.
+* It attempts to output the data it reads to `_diagStream`.
+* @param prompt The prompt to read until.
+* @param timeMS The time limit in milliseconds.
+* @return `true` if it found the specified prompt within the time
+* limit, otherwise `false`.
+*/
+bool Sodaq_WifiBee::skipTillPrompt(const char* prompt, const uint32_t timeMS)
+{
+  return (skipTillEvent(&prompt, 1, timeMS) == 0);
+}
+
+/*!
+* This method reads and empties the input buffer of `_dataStream`.
+* It continues until it finds any of the specified prompts or until
+* the specified amount of time has elapsed.
+* Each character read is matched against all of the prompts in one pass.
+* A disconnect prompt also marks the connection as closed.
+* It attempts to output the data it reads to `_diagStream`.
+* @param prompts The prompts to read until (up to MAX_EVENT_PROMPTS).
+* @param count The number of entries in `prompts`.
+* @param timeMS The time limit in milliseconds.
+* @return The index of the prompt found within the time
+* limit, otherwise -1.
+*/
+int8_t Sodaq_WifiBee::skipTillEvent(const char* const* prompts,
+  const uint8_t count, const uint32_t timeMS)
+{
+  if ((!_dataStream) || (count > MAX_EVENT_PROMPTS)) {
+    return -1;
+  }
+
+  int8_t result = -1;
+
+  uint32_t startTS = millis();
+
+  size_t index[MAX_EVENT_PROMPTS] = { 0 };
+  uint8_t fallback[MAX_EVENT_PROMPTS][MAX_PROMPT_LENGTH];
+
+  for (uint8_t i = 0; i < count; i++) {
+    preparePrompt(prompts[i], fallback[i]);
+  }
+
+  while ((!timedOut32(startTS, timeMS)) && (result < 0)) {
+    if (available()) {
+      char c = readInput();
+      diagData(c);
+
+      for (uint8_t i = 0; i < count; i++) {
+        index[i] = advancePrompt(prompts[i], fallback[i], index[i], c);
+
+        if (prompts[i][index[i]] == '\0') {
+          result = i;
+          break;
+        }
+      }
+    }
+    else {
+      idle(startTS, timeMS);
+    }
+  }
+
+  if ((result >= 0) && (strncmp(prompts[result], DISCONNECT_PROMPT, DISCONNECT_PREFIX_LENGTH) == 0)) {
+    _connectionOpen = false;
+  }
+
+  if (result >= 0) {
+    trace(WIFIBEE_TRACE_PROMPT, result);
+  }
+  else {
+    trace(WIFIBEE_TRACE_TIMEOUT, 0);
+  }
+  countWait(result >= 0);
+
+  return result;
+}
+
+/*!
+* This method reads a character from `_dataStream` for the prompt
+* matchers. It counts it in the statistics and, as the sent events of
+* streamed payloads may arrive during any wait, matches it against them.
+* @return The character read, or -1 if none is available.
+*/
+int Sodaq_WifiBee::readInput()
+{
+  if (!_dataStream) {
+    return -1;
+  }
+
+  int c = _dataStream->read();
+
+  if (c >= 0) {
+    _stats.bytesIn++;
+
+    if (_sendsPending > 0) {
+      countSent(c);
+    }
+  }
+
+  return c;
+}
+
+/*!
+* This method reads one character from the input buffer of `_dataStream`.
+* It continues until it reads one character or until the specified amount
+* of time has elapsed. It attempts to output the data it read to `_diagStream`.
+* @param data The character read, is written to this parameter.
+* @param timeMS The time limit in milliseconds.
+* @return `true` if it successfully read one character within the
+* time limit, otherwise `false`.
+*/
+bool Sodaq_WifiBee::readChar(char& data, const uint32_t timeMS)
+{
+  if (!_dataStream) {
+    return false;
+  }
+
+  bool result = false;
+
+  uint32_t startTS = millis();
+  while ((!timedOut32(startTS, timeMS)) && (!result)) {
+    if (available()) {
+      data = readInput();
+      diagData(data);
+      result = true;
+    }
+    else {
+      idle(startTS, timeMS);
+    }
+  }
+
+  return result;
+}
+
+/*!
+* This method reads and empties the input buffer of `_dataStream`.
+* It continues until it finds the specified prompt or until
+* the specified amount of time has elapsed.
+* It copies the read data into the buffer supplied.
+* It attempts to output the data it reads to `_diagStream`.
+* @param buffer The buffer to copy the data into.
+* @param size The size of `buffer`.
+* @param bytesStored The number of bytes copied is written to this parameter.
+* @param prompt The prompt to read until.
+* @param timeMS The time limit in milliseconds.
+* @return `true` if it found the specified prompt within the time
+* limit, otherwise `false`.
+*/
+bool Sodaq_WifiBee::readTillPrompt(uint8_t* buffer, const size_t size,
+  size_t& bytesStored, const char* prompt, const uint32_t timeMS)
+{
+  if (!_dataStream) {
+    return false;
+  }
+
+  bool result = false;
+
+  uint32_t startTS = millis();
+  size_t promptIndex = 0;
+  size_t promptLen = strlen(prompt);
+  uint8_t fallback[MAX_PROMPT_LENGTH];
+
+  preparePrompt(prompt, fallback);
+
+  size_t bufferIndex = 0;
+  size_t streamCount = 0;
+
+  while (!timedOut32(startTS, timeMS)) {
+    if (available()) {
+      char c = readInput();
+      diagData(c);
+
+      streamCount++;
+
+      if (bufferIndex < size) {
+        buffer[bufferIndex] = c;
+        bufferIndex++;
+      }
+
+      promptIndex = advancePrompt(prompt, fallback, promptIndex, c);
+
+      if (promptIndex == promptLen) {
+        result = true;
+        bufferIndex = ((size - 1) < (streamCount - promptLen)) ? (size - 1) : (streamCount - promptLen);
+        break;
+      }
+    }
+    else {
+      idle(startTS, timeMS);
+    }
+  }
+
+  bytesStored = bufferIndex;
+
+  return result;
+}
+
+/*!
+* This method reads and empties the input buffer of `_dataStream`.
+* It continues until it finds the specified prompt or until
+* the specified amount of time has elapsed.
+* The source data is converted from HEX and copied to the
+* buffer supplied, any bytes which do not fit are discarded.
+* All of them are passed on to the response sink.
+* A terminating '\0' is added.
+* The first letter of the prompt cannot be a valid Hex char.
+* The time limit applies to each period without any data being received.
+* It attempts to output the data it reads to `_diagStream`.
+* @param buffer The buffer to copy the data into.
+* @param size The size of `buffer`.
+* @param bytesStored The number of bytes copied is written to this parameter.
+* @param bytesReceived The number of bytes converted, including any
+* discarded, is written to this parameter.
+* @param prompt The prompt to read until.
+* @param timeMS The time limit in milliseconds.
+* @return `true` if it found the specified prompt within the time
+* limit, otherwise `false`.
+*/
+bool Sodaq_WifiBee::readHexTillPrompt(uint8_t* buffer, const size_t size,
+  size_t& bytesStored, size_t& bytesReceived, const char* prompt,
+  const uint32_t timeMS)
+{
+  bytesStored = 0;
+  bytesReceived = 0;
+
+  if ((!_dataStream) || (size == 0)) {
+    return false;
+  }
+
+  bool result = false;
+
+  uint32_t startTS = millis();
+  size_t promptIndex = 0;
+  size_t promptLen = strlen(prompt);
+  uint8_t fallback[MAX_PROMPT_LENGTH];
+
+  preparePrompt(prompt, fallback);
+
+  char high = 0;
+  bool even = false;
+
+  while (!timedOut32(startTS, timeMS)) {
+    if (available()) {
+      startTS = millis();
+      char c = readInput();
+      diagData(c);
+
+      promptIndex = advancePrompt(prompt, fallback, promptIndex, c);
+
+      if (promptIndex == promptLen) {
+        result = true;
+        break;
+      }
+
+      if (promptIndex == 0) {
+        if (even) {
+          uint8_t value = HEX2BYTE(high, c);
+          writeToSink(&value, 1);
+
+          // Keep one byte for the terminating '\0'
+          if (bytesStored < (size - 1)) {
+            buffer[bytesStored] = value;
+            bytesStored++;
+          }
+          bytesReceived++;
+        }
+        else {
+          high = c;
+        }
+        even = !even;
+      }
+    }
+    else {
+      idle(startTS, timeMS);
+    }
+  }
+
+  buffer[bytesStored] = '\0';
+
+  return result;
+}
+
+/*!
+* This method reads a length prefixed block of raw bytes from `_dataStream`.
+* The block starts with the length in decimal followed by '|'.
+* The bytes are copied to the buffer supplied, any which do not fit
+* are read and discarded. All of them are passed on to the response sink.
+* It then continues until it finds the
+* specified prompt or until the specified amount of time has elapsed.
+* The time limit applies to each period without any data being received.
+* A terminating '\0' is added.
+* @param buffer The buffer to copy the data into.
+* @param size The size of `buffer`.
+* @param bytesStored The number of bytes copied is written to this parameter.
+* @param bytesReceived The number of bytes read, including any
+* discarded, is written to this parameter.
+* @param prompt The prompt to read until, after the block.
+* @param timeMS The time limit in milliseconds.
+* @return `true` if it read the whole block and found the specified prompt
+* within the time limit, otherwise `false`.
+*/
+bool Sodaq_WifiBee::readRawTillPrompt(uint8_t* buffer, const size_t size,
+  size_t& bytesStored, size_t& bytesReceived, const char* prompt,
+  const uint32_t timeMS)
+{
+  bytesStored = 0;
+  bytesReceived = 0;
+
+  if ((!_dataStream) || (size == 0)) {
+    return false;
+  }
+
+  bool result;
+  size_t length = 0;
+  char c = 0;
+
+  // Read the length
+  while ((result = readChar(c, timeMS)) && (c >= '0') && (c <= '9')) {
+    length = (length * 10) + (c - '0');
+  }
+
+  result = result && (c == '|');
+
+  uint32_t startTS = millis();
+  size_t remaining = length;
+  uint8_t chunk[16];
+
+  while (result && (remaining > 0)) {
+    size_t count = available();
+
+    if (count > 0) {
+      startTS = millis();
+
+      if (count > remaining) {
+        count = remaining;
+      }
+
+      // Keep one byte for the terminating '\0'
+      size_t space = size - 1 - bytesStored;
+      if (space > 0) {
+        if (count > space) {
+          count = space;
+        }
+        count = _dataStream->readBytes(&buffer[bytesStored], count);
+        writeToSink(&buffer[bytesStored], count);
+        bytesStored += count;
+      }
+      else {
+        if (count > sizeof(chunk)) {
+          count = sizeof(chunk);
+        }
+        count = _dataStream->readBytes(chunk, count);
+        writeToSink(chunk, count);
+      }
+
+      remaining -= count;
+      bytesReceived += count;
+      _stats.bytesIn += count;
+    }
+    else if (timedOut32(startTS, timeMS)) {
+      result = false;
+    }
+    else {
+      idle(startTS, timeMS);
+    }
+  }
+
+  buffer[bytesStored] = '\0';
+
+  if (result) {
+    result = skipTillPrompt(prompt, timeMS);
+  }
+
+  return result;
+}
+
+/*!
+* This method uploads data to the send buffer.
+* The send buffer is stored on the NodeMCU and is transmitted
+* once the data to be sent has been uploaded to it.
+* It sends it in chunks so to comply with the LUA command limits.
+*/
+void Sodaq_WifiBee::sendAscii(const char* data)
+{
+  bool escape = false;
+
+  for (const char* c = data; *c != '\0'; c++) {
+    // Don't divide an escape sequence between lines
+    if (!escape) {
+      reserveUpload((*c == '\\') ? 2 : 1);
+    }
+
+    _uploadLine[_uploadUsed++] = *c;
+    escape = (!escape) && (*c == '\\');
+  }
+}
+
+/*!
+* This method uploades escaped ASCII data to the send buffer.
+* The send buffer is stored on the NodeMCU and is transmitted
+* once the data to be sent has been uploaded to it.
+* It only escapes specific LUA characters.
+* @param data The buffer containing the ASCII data to send.
+*/
+void Sodaq_WifiBee::sendEscapedAscii(const char* data)
+{
+  for (const char* c = data; *c != '\0'; c++) {
+    reserveUpload(2);
+    _uploadUsed += escapeAsciiChar(*c, &_uploadLine[_uploadUsed]);
+  }
+}
+
+/*!
+* This method uploades escaped binary data to the send buffer.
+* The send buffer is stored on the NodeMCU and is transmitted
+* once the data to be sent has been uploaded to it.
+* It only escapes the bytes which cannot be sent as they are,
+* see escapeBinaryByte().
+* @param data The buffer containing the binary data to send.
+* @param length The size of `data`.
+*/
+void Sodaq_WifiBee::sendEscapedBinary(const uint8_t* data, const size_t length)
+{
+  char escaped[4];
+
+  for (size_t index = 0; index < length; index++) {
+    // A numeric escape must not run into a following digit
+    bool padded = ((index + 1) < length) && (data[index + 1] >= '0') && (data[index + 1] <= '9');
+    size_t escapedLength = escapeBinaryByte(data[index], padded, escaped);
+
+    reserveUpload(escapedLength);
+    memcpy(&_uploadLine[_uploadUsed], escaped, escapedLength);
+    _uploadUsed += escapedLength;
+  }
+}
+
+/*!
+* This method makes room for data in the upload line.
+* If the line can't fit `length` more characters it is uploaded,
+* and a new line is started.
+* @param length The number of characters to make room for.
+*/
+void Sodaq_WifiBee::reserveUpload(const size_t length)
+{
+  if ((_uploadUsed + length) > UPLOAD_DATA_END) {
+    flushUploadLine();
+  }
+
+  if ((_uploadUsed == 0) && (_uploadStart)) {
+    memcpy(_uploadLine, UPLOAD_START, UPLOAD_START_LENGTH);
+    _uploadUsed = UPLOAD_START_LENGTH;
+    _uploadStart = false;
+  }
+  else if (_uploadUsed == 0) {
+    memcpy(_uploadLine, UPLOAD_PREFIX, UPLOAD_PREFIX_LENGTH);
+    _uploadUsed = UPLOAD_PREFIX_LENGTH;
+  }
+}
+
+/*!
+* This method ends an upload line and writes it to the NodeMCU,
+* with a single bulk write.
+* @param length The length of the line in `_uploadLine`.
+*/
+void Sodaq_WifiBee::writeUploadLine(const size_t length)
+{
+  memcpy(&_uploadLine[length], UPLOAD_SUFFIX, UPLOAD_SUFFIX_LENGTH);
+  write((const uint8_t*)_uploadLine, length + UPLOAD_SUFFIX_LENGTH);
+}
+
+/*!
+* This method uploads the current upload line, if any.
+*/
+void Sodaq_WifiBee::flushUploadLine()
+{
+  if (_uploadUsed > 0) {
+    writeUploadLine(_uploadUsed);
+    _uploadUsed = 0;
+    uploadLineSent();
+  }
+}
+
+/*!
+* This method records that an upload line has been sent.
+* It only waits for a prompt once the upload window is full.
+*/
+void Sodaq_WifiBee::uploadLineSent()
+{
+  _uploadPending++;
+
+  while (_uploadPending >= _uploadWindow) {
+    if (!skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT)) {
+      // Out of sync, there is no point waiting for the rest
+      _uploadPending = 0;
+      break;
+    }
+    _uploadPending--;
+  }
+}
+
+/*!
+* This method waits for the prompts of all upload lines still in flight.
+* @return `true` if all the prompts were received, otherwise `false`.
+*/
+bool Sodaq_WifiBee::waitForUpload()
+{
+  bool result = true;
+
+  while (_uploadPending > 0) {
+    result = skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT);
+    if (!result) {
+      _uploadPending = 0;
+      break;
+    }
+    _uploadPending--;
+  }
+
+  return result;
+}
+
+/*!
+* This method prepares the upload of a streamed payload. Once the send
+* window is full, it waits for the oldest queued payload to be sent.
+* The first upload line replaces the send buffer, which saves the round
+* trip of clearing it.
+* @return `true` if the payload can be uploaded, `false` if the connection
+* is closed or the wait timed out.
+*/
+bool Sodaq_WifiBee::beginStream()
+{
+  if (!_connectionOpen) {
+    return false;
+  }
+
+  if (_sendsPending == 0) {
+    // The prompts are kept, other waits may tag prompts in the meantime
+    const char* const* prompts = connectionEvents(SENT_EVENTS, EVENT_COUNT(SENT_EVENTS));
+
+    for (uint8_t i = 0; i < EVENT_COUNT(SENT_EVENTS); i++) {
+      strcpy(_sendPrompts[i], prompts[i]);
+      preparePrompt(_sendPrompts[i], _sendPromptFallback[i]);
+      _sendPromptIndex[i] = 0;
+    }
+  }
+  else if (!waitForSends(_sendWindow - 1)) {
+    return false;
+  }
+
+  _uploadUsed = 0;
+  _uploadStart = true;
+
+  return true;
+}
+
+/*!
+* This method waits until no more than `limit` streamed payloads are
+* waiting to be sent. The sent events are counted by readInput(), so this
+* only has to read until enough of them have arrived.
+* @param limit The number of payloads which may still be waiting.
+* @return `true` if the connection is still open and the wait did not
+* time out, otherwise `false`.
+*/
+bool Sodaq_WifiBee::waitForSends(const uint8_t limit)
+{
+  if (_sendsPending <= limit) {
+    return _connectionOpen;
+  }
+
+  uint8_t outer = startPhase(WIFIBEE_PHASE_UPLOAD);
+
+  uint32_t startTS = millis();
+  uint8_t pending = _sendsPending;
+
+  while (_sendsPending > limit) {
+    if (timedOut32(startTS, RESPONSE_TIMEOUT)) {
+      // The remaining payloads can't be accounted for
+      _sendsPending = 0;
+      trace(WIFIBEE_TRACE_TIMEOUT, 0);
+      countWait(false);
+      endPhase(outer);
+
+      return false;
+    }
+
+    if (available()) {
+      char c = readInput();
+      diagData(c);
+
+      // Each payload sent restarts the time limit
+      if (_sendsPending < pending) {
+        pending = _sendsPending;
+        startTS = millis();
+      }
+    }
+    else {
+      idle(startTS, RESPONSE_TIMEOUT);
+    }
+  }
+
+  endPhase(outer);
+
+  return _connectionOpen;
+}
+
+/*!
+* This method matches a received character against the sent and
+* disconnect prompts of the streaming connection. A disconnect ends the
+* stream, the payloads still queued won't be sent.
+* @param c The character received.
+*/
+void Sodaq_WifiBee::countSent(const char c)
+{
+  for (uint8_t i = 0; i < EVENT_COUNT(SENT_EVENTS); i++) {
+    _sendPromptIndex[i] = advancePrompt(_sendPrompts[i], _sendPromptFallback[i], _sendPromptIndex[i], c);
+
+    if (_sendPrompts[i][_sendPromptIndex[i]] == '\0') {
+      _sendPromptIndex[i] = 0;
+
+      if (i == 0) {
+        _sendsPending--;
+        trace(WIFIBEE_TRACE_PROMPT, i);
+        countWait(true);
+      }
+      else {
+        _sendsPending = 0;
+        _connectionOpen = false;
+        trace(WIFIBEE_TRACE_PROMPT, i);
+      }
+    }
+  }
+}
+
+/*!
+* This method loads the helper script on the NodeMCU.
+* If the helper is missing, or is an older version, it is installed
+* on the file system first. This only happens once per device.
+* @return `true` if the helper was loaded, otherwise `false`.
+*/
+bool Sodaq_WifiBee::loadHelper()
+{
+  int8_t event;
+
+  println(HELPER_LOAD);
+  event = skipTillEvent(HELPER_EVENTS, EVENT_COUNT(HELPER_EVENTS), RESPONSE_TIMEOUT);
+
+  if (event == 1) {
+    diagPrintLn("\r\nInstalling " HELPER_FILE);
+
+    for (uint8_t step = 0; step < INSTALL_COMMANDS; step++) {
+      sendInstallCommand(step);
+      skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT);
+    }
+
+    println(HELPER_LOAD);
+    event = skipTillEvent(HELPER_EVENTS, EVENT_COUNT(HELPER_EVENTS), RESPONSE_TIMEOUT);
+  }
+
+  return (event == 0);
+}
+
+/*!
+* This method switches off the NodeMCU's echo.
+* It is only switched off if the baud rate of the stream is known.
+* @return `true` if the echo was switched off or left on,
+* `false` if the prompt wasn't received.
+*/
+bool Sodaq_WifiBee::disableEcho()
+{
+  if (_baudRate == 0) {
+    diagPrintLn("\r\nEcho not switched off, the baud rate is unknown");
+    return true;
+  }
+
+  sendUARTCommand(_baudRate);
+  _echoOff = true;
+
+  // Without the echo only the new prompt is received
+  return skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT);
+}
+
+/*!
+* This method sends the command which sets up the NodeMCU's UART.
+* The echo is switched off unless it is enabled.
+* @param baudRate The new baud rate.
+*/
+void Sodaq_WifiBee::sendUARTCommand(const uint32_t baudRate)
+{
+  print("uart.setup(0,");
+  print(baudRate);
+  println(_echo ? ",8,0,1,1)" : ",8,0,1,0)");
+}
+
+/*!
+* This method checks if the WifiBee responds at the current baud rate.
+* Any partial command (e.g. garbage received at the wrong rate) is
+* ended first.
+* @return `true` if an "OK" response was received, `false` otherwise.
+*/
+bool Sodaq_WifiBee::ping()
+{
+  flushInputStream();
+
+  println();
+  println(OK_COMMAND);
+
+  return skipTillPrompt(OK_PROMPT, PING_TIMEOUT);
+}
+
+/*!
+* This method switches both ends of the UART to a new baud rate.
+* The echo setting is applied at the same time.
+* @param baudRate The new baud rate.
+* @return `true` if the WifiBee responds at the new rate, otherwise `false`.
+*/
+bool Sodaq_WifiBee::switchBaudRate(const uint32_t baudRate)
+{
+  if (!_serial) {
+    return false;
+  }
+
+  sendUARTCommand(baudRate);
+  _serial->flush();
+  _serial->begin(baudRate);
+
+  _fastUART = true;
+  _echoOff = !_echo;
+
+  // Allow the NodeMCU to set up its UART
+  skipForTime(BAUD_SWITCH_DELAY);
+
+  return ping();
+}
+
+/*!
+* This method switches the WifiBee off and on again, which returns
+* the NodeMCU's UART to its boot rate.
+*/
+void Sodaq_WifiBee::restart()
+{
+  off();
+
+  diagPrintLn("\r\nPower ON");
+  if (_onoff) {
+    _onoff->on();
+  }
+
+  skipTillPrompt(luaPrompt(), WAKE_DELAY);
+}
+
+/*!
+* This method measures the rate at which the data written by the NodeMCU
+* is received, by requesting THROUGHPUT_BYTES bytes.
+* @return The throughput in bytes per second, 0 if it failed.
+*/
+uint32_t Sodaq_WifiBee::measureThroughput()
+{
+  uint32_t result = 0;
+
+  print("uart.write(0, \"|\" .. \"SOF|\", string.rep(\"U\", ");
+  print(THROUGHPUT_BYTES);
+  println("), \"|EOF|\")");
+
+  if (skipTillPrompt(SOF_PROMPT, RESPONSE_TIMEOUT)) {
+    // The bytes received while the prompt was being found aren't timed
+    uint32_t startTS = micros();
+    int buffered = _dataStream->available();
+
+    if (skipTillPrompt(eofPrompt(), RESPONSE_TIMEOUT)) {
+      uint32_t elapsed = micros() - startTS;
+      uint32_t timed = THROUGHPUT_BYTES + strlen(eofPrompt());
+
+      if ((elapsed > 0) && (buffered >= 0) && ((uint32_t)buffered < timed)) {
+        result = ((uint64_t)(timed - buffered) * 1000000) / elapsed;
+      }
+    }
+  }
+
+  return result;
+}
+
+/*!
+* This method sends one of the commands which install the helper.
+* The commands open the file, write the lines of the script
+* and finally close the file.
+* @param step The command to send (0..INSTALL_COMMANDS-1).
+*/
+void Sodaq_WifiBee::sendInstallCommand(const uint8_t step)
+{
+  if (step == 0) {
+    println("file.open(\"" HELPER_FILE "\", \"w+\")");
+  }
+  else if (step <= HELPER_LINES) {
+    print("file.writeline([==[");
+    print(HELPER_SCRIPT[step - 1]);
+    println("]==])");
+  }
+  else {
+    println("file.close()");
+  }
+}
+
+/*!
+* This method opens a TCP or UDP connection to a remote server.
+* It switches the device on and joins the network first.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param type The type of connection to establish, TCP or UDP.
+* @return `true` if the connection was successfully established,
+* otherwise `false`.
+*/
+bool Sodaq_WifiBee::openConnection(const char* server, const uint16_t port,
+  const char* type)
+{
+  // The socket still open on the selected connection would be orphaned
+  if (connectionInUse()) {
+    diagPrintLn("Connection already open");
+    return false;
+  }
+
+  bool result;
+
+  // While another connection is open the device is already on and joined
+  bool shared = otherConnectionOpen();
+
+  result = (shared) || (on());
+
+  // A device resumed from standby is still joined
+  bool resumed = (!shared) && (result) && (_joined);
+
+  if ((result) && (!shared) && (!resumed)) {
+    result = connect();
+  }
+
+  if (result) {
+    wakeDone();
+    result = openSocket(server, port, type);
+  }
+
+  // Unless the network was lost in the meantime
+  if ((!result) && (resumed)) {
+    result = connect();
+
+    if (result) {
+      result = openSocket(server, port, type);
+    }
+  }
+
+  _waking = false;
+
+  return result;
+}
+
+/*!
+* This method creates the connection object on the NodeMCU and
+* connects it to a remote server. The network must already be joined.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param type The type of connection to establish, TCP or UDP.
+* @return `true` if the connection was successfully established,
+* otherwise `false`.
+*/
+bool Sodaq_WifiBee::openSocket(const char* server, const uint16_t port,
+  const char* type)
+{
+  bool result;
+  uint8_t outer = startPhase(WIFIBEE_PHASE_SOCKET);
+
+  sendOpenCommand(server, port, type);
+
+  // A failed connection attempt ends with a (re)disconnect instead
+  result = (skipTillEvent(CONNECTION_EVENTS(CONNECT_EVENTS),
+    SERVER_CONNECT_TIMEOUT) == 0);
+  _connectionOpen = result;
+
+  endPhase(outer);
+
+  return result;
+}
+
+/*!
+* This method checks if the selected connection is still open, e.g. by an
+* HTTP session or openTCP(). A disconnect already reported is taken into
+* account, without waiting.
+* @return `true` if it is open, otherwise `false`.
+*/
+bool Sodaq_WifiBee::connectionInUse()
+{
+  checkForEvents();
+
+  return _connectionOpen;
+}
+
+/*!
+* This method sends the command which opens a connection.
+* The helper creates the connection object, sets up its callbacks and
+* connects it to the remote server.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param type The type of connection to establish, TCP or UDP.
+*/
+void Sodaq_WifiBee::sendOpenCommand(const char* server, const uint16_t port,
+  const char* type)
+{
+  print("wb.o(");
+  print(type);
+  print(",");
+  print(port);
+  print(",\"");
+  print(server);
+  print("\"");
+  if (_handle > 0) {
+    print(",");
+    print(_handle);
+  }
+  println(")");
+}
+
+/*!
+* This method sends a command for the selected connection.
+* @param command The command up to its opening parenthesis, e.g. "wb.s(".
+* @param limit An optional second argument, 0 if none.
+*/
+void Sodaq_WifiBee::sendConnectionCommand(const char* command, const size_t limit)
+{
+  print(command);
+  if ((_handle > 0) || (limit > 0)) {
+    print(_handle);
+  }
+  if (limit > 0) {
+    print(",");
+    print(limit);
+  }
+  println(")");
+}
+
+/*!
+* This method tags a set of connection prompts with the handle of the
+* selected connection, e.g. "|DS|" becomes "|DS2|". The prompts of
+* connection 0 are not tagged. The tagged prompts remain valid until
+* the next call.
+* @param prompts The untagged prompts.
+* @param count The number of entries in `prompts` (<= MAX_EVENT_PROMPTS).
+* @return The prompts of the selected connection.
+*/
+const char* const* Sodaq_WifiBee::connectionEvents(const char* const* prompts,
+  const uint8_t count)
+{
+  if (_handle == 0) {
+    return prompts;
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    // The handle goes before the closing '|'
+    size_t length = strlen(prompts[i]) - 1;
+
+    memcpy(_taggedPrompts[i], prompts[i], length);
+    _taggedPrompts[i][length] = '0' + _handle;
+    _taggedPrompts[i][length + 1] = '|';
+    _taggedPrompts[i][length + 2] = '\0';
+
+    _taggedEvents[i] = _taggedPrompts[i];
+  }
+
+  return _taggedEvents;
+}
+
+/*!
+* This method stores the state of the selected connection in `_connections`.
 */
-int Sodaq_WifiBee::skipForTime(const uint32_t timeMS)
+void Sodaq_WifiBee::saveConnection()
 {
-  if (!_dataStream) {
-    return 0;
+  WifiBeeConnection& connection = _connections[_handle];
+
+  connection.buffer = _buffer;
+  connection.bufferSize = _bufferSize;
+  connection.bufferUsed = _bufferUsed;
+  connection.responseLength = _responseLength;
+  connection.responseDropped = _responseDropped;
+  connection.open = _connectionOpen;
+}
+
+/*!
+* This method restores the state of the selected connection from `_connections`.
+*/
+void Sodaq_WifiBee::loadConnection()
+{
+  WifiBeeConnection& connection = _connections[_handle];
+
+  _buffer = connection.buffer;
+  _bufferSize = connection.bufferSize;
+  _bufferUsed = connection.bufferUsed;
+  _responseLength = connection.responseLength;
+  _responseDropped = connection.responseDropped;
+  _connectionOpen = connection.open;
+}
+
+/*!
+* This method checks if a connection other than the selected one is open.
+* @return `true` if one is open, otherwise `false`.
+*/
+bool Sodaq_WifiBee::otherConnectionOpen()
+{
+  for (uint8_t i = 0; i < WIFIBEE_MAX_CONNECTIONS; i++) {
+    if ((i != _handle) && (_connections[i].open)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*!
+* This method closes a TCP or UDP connection to a remote server,
+* then applies the power policy.
+* @return `true` if the connection was closed, otherwise `false`.
+* It will return `false` if the connection was already closed.
+*/
+bool Sodaq_WifiBee::closeConnection()
+{
+  bool result = false;
+
+  // The streamed data is sent first
+  waitForSends(0);
+
+  uint8_t outer = startPhase(WIFIBEE_PHASE_CLOSE);
+
+  // Don't wait for a disconnect which has already been seen
+  if (_connectionOpen) {
+    sendConnectionCommand(CLOSE_COMMAND);
+    result = (skipTillEvent(CONNECTION_EVENTS(DISCONNECT_EVENTS), SERVER_DISCONNECT_TIMEOUT) == 0);
+    _connectionOpen = false;
+  }
+
+  standby();
+
+  endPhase(outer);
+
+  return result;
+}
+
+/*!
+* This method reads any pending input, without waiting, to find out
+* if data has been received on the selected connection, or if it has
+* been closed by the remote server.
+* @return `true` if data was reported received, otherwise `false`.
+*/
+bool Sodaq_WifiBee::checkForEvents()
+{
+  // The received and disconnect prompts
+  const char* const* prompts = connectionEvents(RECEIVED_EVENTS, EVENT_COUNT(RECEIVED_EVENTS));
+  size_t index[EVENT_COUNT(RECEIVED_EVENTS)] = { 0 };
+  uint8_t fallback[EVENT_COUNT(RECEIVED_EVENTS)][MAX_PROMPT_LENGTH];
+  bool received = false;
+
+  for (uint8_t i = 0; i < EVENT_COUNT(RECEIVED_EVENTS); i++) {
+    preparePrompt(prompts[i], fallback[i]);
+  }
+
+  while (available()) {
+    char c = readInput();
+    diagData(c);
+
+    for (uint8_t i = 0; i < EVENT_COUNT(RECEIVED_EVENTS); i++) {
+      index[i] = advancePrompt(prompts[i], fallback[i], index[i], c);
+
+      if (prompts[i][index[i]] == '\0') {
+        if (i == 0) {
+          received = true;
+        }
+        else {
+          _connectionOpen = false;
+        }
+        index[i] = 0;
+      }
+    }
+  }
+
+  return received;
+}
+
+/*!
+* This method checks if an HTTP session is open on the selected connection
+* for a server and port.
+* @param server The server/host of the request.
+* @param port The port of the request.
+* @return `true` if the request can use the open session, otherwise `false`.
+*/
+bool Sodaq_WifiBee::isSessionFor(const char* server, const uint16_t port)
+{
+  return (_sessionOpen && (_sessionHandle == _handle) && (_sessionPort == port) &&
+    (strcmp(_sessionServer.c_str(), server) == 0));
+}
+
+/*!
+* This method transmits ASCII data over an open TCP or UDP connection.
+* @param data The data to transmit.
+* @param waitForResponse Expect/wait for a reply from the server, default = true.
+* @return `true` if the data was successfully transmitted,
+* otherwise `false`.
+*/
+bool Sodaq_WifiBee::transmitAsciiData(const char* data, const bool waitForResponse)
+{
+  uint8_t outer = startPhase(WIFIBEE_PHASE_UPLOAD);
+
+  createSendBuffer();
+  sendEscapedAscii(data);
+  transmitSendBuffer();
+
+  bool result;
+  result = (skipTillEvent(CONNECTION_EVENTS(SENT_EVENTS), RESPONSE_TIMEOUT) == 0);
+
+  if (result && waitForResponse) {
+    startPhase(WIFIBEE_PHASE_SERVER_WAIT);
+
+    if (skipTillEvent(CONNECTION_EVENTS(RECEIVED_EVENTS), SERVER_RESPONSE_TIMEOUT) == 0) {
+      readServerResponse();
+    }
+    else {
+      clearBuffer();
+    }
+  }
+
+  endPhase(outer);
+
+  return result;
+}
+
+/*!
+* This method transmits binary data over an open TCP or UDP connection.
+* @param data The data to transmit.
+* @param waitForResponse Expect/wait for a reply from the server, default = true.
+* @return `true` if the data was successfully transmitted,
+* otherwise `false`.
+*/
+bool Sodaq_WifiBee::transmitBinaryData(const uint8_t* data, const size_t length, const bool waitForResponse)
+{
+  uint8_t outer = startPhase(WIFIBEE_PHASE_UPLOAD);
+
+  createSendBuffer();
+  sendEscapedBinary(data, length);
+  transmitSendBuffer();
+
+  bool result;
+  result = (skipTillEvent(CONNECTION_EVENTS(SENT_EVENTS), RESPONSE_TIMEOUT) == 0);
+
+  if (result && waitForResponse) {
+    startPhase(WIFIBEE_PHASE_SERVER_WAIT);
+
+    if (skipTillEvent(CONNECTION_EVENTS(RECEIVED_EVENTS), SERVER_RESPONSE_TIMEOUT) == 0) {
+      readServerResponse();
+    }
+    else {
+      clearBuffer();
+    }
+  }
+
+  endPhase(outer);
+
+  return result;
+}
+
+/*!
+* This method reads and stores the received response data.
+* All of the data queued on the NodeMCU is read back, unless limited.
+* In raw mode it is read back in chunks of at most `_readBackChunk` bytes.
+* @param append `true` to add the data to the data already stored,
+* `false` to replace it.
+* @param limit The maximum number of bytes to read back, 0 for no limit.
+* @return `true` on if it successfully reads the whole response,
+* otherwise 'false'.
+*/
+bool Sodaq_WifiBee::readServerResponse(const bool append, const size_t limit)
+{
+  bool result;
+  uint8_t outer = startPhase(WIFIBEE_PHASE_READ_BACK);
+
+  if (!append) {
+    clearBuffer();
+  }
+
+  size_t remaining = limit;
+  size_t chunk;
+  size_t bytesReceived;
+
+  do {
+    chunk = remaining;
+    if ((_rawReadBack) && (_readBackChunk > 0) && ((chunk == 0) || (chunk > _readBackChunk))) {
+      chunk = _readBackChunk;
+    }
+
+    sendConnectionCommand(_rawReadBack ? READ_BACK_RAW : READ_BACK, chunk);
+    result = (skipTillPrompt(SOF_PROMPT, RESPONSE_TIMEOUT)) && (readDropped());
+
+    if (result) {
+      size_t bytesStored;
+
+      if (_rawReadBack) {
+        result = readRawTillPrompt(&_buffer[_bufferUsed], _bufferSize - _bufferUsed,
+          bytesStored, bytesReceived, eofPrompt(), READBACK_TIMEOUT);
+      }
+      else {
+        result = readHexTillPrompt(&_buffer[_bufferUsed], _bufferSize - _bufferUsed,
+          bytesStored, bytesReceived, eofPrompt(), READBACK_TIMEOUT);
+      }
+
+      _bufferUsed += bytesStored;
+      _responseLength += bytesReceived;
+
+      if (remaining > 0) {
+        remaining -= bytesReceived;
+      }
+    }
+
+    // A full chunk means more data may be queued, until the limit is reached
+  } while ((result) && (_rawReadBack) && (chunk > 0) && (bytesReceived == chunk) &&
+    ((limit == 0) || (remaining > 0)));
+
+  trace(WIFIBEE_TRACE_READ_BACK, result);
+
+  endPhase(outer);
+
+  return result;
+}
+
+/*!
+* This method reads the number of received bytes which the NodeMCU has
+* dropped since the last read back, because the connection's queue was
+* full (RECEIVE_QUEUE_MAX). It follows the start of the read back, e.g.
+* "|SOF|0|". They are added to `_responseDropped` and the statistics.
+* @return `true` if the number was read, otherwise `false`.
+*/
+bool Sodaq_WifiBee::readDropped()
+{
+  bool result;
+  size_t dropped = 0;
+  char c = 0;
+
+  while ((result = readChar(c, READBACK_TIMEOUT)) && (c >= '0') && (c <= '9')) {
+    dropped = (dropped * 10) + (c - '0');
+  }
+
+  if (dropped > 0) {
+    diagPrint("\r\nDropped: ");
+    diagPrintLn(dropped);
+
+    _responseDropped += dropped;
+    _stats.bytesDropped += dropped;
+  }
+
+  return (result) && (c == '|');
+}
+
+/*!
+* This method writes received data to the response sink, if one is set.
+* While `_sinkSkipHeader` is set, the data up to and including the
+* empty line which ends an HTTP header is not written.
+* @param data The received data.
+* @param length The size of `data`.
+*/
+void Sodaq_WifiBee::writeToSink(const uint8_t* data, const size_t length)
+{
+  if (!_responseSink) {
+    return;
+  }
+
+  size_t start = 0;
+
+  while (_sinkSkipHeader && (start < length)) {
+    _sinkHeaderIndex = advancePrompt(HEADER_END, HEADER_END_FALLBACK, _sinkHeaderIndex, data[start]);
+    start++;
+
+    if (_sinkHeaderIndex == 4) {
+      _sinkSkipHeader = false;
+    }
+  }
+
+  if (start < length) {
+    _responseSink->write(&data[start], length - start);
+  }
+}
+
+/*!
+* This method reads and stores a complete HTTP response.
+* It should be called once the first data received prompt has been seen.
+* If the response has a Content-Length header, it reads until that much
+* data has been received. Otherwise it reads until the connection is
+* closed, or no more data is received within NEXT_PACKET_TIMEOUT.
+* @return `true` on if it successfully read back the whole response,
+* otherwise 'false'. It will return `false` if the NodeMCU dropped any of
+* it, or if less than the Content-Length was received.
+*/
+bool Sodaq_WifiBee::readHTTPResponseData()
+{
+  // Only the body is written to the sink
+  _sinkSkipHeader = true;
+  _sinkHeaderIndex = 0;
+
+  bool result = readServerResponse();
+  size_t expected;
+  bool known = false;
+
+  while (result) {
+    known = getHTTPResponseLength(expected);
+
+    // A response with a gap cannot be completed
+    if ((_responseDropped > 0) || (known && (_responseLength >= expected)) ||
+      (!_connectionOpen)) {
+      break;
+    }
+
+    uint8_t outer = startPhase(WIFIBEE_PHASE_SERVER_WAIT);
+    int8_t event = skipTillEvent(CONNECTION_EVENTS(RECEIVED_EVENTS),
+      known ? SERVER_RESPONSE_TIMEOUT : NEXT_PACKET_TIMEOUT);
+    endPhase(outer);
+
+    // Always read back, a data received prompt may have been
+    // skipped while waiting for another prompt
+    size_t previousLength = _responseLength;
+    result = readServerResponse(true);
+
+    if ((event != 0) && (_responseLength == previousLength)) {
+      break;
+    }
+  }
+
+  _sinkSkipHeader = false;
+
+  if ((result) && ((_responseDropped > 0) || (known && (_responseLength < expected)))) {
+    diagPrintLn("\r\nIncomplete response");
+    result = false;
+  }
+
+  return result;
+}
+
+/*!
+* This method determines the total length of the HTTP response being
+* received, from the size of its header and its Content-Length header.
+* @param length The length in bytes is written to this parameter.
+* @return `true` if the length could be determined, otherwise 'false'.
+* It will return `false` if the header has not been completely received.
+*/
+bool Sodaq_WifiBee::getHTTPResponseLength(size_t& length)
+{
+  if (_bufferUsed == 0) {
+    return false;
+  }
+
+  char* header = (char*)_buffer;
+  char* headerEnd = strstr(header, "\r\n\r\n");
+
+  if (!headerEnd) {
+    return false;
+  }
+
+  const char* name = "\r\nContent-Length:";
+  size_t nameLength = strlen(name);
+
+  for (char* line = strstr(header, "\r\n"); (line) && (line < headerEnd);
+    line = strstr(line + 2, "\r\n")) {
+    if (strncasecmp(line, name, nameLength) == 0) {
+      length = (headerEnd + 4 - header) + strtoul(line + nameLength, NULL, 10);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*!
+* This method joins the WifiBee to the network.
+* It tries a fast join first, if enabled and possible.
+* @return `true` if the network was successfully joined,
+* otherwise `false`.
+*/
+bool Sodaq_WifiBee::connect()
+{
+  uint8_t outer = startPhase(WIFIBEE_PHASE_JOIN);
+
+  bool result = join();
+
+  // DHCP stays off after a failed fast join, until the NodeMCU restarts
+  if (fastJoinFailed(result)) {
+    diagPrintLn("Fast join failed, restarting");
+    off();
+
+    result = start();
+    if (result) {
+      result = join();
+    }
+  }
+
+  if ((result) && (_fastJoin) && (!_joinCache.valid)) {
+    readJoinCache();
+  }
+
+  _joined = result;
+
+  endPhase(outer);
+
+  return result;
+}
+
+/*!
+* This method sends the join command and waits for the result.
+* @return `true` if the network was successfully joined,
+* otherwise `false`.
+*/
+bool Sodaq_WifiBee::join()
+{
+  sendJoinCommand();
+
+  // With status events the current status is reported, in case it doesn't change
+  if (!_statusEvents) {
+    skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT);
+  }
+
+  bool result = waitForIP(joinTimeout());
+
+  if (_statusEvents) {
+    println(STATUS_EVENTS_STOP);
+    skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT);
+  }
+
+  return result;
+}
+
+/*!
+* This method sends the command which joins the network.
+* The helper sets the station mode and the network's credentials,
+* starts the status events (if enabled) and connects.
+*/
+void Sodaq_WifiBee::sendJoinCommand()
+{
+  _fastJoinTried = (_fastJoin) && (_joinCache.valid);
+
+  print("wb.j(\"");
+  print(_APN);
+  print("\",\"");
+  print(_password);
+
+  if (_fastJoinTried) {
+    print(_statusEvents ? "\",1,\"" : "\",nil,\"");
+    printAddress(_joinCache.bssid, sizeof(_joinCache.bssid), true);
+    print("\",\"");
+    printAddress(_joinCache.ip, sizeof(_joinCache.ip), false);
+    print("\",\"");
+    printAddress(_joinCache.netmask, sizeof(_joinCache.netmask), false);
+    print("\",\"");
+    printAddress(_joinCache.gateway, sizeof(_joinCache.gateway), false);
+    println("\")");
+  }
+  else {
+    println(_statusEvents ? "\",1)" : "\")");
   }
+}
 
-  int count = 0;
-  uint32_t startTS = millis();
+/*!
+* This method writes an IP address or a MAC address.
+* @param bytes The address.
+* @param count The number of bytes in the address.
+* @param hex `true` for a MAC address (HEX, ':'), `false` for an IP
+* address (decimal, '.').
+*/
+void Sodaq_WifiBee::printAddress(const uint8_t* bytes, const size_t count,
+  const bool hex)
+{
+  for (size_t i = 0; i < count; i++) {
+    if (i > 0) {
+      print(hex ? ':' : '.');
+    }
 
-  while (!timedOut32(startTS, timeMS)) {
-    if (available()) {
-      char c = read();
-      diagPrint(c);
-      count++;
+    if (hex) {
+      if (bytes[i] < 0x10) {
+        print('0');
+      }
+      print(bytes[i], HEX);
     }
     else {
-      _delay(10);
+      print(bytes[i]);
     }
   }
+}
 
-  return count;
+/*!
+* This method reads the IP configuration and the access point of the
+* network joined, and caches them for the next fast join.
+* @return `true` if they were read, otherwise `false`.
+*/
+bool Sodaq_WifiBee::readJoinCache()
+{
+  // IP address, netmask, gateway and BSSID, each followed by a '|'
+  char text[72];
+  size_t length = 0;
+
+  println(NETWORK_COMMAND);
+
+  bool result = (skipTillPrompt(NETWORK_PROMPT, RESPONSE_TIMEOUT)) &&
+    (readTillPrompt((uint8_t*)text, sizeof(text), length, "\r\n", RESPONSE_TIMEOUT));
+  text[length] = '\0';
+
+  if (result) {
+    const char* field = text;
+
+    result = (parseAddress(field, _joinCache.ip, sizeof(_joinCache.ip), false)) &&
+      (parseAddress(field, _joinCache.netmask, sizeof(_joinCache.netmask), false)) &&
+      (parseAddress(field, _joinCache.gateway, sizeof(_joinCache.gateway), false)) &&
+      (parseAddress(field, _joinCache.bssid, sizeof(_joinCache.bssid), true));
+
+    skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT);
+  }
+
+  _joinCache.valid = result;
+
+  return result;
 }
 
 /*!
-* This method reads and empties the input buffer of `_dataStream`.
-* It continues until it finds the specified prompt or until
-* the specified amount of time has elapsed.
-* It attempts to output the data it reads to `_diagStream`.
-* @param prompt The prompt to read until.
-* @param timeMS The time limit in milliseconds.
-* @return `true` if it found the specified prompt within the time
-* limit, otherwise `false`.
+* This method counts the result of a fast join, if one was tried.
+* The cached details are cleared if it failed.
+* @param result The result of the join.
+* @return `true` if a fast join was tried and failed, otherwise `false`.
 */
-bool Sodaq_WifiBee::skipTillPrompt(const char* prompt, const uint32_t timeMS)
+bool Sodaq_WifiBee::fastJoinFailed(const bool result)
 {
-  if (!_dataStream) {
+  if (!_fastJoinTried) {
     return false;
   }
 
-  bool result = false;
+  _fastJoinTried = false;
 
-  uint32_t startTS = millis();
+  if (result) {
+    _stats.fastJoins++;
+    return false;
+  }
 
-  size_t index = 0;
-  size_t promptLen = strlen(prompt);
+  _stats.fastJoinFailures++;
+  _joinCache.valid = false;
 
-  while (!timedOut32(startTS, timeMS)) {
-    if (available()) {
-      char c = read();
-      diagPrint(c);
+  return true;
+}
 
-      if (c == prompt[index]) {
-        index++;
+/*!
+* This method disconnects the WifiBee from the network.
+*/
+void Sodaq_WifiBee::disconnect()
+{
+  println("wifi.sta.disconnect()");
+  skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT);
+  _joined = false;
+}
 
-        if (index == promptLen) {
-          result = true;
-          break;
-        }
-      }
-      else {
-        index = 0;
-      }
+/*!
+* This method checks the connection status of the WifiBee.
+* @param status The status code (0..5) is written to this parameter.
+* @return `true` if it successfully read the status code,
+* otherwise `false`.
+*/
+bool Sodaq_WifiBee::getStatus(uint8_t& status)
+{
+  bool result;
+
+  println(STATUS_CALLBACK);
+  result = skipTillPrompt(STATUS_PROMPT, RESPONSE_TIMEOUT);
+
+  if (result) {
+    result = readStatus(status);
+    skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT);
+  }
+
+  return result;
+}
+
+/*!
+* This method reads the status code which follows a status prompt.
+* @param status The status code (0..5) is written to this parameter.
+* @return `true` if it successfully read the status code,
+* otherwise `false`.
+*/
+bool Sodaq_WifiBee::readStatus(uint8_t& status)
+{
+  bool result;
+  char statusCode;
+
+  result = readChar(statusCode, RESPONSE_TIMEOUT);
+
+  if (result) {
+    if ((statusCode >= '0') && (statusCode <= '5')) {
+      status = statusCode - '0';
     }
     else {
-      _delay(10);
+      result = false;
     }
   }
 
@@ -725,686 +3724,1113 @@ bool Sodaq_WifiBee::skipTillPrompt(const char* prompt, const uint32_t timeMS)
 }
 
 /*!
-* This method reads one character from the input buffer of `_dataStream`.
-* It continues until it reads one character or until the specified amount
-* of time has elapsed. It attempts to output the data it read to `_diagStream`.
-* @param data The character read, is written to this parameter.
+* This method checks the connection status until the network has been
+* joined, the join has failed or the specified time limit has elapsed.
+* With status events enabled it waits for the status changes pushed by
+* the NodeMCU, and only polls with getStatus() if none arrive within
+* STATUS_DELAY. Otherwise it calls getStatus() every STATUS_DELAY.
+* A fast join is checked every FAST_JOIN_STATUS_DELAY instead.
 * @param timeMS The time limit in milliseconds.
-* @return `true` if it successfully read one character within the
-* time limit, otherwise `false`.
+* @return `true` if the Wifi network was joined, otherwise `false`.
 */
-bool Sodaq_WifiBee::readChar(char& data, const uint32_t timeMS)
+bool Sodaq_WifiBee::waitForIP(const uint32_t timeMS)
 {
-  if (!_dataStream) {
-    return false;
-  }
-
   bool result = false;
 
+  uint8_t status = 1;
   uint32_t startTS = millis();
-  while ((!timedOut32(startTS, timeMS)) && (!result)) {
-    if (available()) {
-      data = read();
-      diagPrint(data);
-      result = true;
+  uint8_t outer = startPhase(WIFIBEE_PHASE_IP);
+
+  // It may still be joined, otherwise the status is only checked
+  // once it has had time to connect
+  if ((!_statusEvents) && (!(getStatus(status) && (status == 5)))) {
+    status = 1;
+  }
+
+  while ((!timedOut32(startTS, timeMS)) && (status == 1)) {
+    if (_statusEvents) {
+      if (!(skipTillPrompt(STATUS_PROMPT, statusDelay()) && readStatus(status))) {
+        getStatus(status);
+      }
     }
     else {
-      _delay(10);
+      skipForTime(statusDelay());
+      getStatus(status);
     }
   }
 
+  //0 = Idle
+  //1 = Connecting
+  //2 = Wrong Credentials
+  //3 = AP not found
+  //4 = Connect Fail
+  //5 = Got IP
+
+  switch (status) {
+  case 0:
+    diagPrintLn("Failed to connect: Station idle");
+    break;
+  case 1:
+    diagPrintLn("Failed to connect: Timeout");
+    break;
+  case 2:
+    diagPrintLn("Failed to connect: Wrong credentials");
+    break;
+  case 3:
+    diagPrintLn("Failed to connect: AP not found");
+    break;
+  case 4:
+    diagPrintLn("Failed to connect: Connection failed");
+    break;
+  case 5:
+    diagPrintLn("Success: IP received");
+    result = true;
+    break;
+  }
+
+  endPhase(outer);
+
   return result;
 }
 
 /*!
-* This method reads and empties the input buffer of `_dataStream`.
-* It continues until it finds the specified prompt or until
-* the specified amount of time has elapsed.
-* It copies the read data into the buffer supplied.
-* It attempts to output the data it reads to `_diagStream`.
-* @param buffer The buffer to copy the data into.
-* @param size The size of `buffer`.
-* @param bytesStored The number of bytes copied is written to this parameter.
-* @param prompt The prompt to read until.
-* @param timeMS The time limit in milliseconds.
-* @return `true` if it found the specified prompt within the time
-* limit, otherwise `false`.
+* This method constructs and sends a generic HTTP request.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param The HTTP method to use. e.g. "GET", "POST" etc.
+* @param location The resource location on the server/host.
+* @param headers Any additional headers, each must be followed by a CRLF.
+* HOST & Content-Length headers are added automatically.
+* @param body The body (can be blank) to send with the request. Must not start with a CRLF.
+* @param httpCode The HTTP response code is written to this parameter (if a response is received).
+* @return `true` if a connection is established and the data is sent, `false` otherwise.
+* It will also return `false` if a response was received but not completely,
+* see readHTTPResponseData().
 */
-bool Sodaq_WifiBee::readTillPrompt(uint8_t* buffer, const size_t size,
-  size_t& bytesStored, const char* prompt, const uint32_t timeMS)
+bool Sodaq_WifiBee::HTTPAction(const char* server, const uint16_t port,
+  const char* method, const char* location, const char* headers,
+  const char* body, uint16_t& httpCode)
 {
-  if (!_dataStream) {
-    return false;
+  bool result;
+
+  bool keepAlive = isSessionFor(server, port);
+
+  // Open the connection, or reuse the session's connection
+  if (keepAlive) {
+    checkForEvents();
+
+    result = _connectionOpen;
+    if (!result) {
+      result = openSocket(server, port, "net.TCP");
+    }
+    // The network may have been lost as well
+    if (!result) {
+      result = openConnection(server, port, "net.TCP");
+    }
+  }
+  else {
+    result = openConnection(server, port, "net.TCP");
   }
 
-  bool result = false;
+  if (result) {
+    uint8_t outer = startPhase(WIFIBEE_PHASE_UPLOAD);
 
-  uint32_t startTS = millis();
-  size_t promptIndex = 0;
-  size_t promptLen = strlen(prompt);
+    createSendBuffer();
 
-  size_t bufferIndex = 0;
-  size_t streamCount = 0;
+    sendAscii(method);
+    sendAscii(" ");
+    sendAscii(location);
+    sendAscii(" HTTP/1.1\\r\\n");
 
-  while (!timedOut32(startTS, timeMS)) {
-    if (available()) {
-      char c = read();
-      diagPrint(c);
+    sendAscii("HOST: ");
+    sendAscii(server);
+    sendAscii(":");
 
-      streamCount++;
+    char buff[11];
+    formatUnsigned(port, buff);
+    sendAscii(buff);
+    sendAscii("\\r\\n");
 
-      if (bufferIndex < size) {
-        buffer[bufferIndex] = c;
-        bufferIndex++;
-      }
+    if (strcmp(method, "GET") != 0) {
+      sendAscii("Content-Length: ");
+      formatUnsigned(strlen(body), buff);
+      sendAscii(buff);
+      sendAscii("\\r\\n");
+    }
 
-      if (c == prompt[promptIndex]) {
-        promptIndex++;
+    if (keepAlive) {
+      sendAscii("Connection: keep-alive\\r\\n");
+    }
 
-        if (promptIndex == promptLen) {
-          result = true;
-          bufferIndex = ((size - 1) < (streamCount - promptLen)) ? (size - 1) : (streamCount - promptLen);
-          break;
-        }
+    sendEscapedAscii(headers);
+    sendAscii("\\r\\n");
+
+    sendEscapedAscii(body);
+
+    transmitSendBuffer();
+
+    // Wait till we hear that it was sent
+    result = (skipTillEvent(CONNECTION_EVENTS(SENT_EVENTS), RESPONSE_TIMEOUT) == 0);
+
+    // Wait till we get the data received prompt
+    // A disconnect ends the wait, there won't be any more data
+    if (result) {
+      startPhase(WIFIBEE_PHASE_SERVER_WAIT);
+
+      if (skipTillEvent(CONNECTION_EVENTS(RECEIVED_EVENTS), SERVER_RESPONSE_TIMEOUT) == 0) {
+        result = readHTTPResponseData();
+        parseHTTPResponse(httpCode);
       }
       else {
-        promptIndex = 0;
+        clearBuffer();
+      }
+    }
+
+    endPhase(outer);
+
+    // The connection might have closed automatically
+    // Sessions leave it open for the next request
+    if (!keepAlive) {
+      closeConnection();
+    }
+  }
+
+  return result;
+}
+
+/*!
+* This method parses the HTTP response code from the data received.
+* @param httpCode The response code is written into this parameter.
+* @return `true` if the conversion returns a non-zero value,
+* otherwise `false` .
+*/
+bool Sodaq_WifiBee::parseHTTPResponse(uint16_t& httpCode)
+{
+  bool result = false;
+
+  // The HTTP response code should follow the first ' '
+  if (_bufferUsed > 0) {
+    char* codePos = strstr((char*)_buffer, " ");
+    if (codePos) {
+      httpCode = atoi(codePos);
+      if (httpCode != 0) {
+        result = true;
       }
     }
-    else {
-      _delay(10);
-    }
   }
 
-  bytesStored = bufferIndex;
-
   return result;
 }
 
 /*!
-* This method reads and empties the input buffer of `_dataStream`.
-* It continues until it finds the specified prompt or until
-* the specified amount of time has elapsed.
-* The source data is converted from HEX and copied to the
-* buffer supplied.
-* The first letter of the prompt cannot be a valid Hex char.
-* It attempts to output the data it reads to `_diagStream`.
-* @param buffer The buffer to copy the data into.
-* @param size The size of `buffer`.
-* @param bytesStored The number of bytes copied is written to this parameter.
-* @param prompt The prompt to read until.
-* @param timeMS The time limit in milliseconds.
-* @return `true` if it found the specified prompt within the time
-* limit, otherwise `false`.
+* This method starts an asynchronous HTTP request.
+* It switches the device on, unless the request uses the open HTTP session.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param The HTTP method to use. e.g. "GET", "POST" etc.
+* @param location The resource location on the server/host.
+* @param headers Any additional headers, each must be followed by a CRLF.
+* HOST & Content-Length headers are added automatically.
+* @param body The body (can be blank) to send with the request. Must not start with a CRLF.
+* @return `true` if the request was started, `false` if a request
+* is already in progress, or if the selected connection is open for
+* another server.
 */
-bool Sodaq_WifiBee::readHexTillPrompt(uint8_t* buffer, const size_t size,
-  size_t& bytesStored, const char* prompt, const uint32_t timeMS)
+bool Sodaq_WifiBee::beginHTTPAction(const char* server, const uint16_t port,
+  const char* method, const char* location, const char* headers,
+  const char* body)
 {
-  if (!_dataStream) {
+  if ((isBusy()) || (!_dataStream)) {
     return false;
   }
 
-  bool result = false;
+  // The request must not overlap with any streamed data
+  waitForSends(0);
 
-  uint32_t startTS = millis();
-  size_t promptIndex = 0;
-  size_t promptLen = strlen(prompt);
+  _asyncKeepAlive = isSessionFor(server, port);
 
-  size_t bufferIndex = 0;
-  size_t streamCount = 0;
-  bool even = false;
+  // The session, or another connection, is open on the selected connection
+  if ((!_asyncKeepAlive) && (connectionInUse())) {
+    diagPrintLn("Connection already open");
+    return false;
+  }
 
-  while (!timedOut32(startTS, timeMS)) {
-    if (available()) {
-      startTS = millis();
-      char c = read();
-      diagPrint(c);
+  _asyncServer = server;
+  _asyncPort = port;
+  _asyncResult = false;
+  _asyncHttpCode = 0;
+  _asyncReadMode = ASYNC_READ_PROMPTS;
+  clearBuffer();
+
+  // The request is uploaded from these pieces, escaping them on the fly
+  uint8_t count = 0;
+  _asyncSegments[count++] = method;
+  _asyncSegments[count++] = " ";
+  _asyncSegments[count++] = location;
+  _asyncSegments[count++] = " HTTP/1.1\r\nHOST: ";
+  _asyncSegments[count++] = server;
+  _asyncSegments[count++] = ":";
+  formatUnsigned(port, _asyncPortText);
+  _asyncSegments[count++] = _asyncPortText;
+
+  if (strcmp(method, "GET") != 0) {
+    _asyncSegments[count++] = "\r\nContent-Length: ";
+    formatUnsigned(strlen(body), _asyncLengthText);
+    _asyncSegments[count++] = _asyncLengthText;
+  }
+  _asyncSegments[count++] = "\r\n";
 
-      streamCount++;
+  if (_asyncKeepAlive) {
+    _asyncSegments[count++] = "Connection: keep-alive\r\n";
+  }
 
-      if (bufferIndex < size) {
-        buffer[bufferIndex] = c;
-        bufferIndex++;
-      }
+  _asyncSegments[count++] = headers;
+  _asyncSegments[count++] = "\r\n";
+  _asyncSegments[count++] = body;
 
-      if (c == prompt[promptIndex]) {
-        promptIndex++;
+  _asyncSegmentCount = count;
+  _asyncSegment = 0;
+  _asyncOffset = 0;
 
-        if (promptIndex == promptLen) {
-          result = true;
-          bufferIndex = ((size - 1) < ((streamCount - promptLen) / 2)) ? (size - 1) : (streamCount - promptLen) / 2;
-          break;
-        }
-      }
-      else {
-        promptIndex = 0;
+  if (_asyncKeepAlive) {
+    checkForEvents();
 
-        if (even) {
-          _buffer[bufferIndex - 2] = HEX2BYTE(_buffer[bufferIndex - 2], _buffer[bufferIndex - 1]);
-          bufferIndex--;
-        }
-      }
-      even = !even;
+    _waking = false;
+
+    if (_connectionOpen) {
+      asyncSendCommand(ASYNC_CREATE_BUFFER);
     }
     else {
-      _delay(10);
+      // If it can't be reopened, the network may have been lost as well
+      _asyncStep = 2;
+      asyncSendCommand(ASYNC_SERVER_CONNECT);
     }
   }
+  else if (otherConnectionOpen()) {
+    // The device is already on and joined
+    _waking = false;
+    asyncSendCommand(ASYNC_SERVER_CONNECT);
+  }
+  else {
+    _waking = true;
+    _wakeTS = millis();
+
+    // A device in standby only needs to be woken, one which is
+    // restarting from a deep sleep is waited for as wakeFromSleep() does
+    uint32_t elapsed = millis() - _standbyTS;
+    bool restarting = (_sleeping) && (_powerTimeMS > 0) &&
+      (elapsed + WAKE_DELAY >= _powerTimeMS);
+
+    if ((restarting) && (elapsed < _powerTimeMS + WAKE_DELAY)) {
+      _sleeping = false;
+      _asyncStep = 1;
+      _asyncState = ASYNC_WAKE;
+      asyncExpect(luaEvents(), 1, _powerTimeMS + WAKE_DELAY - elapsed);
+    }
+    else if ((_standby) || (restarting)) {
+      _sleeping = false;
+      _asyncStep = 1;
+      flushInputStream();
+      asyncSendCommand(ASYNC_ALIVE);
+    }
+    else {
+      // A deep sleep which hasn't ended is cut short
+      if (_sleeping) {
+        off();
+      }
 
-  bytesStored = bufferIndex;
+      asyncPowerOn();
+    }
+  }
 
-  return result;
+  return true;
 }
 
 /*!
-* This method uploads data to the send buffer.
-* The send buffer is stored on the NodeMCU and is transmitted
-* once the data to be sent has been uploaded to it.
-* It sends it in chunks so to comply with the LUA command limits.
+* This method switches the device on for an asynchronous request, and
+* waits for it to start.
 */
-void Sodaq_WifiBee::sendAscii(const char* data)
+void Sodaq_WifiBee::asyncPowerOn()
 {
-  size_t length = strlen(data);
-  size_t overhead = 9; // sb=sb.."" 
-  size_t chunkSize = LUA_COMMAND_MAX - overhead - 1; //-1 for escape sequences
-
-  size_t index = 0;
-  size_t count;
-  size_t slashCount;
-
+  diagPrintLn("\r\nPower ON");
+  if ((!isOn()) && (_onoff)) {
+    _onoff->on();
+  }
+  trace(WIFIBEE_TRACE_POWER, 1);
 
-  while (index < length) {
-    count = 0;
-    slashCount = 0;
-    print("sb=sb..\"");
-    while ((count < chunkSize) && (index < length)) {
-      print(data[index]);
+  _asyncStep = 0;
+  _asyncState = ASYNC_WAKE;
+  asyncExpect(luaEvents(), 1, WAKE_DELAY);
+}
 
-      //Keep track of the number of '\' symbols up to the index
-      if (data[index] == '\\') {
-        slashCount++;
-      }
-      else {
-        slashCount = 0;
-      }
+/*!
+* This method sets the prompts an asynchronous request waits for.
+* @param prompts The prompts to wait for (up to MAX_EVENT_PROMPTS).
+* @param count The number of entries in `prompts`.
+* @param timeMS The time limit in milliseconds.
+*/
+void Sodaq_WifiBee::asyncExpect(const char* const* prompts,
+  const uint8_t count, const uint32_t timeMS)
+{
+  _asyncPrompts = prompts;
+  _asyncPromptCount = count;
+  memset(_asyncPromptIndex, 0, sizeof(_asyncPromptIndex));
 
-      count++;
-      index++;
-    }
+  for (uint8_t i = 0; i < count; i++) {
+    preparePrompt(prompts[i], _asyncPromptFallback[i]);
+  }
 
-    //If we have an odd number of slashes send one more character
-    //so that we don't divide an escape sequence.
-    if (((slashCount % 2) == 1) && (index < length))
-    {
-      print(data[index]);
-      index++;
-    }
+  _asyncTS = millis();
+  _asyncTimeout = timeMS;
 
-    println("\"");
-    skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
-  }
+  startPhase(ASYNC_PHASES[_asyncState]);
 }
 
 /*!
-* This method uploades escaped ASCII data to the send buffer.
-* The send buffer is stored on the NodeMCU and is transmitted
-* once the data to be sent has been uploaded to it.
-* It only escapes specific LUA characters.
-* @param data The buffer containing the ASCII data to send.
+* This method advances an asynchronous request once the current wait
+* has ended.
+* @param event The index of the prompt found, or -1 if the wait timed out.
 */
-void Sodaq_WifiBee::sendEscapedAscii(const char* data)
+void Sodaq_WifiBee::asyncNext(const int8_t event)
 {
-  size_t length = strlen(data);
-  size_t overhead = 9; // sb=sb..""
-  size_t chunkSize = LUA_COMMAND_MAX - overhead - 1; //-1 for space if final character is escaped
-
-  size_t index = 0;
-  size_t count;
-
-  while (index < length) {
-    count = 0;
-    print("sb=sb..\"");
-    while ((count < chunkSize) && (index < length)) {
-      bool escaped = true;
-
-      switch (data[index]) {
-      case '\a':
-        print("\\a");
-        break;
-      case '\b':
-        print("\\b");
-        break;
-      case '\f':
-        print("\\f");
-        break;
-      case '\n':
-        print("\\n");
-        break;
-      case '\r':
-        print("\\r");
-        break;
-      case '\t':
-        print("\\t");
-        break;
-      case '\v':
-        print("\\v");
-        break;
-      case '\\':
-        print("\\\\");
-        break;
-      case '\"':
-        print("\\\"");
-        break;
-      case '\'':
-        print("\\\'");
-        break;
-      case '[':
-        print("\\[");
-        break;
-      case ']':
-        print("\\]");
-        break;
-      default:
-        print(data[index]);
-        escaped = false;
-        break;
+  switch (_asyncState) {
+  case ASYNC_WAKE:
+    // If it was already on, check it with the alive command
+    if (event == 0) {
+      _asyncStep = 0;
+      asyncSendCommand(((_fastBaudRate > 0) && (!_fastUART)) ? ASYNC_BAUD_RATE : ASYNC_HELPER);
+    }
+    else {
+      asyncSendCommand(ASYNC_ALIVE);
+    }
+    break;
+  case ASYNC_ALIVE:
+    if ((event == 0) && ((_standby) || (_asyncStep == 2))) {
+      // It is ready, and still joined unless a join failed or the
+      // session's connection could not be reopened
+      _standby = false;
+      _asyncStep = 1;
+      asyncSendCommand(_joined ? ASYNC_SERVER_CONNECT : ASYNC_STA_CONNECT);
+    }
+    else if (event == 0) {
+      _asyncStep = 0;
+      asyncSendCommand(((_fastBaudRate > 0) && (!_fastUART)) ? ASYNC_BAUD_RATE : ASYNC_HELPER);
+    }
+    else if (_asyncStep >= 1) {
+      // It was expected to be on, restart it
+      off();
+      asyncPowerOn();
+    }
+    else {
+      asyncFinish(false);
+    }
+    break;
+  case ASYNC_BAUD_RATE:
+    // The NodeMCU has had time to set up its UART
+    asyncSendCommand(ASYNC_BAUD_PING);
+    break;
+  case ASYNC_BAUD_PING:
+    if (event == 0) {
+      asyncSendCommand(ASYNC_HELPER);
+    }
+    else {
+      asyncFinish(false);
+    }
+    break;
+  case ASYNC_HELPER:
+    // Install the helper if it is missing, but only once
+    if (event == 0) {
+      asyncSendCommand(((!_echo) && (!_echoOff) && (_baudRate > 0)) ?
+        ASYNC_ECHO_OFF : ASYNC_STA_CONNECT);
+    }
+    else if ((event == 1) && (_asyncStep == 0)) {
+      diagPrintLn("\r\nInstalling " HELPER_FILE);
+      asyncSendCommand(ASYNC_INSTALL);
+    }
+    else {
+      asyncFinish(false);
+    }
+    break;
+  case ASYNC_INSTALL:
+    _asyncStep++;
+    asyncSendCommand((_asyncStep < INSTALL_COMMANDS) ? ASYNC_INSTALL : ASYNC_HELPER);
+    break;
+  case ASYNC_ECHO_OFF:
+    if (event == 0) {
+      asyncSendCommand(ASYNC_STA_CONNECT);
+    }
+    else {
+      asyncFinish(false);
+    }
+    break;
+  case ASYNC_STA_CONNECT:
+    _asyncJoinTS = millis();
+    _asyncState = ASYNC_JOIN;
+    asyncExpect(STATUS_EVENTS, EVENT_COUNT(STATUS_EVENTS), statusDelay());
+    break;
+  case ASYNC_JOIN:
+    if (event == 0) {
+      // The status code follows
+      _asyncReadMode = ASYNC_READ_STATUS;
+      _asyncTS = millis();
+      _asyncTimeout = RESPONSE_TIMEOUT;
+    }
+    else if (timedOut32(_asyncJoinTS, joinTimeout())) {
+      diagPrintLn("Failed to connect: Timeout");
+      asyncJoined(false);
+    }
+    else {
+      asyncSendCommand(ASYNC_JOIN);
+    }
+    break;
+  case ASYNC_EVENTS_STOP:
+    if (_asyncResult) {
+      asyncServerConnect();
+    }
+    else {
+      asyncFinish(false);
+    }
+    break;
+  case ASYNC_READ_NET:
+    if (event == 0) {
+      // The details follow, see readJoinCache()
+      _asyncReadMode = ASYNC_READ_ADDRESS;
+      _asyncRemaining = 0;
+      _asyncAddressByte = 0;
+      _asyncAddressDigits = 0;
+      _asyncTS = millis();
+      _asyncTimeout = RESPONSE_TIMEOUT;
+    }
+    else {
+      _joinCache.valid = false;
+      asyncSendCommand(ASYNC_SERVER_CONNECT);
+    }
+    break;
+  case ASYNC_READ_NET_END:
+    asyncSendCommand(ASYNC_SERVER_CONNECT);
+    break;
+  case ASYNC_SERVER_CONNECT:
+    _connectionOpen = (event == 0);
+    if (_connectionOpen) {
+      asyncSendCommand(ASYNC_CREATE_BUFFER);
+    }
+    else if (_asyncStep == 2) {
+      // As HTTPAction(), check the device and rejoin the network
+      diagPrintLn("Reopening the session failed, rejoining");
+      _joined = false;
+      asyncSendCommand(ASYNC_ALIVE);
+    }
+    else {
+      asyncFinish(false);
+    }
+    break;
+  case ASYNC_CREATE_BUFFER:
+  case ASYNC_UPLOAD:
+    asyncSendCommand((_asyncSegment < _asyncSegmentCount) ? ASYNC_UPLOAD : ASYNC_TRANSMIT);
+    break;
+  case ASYNC_TRANSMIT:
+    _asyncState = ASYNC_SENT;
+    asyncExpect(CONNECTION_EVENTS(SENT_EVENTS), RESPONSE_TIMEOUT);
+    break;
+  case ASYNC_SENT:
+    if (event == 0) {
+      _asyncResult = true;
+      _asyncStep = 0;
+      _asyncState = ASYNC_RESPONSE;
+      asyncExpect(CONNECTION_EVENTS(RECEIVED_EVENTS), SERVER_RESPONSE_TIMEOUT);
+    }
+    else {
+      asyncFinish(false);
+    }
+    break;
+  case ASYNC_RESPONSE:
+    if (_asyncStep == 0) {
+      // Waiting for the first data received prompt
+      if (event == 0) {
+        _asyncLastEvent = 0;
+        asyncReadBack(false);
       }
-
-      //Add +1 for normal +2 for escaped.
-      count++;
-      if (escaped) {
-        count++;
+      else {
+        asyncFinish(true);
       }
-
-      index++;
     }
-    println("\"");
-    skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
+    else {
+      // Always read back, a data received prompt may have been
+      // skipped while waiting for another prompt
+      _asyncLastEvent = event;
+      asyncReadBack(true);
+    }
+    break;
+  case ASYNC_READ_BACK:
+    if (event == 0) {
+      _asyncReadMode = ASYNC_READ_DROPPED;
+      _asyncRemaining = 0;
+      _asyncPromptIndex[0] = 0;
+      preparePrompt(eofPrompt(), _asyncPromptFallback[0]);
+      _asyncTS = millis();
+      _asyncTimeout = READBACK_TIMEOUT;
+    }
+    else {
+      asyncReadBackDone(false);
+    }
+    break;
+  case ASYNC_READ_END:
+    asyncReadBackDone(event == 0);
+    break;
+  case ASYNC_CLOSE:
+    _connectionOpen = false;
+    asyncFinish(_asyncResult);
+    break;
   }
 }
 
 /*!
-* This method uploades escaped binary data to the send buffer.
-* The send buffer is stored on the NodeMCU and is transmitted
-* once the data to be sent has been uploaded to it.
-* It numerically escapes every byte.
-* @param data The buffer containing the binary data to send.
-* @param length The size of `data`.
+* This method handles a received character which is not matched
+* against the prompts, i.e. a status code or read back data.
+* @param c The character received.
 */
-void Sodaq_WifiBee::sendEscapedBinary(const uint8_t* data, const size_t length)
+void Sodaq_WifiBee::asyncReadData(const char c)
 {
-  size_t overhead = 9; // sb=sb..""
-  size_t chunkSize = (LUA_COMMAND_MAX - overhead) / 4; //Up to 4 characters per byte
+  switch (_asyncReadMode) {
+  case ASYNC_READ_STATUS:
+    _asyncReadMode = ASYNC_READ_PROMPTS;
 
-  size_t index = 0;
-  size_t count;
-
-  while (index < length) {
-    count = 0;
-    print("sb=sb..\"");
-    while ((count < chunkSize) && (index < length)) {
-      print("\\");
-      print(data[index]);
+    if ((c >= '0') && (c <= '5') && (c != '1')) {
+      asyncJoined(c == '5');
+    }
+    else if (timedOut32(_asyncJoinTS, joinTimeout())) {
+      diagPrintLn("Failed to connect: Timeout");
+      asyncJoined(false);
+    }
+    else {
+      // Still connecting
+      asyncExpect(STATUS_EVENTS, EVENT_COUNT(STATUS_EVENTS), statusDelay());
+    }
+    break;
+  case ASYNC_READ_DROPPED:
+    // _asyncRemaining is used to parse the number, see readDropped()
+    if ((c >= '0') && (c <= '9')) {
+      _asyncRemaining = (_asyncRemaining * 10) + (c - '0');
+    }
+    else if (c == '|') {
+      _responseDropped += _asyncRemaining;
+      _stats.bytesDropped += _asyncRemaining;
+      _asyncRemaining = 0;
+      _asyncReadMode = _rawReadBack ? ASYNC_READ_LENGTH : ASYNC_READ_HEX;
+    }
+    else {
+      asyncReadBackDone(false);
+    }
+    break;
+  case ASYNC_READ_LENGTH:
+    if ((c >= '0') && (c <= '9')) {
+      _asyncRemaining = (_asyncRemaining * 10) + (c - '0');
+    }
+    else if ((c == '|') && (_asyncRemaining > 0)) {
+      _asyncReadMode = ASYNC_READ_RAW;
+    }
+    else if (c == '|') {
+      _asyncReadMode = ASYNC_READ_PROMPTS;
+      _asyncState = ASYNC_READ_END;
+      asyncExpect(eofEvents(), 1, READBACK_TIMEOUT);
+    }
+    else {
+      asyncReadBackDone(false);
+    }
+    break;
+  case ASYNC_READ_HEX:
+    _asyncPromptIndex[0] = advancePrompt(eofPrompt(), _asyncPromptFallback[0], _asyncPromptIndex[0], c);
 
-      count++;
-      index++;
+    if (eofPrompt()[_asyncPromptIndex[0]] == '\0') {
+      asyncReadBackDone(true);
     }
-    println("\"");
-    skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
+    else if (_asyncPromptIndex[0] == 0) {
+      // _asyncRemaining is used to count the HEX characters
+      if (_asyncRemaining & 1) {
+        uint8_t value = HEX2BYTE(_asyncHigh, c);
+        writeToSink(&value, 1);
+
+        // Keep one byte for the terminating '\0'
+        if (_bufferUsed < (_bufferSize - 1)) {
+          _buffer[_bufferUsed] = value;
+          _bufferUsed++;
+        }
+        _responseLength++;
+      }
+      else {
+        _asyncHigh = c;
+      }
+      _asyncRemaining++;
+    }
+    break;
+  case ASYNC_READ_ADDRESS:
+    asyncReadAddress(c);
+    break;
   }
 }
 
 /*!
-* This method opens a TCP or UDP connection to a remote server.
-* @param server The server/host to connect to (IP address or domain).
-* @param port The port to connect to.
-* @param type The type of connection to establish, TCP or UDP.
-* @return `true` if the connection was successfully established,
-* otherwise `false`.
+* This method parses a received character of the network details for a
+* fast join, as readJoinCache() does: the IP address, netmask, gateway
+* and BSSID, each followed by a '|'. Once they have been parsed, or if
+* they can't be, it waits for the Lua prompt.
+* @param c The character received.
 */
-bool Sodaq_WifiBee::openConnection(const char* server, const uint16_t port,
-  const char* type)
+void Sodaq_WifiBee::asyncReadAddress(const char c)
 {
-  on();
-
-  bool result;
-
-  result = connect();
+  uint8_t* const addresses[] = { _joinCache.ip, _joinCache.netmask, _joinCache.gateway, _joinCache.bssid };
 
-  if (result) {
-    //Create the connection object
-    print("wifiConn=net.createConnection(");
-    print(type);
-    println(", false)");
-    skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
-
-    //Setup the callbacks
-    setSimpleCallBack("connection", CONNECT_PROMPT);
-    setSimpleCallBack("reconnection", RECONNECT_PROMPT);
-    setSimpleCallBack("disconnection", DISCONNECT_PROMPT);
-    setSimpleCallBack("sent", SENT_PROMPT);
-
-    print("wifiConn:on(\"receive\", ");
-    print(RECEIVED_CALLBACK);
-    println(")");
-    skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
-
-    print("wifiConn:connect(");
-    print(port);
-    print(",\"");
-    print(server);
-    println("\")");
-    result = skipTillPrompt(CONNECT_PROMPT, SERVER_CONNECT_TIMEOUT);
+  // The IP addresses have 4 bytes, the BSSID which follows them 6
+  uint8_t address = _asyncAddressByte / 4;
+  if (address > 3) {
+    address = 3;
+  }
+  uint8_t index = _asyncAddressByte - (address * 4);
+  bool hex = (address == 3);
+  uint8_t count = hex ? sizeof(_joinCache.bssid) : 4;
+
+  // _asyncRemaining is used to parse each byte, see parseAddress()
+  int8_t digit = -1;
+  if ((c >= '0') && (c <= '9')) {
+    digit = c - '0';
+  }
+  else if ((hex) && (c >= 'a') && (c <= 'f')) {
+    digit = c - 'a' + 10;
+  }
+  else if ((hex) && (c >= 'A') && (c <= 'F')) {
+    digit = c - 'A' + 10;
   }
 
-  return result;
-}
+  bool result = true;
+  bool done = false;
 
-/*!
-* This method closes a TCP or UDP connection to a remote server.
-* @return `true` if the connection was closed, otherwise `false`.
-* It will return `false` if the connection was already closed.
-*/
-bool Sodaq_WifiBee::closeConnection()
-{
-  bool result;
-  println("wifiConn:close()");
-  result = skipTillPrompt(DISCONNECT_PROMPT, SERVER_DISCONNECT_TIMEOUT);
+  if (digit >= 0) {
+    _asyncRemaining = (_asyncRemaining * (hex ? 16 : 10)) + digit;
+    _asyncAddressDigits++;
+    result = (_asyncRemaining <= 255);
+  }
+  else {
+    char separator = (index + 1 < count) ? (hex ? ':' : '.') : '|';
+    result = (c == separator) && (_asyncAddressDigits > 0);
 
-  off();
+    if (result) {
+      addresses[address][index] = _asyncRemaining;
+      _asyncRemaining = 0;
+      _asyncAddressDigits = 0;
+      _asyncAddressByte++;
+      done = (_asyncAddressByte == NETWORK_BYTES);
+    }
+  }
 
-  return result;
+  if ((!result) || (done)) {
+    _joinCache.valid = result;
+    _asyncReadMode = ASYNC_READ_PROMPTS;
+    _asyncState = ASYNC_READ_NET_END;
+    asyncExpect(luaEvents(), 1, RESPONSE_TIMEOUT);
+  }
 }
 
 /*!
-* This method transmits ASCII data over an open TCP or UDP connection.
-* @param data The data to transmit.
-* @param waitForResponse Expect/wait for a reply from the server, default = true.
-* @return `true` if the data was successfully transmitted,
-* otherwise `false`.
+* This method copies the available raw read back data into the
+* internal buffer, without waiting. Any data which does not fit is
+* discarded. All of it is passed on to the response sink.
 */
-bool Sodaq_WifiBee::transmitAsciiData(const char* data, const bool waitForResponse)
+void Sodaq_WifiBee::asyncReadRaw()
 {
-  createSendBuffer();
-  sendEscapedAscii(data);
-  transmitSendBuffer();
+  size_t count = available();
+  uint8_t chunk[16];
 
-  bool result;
-  result = skipTillPrompt(SENT_PROMPT, RESPONSE_TIMEOUT);
+  if (count > _asyncRemaining) {
+    count = _asyncRemaining;
+  }
 
-  if (result && waitForResponse) {
-    if (skipTillPrompt(RECEIVED_PROMPT, SERVER_RESPONSE_TIMEOUT)) {
-      readServerResponse();
-    }
-    else {
-      clearBuffer();
+  // Keep one byte for the terminating '\0'
+  size_t space = _bufferSize - 1 - _bufferUsed;
+  if (space > 0) {
+    if (count > space) {
+      count = space;
     }
+    count = _dataStream->readBytes(&_buffer[_bufferUsed], count);
+    writeToSink(&_buffer[_bufferUsed], count);
+    _bufferUsed += count;
+  }
+  else {
+    if (count > sizeof(chunk)) {
+      count = sizeof(chunk);
+    }
+    count = _dataStream->readBytes(chunk, count);
+    writeToSink(chunk, count);
   }
 
-  return result;
+  _asyncRemaining -= count;
+  _responseLength += count;
+  _stats.bytesIn += count;
+  _asyncTS = millis();
+
+  if (_asyncRemaining == 0) {
+    _asyncReadMode = ASYNC_READ_PROMPTS;
+    _asyncState = ASYNC_READ_END;
+    asyncExpect(eofEvents(), 1, READBACK_TIMEOUT);
+  }
 }
 
 /*!
-* This method transmits binary data over an open TCP or UDP connection.
-* @param data The data to transmit.
-* @param waitForResponse Expect/wait for a reply from the server, default = true.
-* @return `true` if the data was successfully transmitted,
-* otherwise `false`.
+* This method sends the command for a state of an asynchronous request,
+* and sets the prompts to wait for.
+* @param state The new state.
 */
-bool Sodaq_WifiBee::transmitBinaryData(const uint8_t* data, const size_t length, const bool waitForResponse)
+void Sodaq_WifiBee::asyncSendCommand(const uint8_t state)
 {
-  createSendBuffer();
-  sendEscapedBinary(data, length);
-  transmitSendBuffer();
-
-  bool result;
-  result = skipTillPrompt(SENT_PROMPT, RESPONSE_TIMEOUT);
-
-  if (result && waitForResponse) {
-    if (skipTillPrompt(RECEIVED_PROMPT, SERVER_RESPONSE_TIMEOUT)) {
-      readServerResponse();
-    }
-    else {
-      clearBuffer();
+  _asyncState = state;
+
+  // The command's bytes are counted in its phase
+  startPhase(ASYNC_PHASES[state]);
+
+  switch (state) {
+  case ASYNC_ALIVE:
+    println(((_standby) && (_powerPolicy == WIFIBEE_POWER_MODEM_SLEEP)) ?
+      NO_SLEEP_COMMAND : OK_COMMAND);
+    asyncExpect(OK_EVENTS, EVENT_COUNT(OK_EVENTS), RESPONSE_TIMEOUT);
+    return;
+  case ASYNC_BAUD_RATE:
+    // The echo setting is applied along with the baud rate
+    sendUARTCommand(_fastBaudRate);
+    _serial->flush();
+    _serial->begin(_fastBaudRate);
+    _fastUART = true;
+    _echoOff = !_echo;
+    asyncExpect(NULL, 0, BAUD_SWITCH_DELAY);
+    return;
+  case ASYNC_BAUD_PING:
+    flushInputStream();
+    println();
+    println(OK_COMMAND);
+    asyncExpect(OK_EVENTS, EVENT_COUNT(OK_EVENTS), PING_TIMEOUT);
+    return;
+  case ASYNC_HELPER:
+    println(HELPER_LOAD);
+    asyncExpect(HELPER_EVENTS, EVENT_COUNT(HELPER_EVENTS), RESPONSE_TIMEOUT);
+    return;
+  case ASYNC_INSTALL:
+    sendInstallCommand(_asyncStep);
+    break;
+  case ASYNC_ECHO_OFF:
+    // Without the echo only the new prompt is received
+    sendUARTCommand(_baudRate);
+    _echoOff = true;
+    break;
+  case ASYNC_STA_CONNECT:
+    sendJoinCommand();
+    if (_statusEvents) {
+      // The current status is reported in case it doesn't change
+      _asyncJoinTS = millis();
+      _asyncState = ASYNC_JOIN;
+      asyncExpect(STATUS_EVENTS, EVENT_COUNT(STATUS_EVENTS), statusDelay());
+      return;
     }
+    break;
+  case ASYNC_JOIN:
+    println(STATUS_CALLBACK);
+    asyncExpect(STATUS_EVENTS, EVENT_COUNT(STATUS_EVENTS), RESPONSE_TIMEOUT);
+    return;
+  case ASYNC_EVENTS_STOP:
+    println(STATUS_EVENTS_STOP);
+    break;
+  case ASYNC_READ_NET:
+    println(NETWORK_COMMAND);
+    asyncExpect(NETWORK_EVENTS, EVENT_COUNT(NETWORK_EVENTS), RESPONSE_TIMEOUT);
+    return;
+  case ASYNC_SERVER_CONNECT:
+    wakeDone();
+    sendOpenCommand(_asyncServer, _asyncPort, "net.TCP");
+    // A failed connection attempt ends with a (re)disconnect instead
+    asyncExpect(CONNECTION_EVENTS(CONNECT_EVENTS), SERVER_CONNECT_TIMEOUT);
+    return;
+  case ASYNC_CREATE_BUFFER:
+    println("sb=\"\"");
+    break;
+  case ASYNC_UPLOAD:
+    asyncUploadLine();
+    break;
+  case ASYNC_TRANSMIT:
+    sendConnectionCommand(SEND_COMMAND);
+    break;
+  case ASYNC_READ_BACK:
+    sendConnectionCommand(_rawReadBack ? READ_BACK_RAW : READ_BACK,
+      _rawReadBack ? _readBackChunk : 0);
+    asyncExpect(SOF_EVENTS, EVENT_COUNT(SOF_EVENTS), RESPONSE_TIMEOUT);
+    return;
+  case ASYNC_CLOSE:
+    sendConnectionCommand(CLOSE_COMMAND);
+    asyncExpect(CONNECTION_EVENTS(DISCONNECT_EVENTS), SERVER_DISCONNECT_TIMEOUT);
+    return;
   }
 
-  return result;
+  // The other commands just wait for the Lua prompt
+  asyncExpect(luaEvents(), 1, RESPONSE_TIMEOUT);
 }
 
 /*!
-* This method reads and stores the received response data.
-* @return `true` on if it successfully reads the whole response,
-* otherwise 'false'.
+* This method uploads the next line of an asynchronous request
+* to the send buffer. It escapes the request on the fly.
 */
-bool Sodaq_WifiBee::readServerResponse()
+void Sodaq_WifiBee::asyncUploadLine()
 {
-  bool result;
+  size_t used = UPLOAD_PREFIX_LENGTH;
 
-  println(READ_BACK);
-  result = skipTillPrompt(SOF_PROMPT, RESPONSE_TIMEOUT);
+  memcpy(_uploadLine, UPLOAD_PREFIX, UPLOAD_PREFIX_LENGTH);
+  while (_asyncSegment < _asyncSegmentCount) {
+    const char* segment = _asyncSegments[_asyncSegment];
 
-  if (result) {
-    result = readHexTillPrompt(_buffer, _bufferSize, _bufferUsed, EOF_PROMPT,
-      READBACK_TIMEOUT);
-  }
+    if ((!segment) || (segment[_asyncOffset] == '\0')) {
+      _asyncSegment++;
+      _asyncOffset = 0;
+      continue;
+    }
 
-  return result;
+    // The line buffer has room for an escape sequence past the end
+    size_t escapedLength = escapeAsciiChar(segment[_asyncOffset], &_uploadLine[used]);
+    if ((used + escapedLength) > UPLOAD_DATA_END) {
+      break;
+    }
+
+    used += escapedLength;
+    _asyncOffset++;
+  }
+  writeUploadLine(used);
 }
 
 /*!
-* This method joins the WifiBee to the network.
-* @return `true` if the network was successfully joined,
-* otherwise `false`.
+* This method continues an asynchronous request once the network
+* join has ended.
+* @param result `true` if the network was joined, otherwise `false`.
 */
-bool Sodaq_WifiBee::connect()
+void Sodaq_WifiBee::asyncJoined(const bool result)
 {
-  println("wifi.setmode(wifi.STATION)");
-  skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
-
-  print("wifi.sta.config(\"");
-  print(_APN);
-  print("\",\"");
-  print(_password);
-  println("\")");
-  skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
+  // DHCP stays off after a failed fast join, until the NodeMCU restarts
+  if (fastJoinFailed(result)) {
+    diagPrintLn("Fast join failed, restarting");
+    off();
+    asyncPowerOn();
+    return;
+  }
 
-  println("wifi.sta.connect()");
-  skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
+  _asyncResult = result;
+  _joined = result;
 
-  return waitForIP(WIFI_CONNECT_TIMEOUT);
+  if (_statusEvents) {
+    asyncSendCommand(ASYNC_EVENTS_STOP);
+  }
+  else if (result) {
+    asyncServerConnect();
+  }
+  else {
+    asyncFinish(false);
+  }
 }
 
 /*!
-* This method disconnects the WifiBee from the network.
+* This method connects to the server once the network has been joined.
+* The details for the next fast join are read first, if needed, without
+* blocking as readJoinCache() would.
 */
-void Sodaq_WifiBee::disconnect()
+void Sodaq_WifiBee::asyncServerConnect()
 {
-  println("wifi.sta.disconnect()");
-  skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
+  asyncSendCommand(((_fastJoin) && (!_joinCache.valid)) ? ASYNC_READ_NET : ASYNC_SERVER_CONNECT);
 }
 
 /*!
-* This method checks the connection status of the WifiBee.
-* @param status The status code (0..5) is written to this parameter.
-* @return `true` if it successfully read the status code,
-* otherwise `false`.
+* This method starts reading back the received data.
+* @param append `true` to add the data to the data already stored,
+* `false` to replace it.
 */
-bool Sodaq_WifiBee::getStatus(uint8_t& status)
+void Sodaq_WifiBee::asyncReadBack(const bool append)
 {
-  bool result;
+  if (!append) {
+    clearBuffer();
 
-  println(STATUS_CALLBACK);
-  result = skipTillPrompt(STATUS_PROMPT, RESPONSE_TIMEOUT);
-
-  char statusCode;
-
-  if (result) {
-    result = readChar(statusCode, RESPONSE_TIMEOUT);
-    skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
-  }
-
-  if (result) {
-    if ((statusCode >= '0') && (statusCode <= '5')) {
-      status = statusCode - '0';
-    }
-    else {
-      result = false;
-    }
+    // Only the body is written to the sink
+    _sinkSkipHeader = true;
+    _sinkHeaderIndex = 0;
   }
 
-  return result;
+  _asyncLastLength = _responseLength;
+  asyncSendCommand(ASYNC_READ_BACK);
 }
 
 /*!
-* This method repeatedly calls getStatus() to check the connection status.
-* It continues until it the network has been joined or until the
-* specified time limit has elapsed.
-* @param timeMS The time limit in milliseconds.
-* @return `true` if the Wifi network was joined, otherwise `false`.
+* This method decides whether the whole response has been read back.
+* Otherwise it waits for more data, as readHTTPResponseData() does.
+* @param result `true` if the read back was successful, otherwise `false`.
 */
-bool Sodaq_WifiBee::waitForIP(const uint32_t timeMS)
+void Sodaq_WifiBee::asyncReadBackDone(const bool result)
 {
-  bool result = false;
+  _asyncReadMode = ASYNC_READ_PROMPTS;
+  trace(WIFIBEE_TRACE_READ_BACK, result);
 
-  uint8_t status = 1;
-  uint32_t startTS = millis();
-
-  while ((!timedOut32(startTS, timeMS)) && (status == 1)) {
-    skipForTime(STATUS_DELAY);
-    getStatus(status);
+  if (_bufferSize > 0) {
+    _buffer[_bufferUsed] = '\0';
   }
 
-  //0 = Idle
-  //1 = Connecting
-  //2 = Wrong Credentials
-  //3 = AP not found
-  //4 = Connect Fail
-  //5 = Got IP
+  size_t expected;
+  bool known = getHTTPResponseLength(expected);
 
-  switch (status) {
-  case 0:
-    diagPrintLn("Failed to connect: Station idle");
-    break;
-  case 1:
-    diagPrintLn("Failed to connect: Timeout");
-    break;
-  case 2:
-    diagPrintLn("Failed to connect: Wrong credentials");
-    break;
-  case 3:
-    diagPrintLn("Failed to connect: AP not found");
-    break;
-  case 4:
-    diagPrintLn("Failed to connect: Connection failed");
-    break;
-  case 5:
-    diagPrintLn("Success: IP received");
-    result = true;
-    break;
+  // A full chunk means more data may be queued, it is read back right away
+  bool more = (_rawReadBack) && (_readBackChunk > 0) &&
+    ((_responseLength - _asyncLastLength) == _readBackChunk);
+
+  if ((result) && (more) && (_responseDropped == 0) && ((!known) || (_responseLength < expected))) {
+    _asyncLastEvent = 0;
+    asyncReadBack(true);
   }
+  else if ((!result) || (_responseDropped > 0) || (known && (_responseLength >= expected)) ||
+    (!_connectionOpen) || ((_asyncLastEvent != 0) && (_responseLength == _asyncLastLength))) {
+    _sinkSkipHeader = false;
+    parseHTTPResponse(_asyncHttpCode);
 
-  return result;
+    // As readHTTPResponseData(), an incomplete response fails the request
+    asyncFinish((_responseDropped == 0) && ((!known) || (_responseLength >= expected)));
+  }
+  else {
+    _asyncStep = 1;
+    _asyncState = ASYNC_RESPONSE;
+    asyncExpect(CONNECTION_EVENTS(RECEIVED_EVENTS),
+      known ? SERVER_RESPONSE_TIMEOUT : NEXT_PACKET_TIMEOUT);
+  }
 }
 
 /*!
-* This method constructs and sends a generic HTTP request.
-* @param server The server/host to connect to (IP address or domain).
-* @param port The port to connect to.
-* @param The HTTP method to use. e.g. "GET", "POST" etc.
-* @param location The resource location on the server/host.
-* @param headers Any additional headers, each must be followed by a CRLF.
-* HOST & Content-Length headers are added automatically.
-* @param body The body (can be blank) to send with the request. Must not start with a CRLF.
-* @param httpCode The HTTP response code is written to this parameter (if a response is received).
-* @return `true` if a connection is established and the data is sent, `false` otherwise.
+* This method ends an asynchronous request. Unless the request uses the
+* open HTTP session, it first closes the connection and applies the
+* power policy. It then calls the completion callback.
+* @param result The result of the request.
 */
-bool Sodaq_WifiBee::HTTPAction(const char* server, const uint16_t port,
-  const char* method, const char* location, const char* headers,
-  const char* body, uint16_t& httpCode)
+void Sodaq_WifiBee::asyncFinish(const bool result)
 {
-  bool result;
+  _asyncResult = result;
 
-  // Open the connection
-  result = openConnection(server, port, "net.TCP");
+  if (!_asyncKeepAlive) {
+    if ((_connectionOpen) && (_asyncState != ASYNC_CLOSE)) {
+      asyncSendCommand(ASYNC_CLOSE);
+      return;
+    }
 
-  if (result) {
-    createSendBuffer();
+    standby();
+  }
 
-    sendAscii(method);
-    sendAscii(" ");
-    sendAscii(location);
-    sendAscii(" HTTP/1.1\\r\\n");
+  _asyncState = ASYNC_IDLE;
+  _asyncReadMode = ASYNC_READ_PROMPTS;
+  _sinkSkipHeader = false;
 
-    sendAscii("HOST: ");
-    sendAscii(server);
-    sendAscii(":");
+  endPhase(WIFIBEE_PHASE_COUNT);
 
-    char buff[11];
-    itoa(port, buff, 10);
-    sendAscii(buff);
-    sendAscii("\\r\\n");
+  if (_completionCallback) {
+    _completionCallback(_asyncResult, _asyncHttpCode);
+  }
+}
 
-    if (strcmp(method, "GET") != 0) {
-      sendAscii("Content-Length: ");
-      itoa(strlen(body), buff, 10);
-      sendAscii(buff);
-      sendAscii("\\r\\n");
+/*!
+* This method records an event in the trace buffer, if one is set.
+* The bytes written and read since the previous event are included.
+* @param type The type of the event, WIFIBEE_TRACE_...
+* @param detail The detail, which depends on the type.
+*/
+void Sodaq_WifiBee::trace(const uint8_t type, const uint8_t detail)
+{
+  if (_traceBuffer) {
+    WifiBeeTraceEvent& event = _traceBuffer[_traceHead];
+
+    event.timestamp = millis();
+    event.type = type;
+    event.detail = detail;
+    uint32_t bytesOut = _stats.bytesOut - _traceBytesOut;
+    uint32_t bytesIn = _stats.bytesIn - _traceBytesIn;
+    event.bytesOut = (bytesOut > 0xFFFF) ? 0xFFFF : bytesOut;
+    event.bytesIn = (bytesIn > 0xFFFF) ? 0xFFFF : bytesIn;
+
+    _traceHead = (_traceHead + 1) % _traceSize;
+    if (_traceCount < _traceSize) {
+      _traceCount++;
     }
+  }
 
-    sendEscapedAscii(headers);
-    sendAscii("\\r\\n");
+  _traceBytesOut = _stats.bytesOut;
+  _traceBytesIn = _stats.bytesIn;
+}
 
-    sendEscapedAscii(body);
+/*!
+* This method enters a phase of an operation. The time and bytes up to
+* now are counted in the current phase. Entering the current phase again
+* doesn't count as another run.
+* @param phase The phase to enter, WIFIBEE_PHASE_...
+* @return The phase which was current, to be passed to endPhase().
+*/
+uint8_t Sodaq_WifiBee::startPhase(const uint8_t phase)
+{
+  updatePhase();
 
-    transmitSendBuffer();
+  uint8_t outer = _phase;
 
-    // Wait till we hear that it was sent
-    result = skipTillPrompt(SENT_PROMPT, RESPONSE_TIMEOUT);
+  if ((phase != _phase) && (phase < WIFIBEE_PHASE_COUNT)) {
+    _stats.phases[phase].runs++;
+  }
+  _phase = phase;
 
-    // Wait till we get the data received prompt
-    if (result) {
-      if (skipTillPrompt(RECEIVED_PROMPT, SERVER_RESPONSE_TIMEOUT)) {
-        while (skipTillPrompt(RECEIVED_PROMPT, NEXT_PACKET_TIMEOUT)) {
-        }
+  return outer;
+}
 
-        readServerResponse();
-        parseHTTPResponse(httpCode);
-      }
-      else {
-        clearBuffer();
-      }
-    }
+/*!
+* This method leaves the current phase and returns to the phase which
+* it was started from.
+* @param outer The phase returned by startPhase().
+*/
+void Sodaq_WifiBee::endPhase(const uint8_t outer)
+{
+  updatePhase();
+  _phase = outer;
+}
 
-    // The connection might have closed automatically
-    closeConnection();
+/*!
+* This method adds the time and bytes since the last update to the
+* statistics of the current phase.
+*/
+void Sodaq_WifiBee::updatePhase()
+{
+  uint32_t nowTS = millis();
+
+  if (_phase < WIFIBEE_PHASE_COUNT) {
+    WifiBeePhaseStats& phase = _stats.phases[_phase];
+
+    phase.timeMS += nowTS - _phaseTS;
+    phase.bytesOut += _stats.bytesOut - _phaseBytesOut;
+    phase.bytesIn += _stats.bytesIn - _phaseBytesIn;
   }
 
-  return result;
+  _phaseTS = nowTS;
+  _phaseBytesOut = _stats.bytesOut;
+  _phaseBytesIn = _stats.bytesIn;
 }
 
 /*!
-* This method parses the HTTP response code from the data received.
-* @param httpCode The response code is written into this parameter.
-* @return `true` if the conversion returns a non-zero value,
-* otherwise `false` .
+* This method counts a wait for a prompt in the statistics.
+* @param found `true` if the prompt was found, `false` if it timed out.
 */
-bool Sodaq_WifiBee::parseHTTPResponse(uint16_t& httpCode)
+void Sodaq_WifiBee::countWait(const bool found)
 {
-  bool result = false;
+  WifiBeePhaseStats* phase = (_phase < WIFIBEE_PHASE_COUNT) ? &_stats.phases[_phase] : NULL;
 
-  // The HTTP response code should follow the first ' '
-  if (_bufferUsed > 0) {
-    char* codePos = strstr((char*)_buffer, " ");
-    if (codePos) {
-      httpCode = atoi(codePos);
-      if (httpCode != 0) {
-        result = true;
-      }
+  if (found) {
+    _stats.roundTrips++;
+    if (phase) {
+      phase->roundTrips++;
+    }
+  }
+  else {
+    _stats.timeouts++;
+    if (phase) {
+      phase->timeouts++;
     }
   }
-
-  return result;
 }
 
 /*!
@@ -1423,28 +4849,14 @@ bool Sodaq_WifiBee::timedOut32(uint32_t startTS, uint32_t ms)
   return (diffTS > ms);
 }
 
-/*!
-* This inline method sets up simple callbacks.
-* Callbacks which simply print a tag.
-* @param eventName The event or callback name.
-* @param tag The tag to print when the event is triggered.
-*/
-inline void Sodaq_WifiBee::setSimpleCallBack(const char* eventName, const char* tag)
-{
-  print("wifiConn:on(\"");
-  print(eventName);
-  print("\", function(s) print(\"");
-  print(tag);
-  println("\") end)");
-  skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
-}
-
 /*!
 * This inline method clears the internal buffer.
 */
 inline void Sodaq_WifiBee::clearBuffer()
 {
   _bufferUsed = 0;
+  _responseLength = 0;
+  _responseDropped = 0;
 }
 
 /*!
@@ -1456,14 +4868,89 @@ inline void Sodaq_WifiBee::_delay(uint32_t ms)
   delay(ms);
 }
 
+/*!
+* This inline method is used by the wait loops while no data is available.
+* It calls the idle callback, if one is set, otherwise it delays for IDLE_DELAY ms.
+* @param startTS The start timestamp of the wait.
+* @param timeMS The time limit of the wait in milliseconds.
+*/
+inline void Sodaq_WifiBee::idle(const uint32_t startTS, const uint32_t timeMS)
+{
+  if (_idleCallback) {
+    uint32_t elapsed = millis() - startTS;
+    _idleCallback((elapsed < timeMS) ? (timeMS - elapsed) : 0);
+  }
+  else {
+    _delay(IDLE_DELAY);
+  }
+}
+
+/*!
+* This inline method returns the time limit for joining the network.
+* @return The time limit, shorter for a fast join.
+*/
+inline uint32_t Sodaq_WifiBee::joinTimeout()
+{
+  return _fastJoinTried ? FAST_JOIN_TIMEOUT : WIFI_CONNECT_TIMEOUT;
+}
+
+/*!
+* This inline method returns the time between checks of the status
+* while joining the network.
+* @return The time, shorter for a fast join.
+*/
+inline uint32_t Sodaq_WifiBee::statusDelay()
+{
+  return _fastJoinTried ? FAST_JOIN_STATUS_DELAY : STATUS_DELAY;
+}
+
+/*!
+* This inline method returns the prompt which follows each Lua command.
+* @return The prompt, which depends on whether the echo is switched off.
+*/
+inline const char* Sodaq_WifiBee::luaPrompt()
+{
+  return _echoOff ? NO_ECHO_PROMPT : LUA_PROMPT;
+}
+
+/*!
+* This inline method returns the prompt which ends the read back data.
+* Without the echo it includes the Lua prompt which follows, so that
+* it isn't mistaken for the prompt of the next command.
+* @return The prompt, which depends on whether the echo is switched off.
+*/
+inline const char* Sodaq_WifiBee::eofPrompt()
+{
+  return _echoOff ? EOF_NO_ECHO_PROMPT : EOF_PROMPT;
+}
+
+/*!
+* This inline method returns the single entry prompt set for luaPrompt().
+* @return The prompt set, which depends on whether the echo is switched off.
+*/
+inline const char* const* Sodaq_WifiBee::luaEvents()
+{
+  return _echoOff ? NO_ECHO_EVENTS : LUA_EVENTS;
+}
+
+/*!
+* This inline method returns the single entry prompt set for eofPrompt().
+* @return The prompt set, which depends on whether the echo is switched off.
+*/
+inline const char* const* Sodaq_WifiBee::eofEvents()
+{
+  return _echoOff ? EOF_NO_ECHO_EVENTS : EOF_EVENTS;
+}
+
 /*!
 * This inline method creates a buffer on the NodeMCU to be
 * loaded with data to be sent.
 */
 inline void Sodaq_WifiBee::createSendBuffer()
 {
+  _uploadUsed = 0;
   println("sb=\"\"");
-  skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
+  skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT);
 }
 
 /*!
@@ -1472,8 +4959,25 @@ inline void Sodaq_WifiBee::createSendBuffer()
 */
 inline void Sodaq_WifiBee::transmitSendBuffer()
 {
-  println("wifiConn:send(sb) sb=\"\"");
-  skipTillPrompt(LUA_PROMPT, RESPONSE_TIMEOUT);
+  flushUploadLine();
+  waitForUpload();
+  // It must not overlap with any streamed payloads
+  waitForSends(0);
+  sendConnectionCommand(SEND_COMMAND);
+  skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT);
+}
+
+/*!
+* This inline method queues the send buffer on the NodeMCU, to be sent
+* once the payloads queued before it have been sent.
+*/
+inline void Sodaq_WifiBee::queueSendBuffer()
+{
+  flushUploadLine();
+  waitForUpload();
+  sendConnectionCommand(QUEUE_COMMAND);
+  _sendsPending++;
+  skipTillPrompt(luaPrompt(), RESPONSE_TIMEOUT);
 }
 
 /*!
@@ -35,6 +35,210 @@
  */
 #define WIFIBEE_DEFAULT_BUFFER_SIZE      1024
 
+/*!
+ * \def WIFIBEE_DEFAULT_UPLOAD_WINDOW
+ *
+ * The number of send buffer chunk lines which may be in flight to the
+ * NodeMCU before waiting for its prompt. A value of 1 waits for the
+ * prompt after every line. It can be changed with setUploadWindow().
+ */
+#define WIFIBEE_DEFAULT_UPLOAD_WINDOW    1
+
+/*!
+ * \def WIFIBEE_MAX_UPLOAD_WINDOW
+ *
+ * The upper limit for the upload window. While it is executing a line
+ * the NodeMCU buffers 256 bytes of UART input, i.e. one more chunk line
+ * of up to 255 characters.
+ */
+#define WIFIBEE_MAX_UPLOAD_WINDOW        2
+
+/*!
+ * \def WIFIBEE_DEFAULT_SEND_WINDOW
+ *
+ * The number of streamed payloads which may be queued on the NodeMCU
+ * before waiting for one of them to be sent. It can be changed with
+ * setSendWindow().
+ */
+#define WIFIBEE_DEFAULT_SEND_WINDOW      4
+
+/*!
+ * \def WIFIBEE_MAX_SEND_WINDOW
+ *
+ * The upper limit for the send window. Each queued payload takes up
+ * NodeMCU heap until it has been sent.
+ */
+#define WIFIBEE_MAX_SEND_WINDOW          8
+
+/*!
+ * \def WIFIBEE_READ_BACK_CHUNK
+ *
+ * The default maximum number of bytes read back at once in raw mode, see
+ * setRawReadBack(). With its framing it fits in the 64 byte serial receive
+ * buffer of the AVR boards. It can be changed with a compiler flag.
+ */
+#ifndef WIFIBEE_READ_BACK_CHUNK
+#define WIFIBEE_READ_BACK_CHUNK          48
+#endif
+
+/*!
+ * \def WIFIBEE_ASYNC_SEGMENTS
+ *
+ * The maximum number of pieces an asynchronous HTTP request is
+ * uploaded from (request line, HOST, Content-Length, headers, body).
+ */
+#define WIFIBEE_ASYNC_SEGMENTS           14
+
+/*!
+ * \def WIFIBEE_MAX_CONNECTIONS
+ *
+ * The number of connection handles. Each connection has its own socket
+ * on the NodeMCU, and its own buffer for the received data. The ESP8266
+ * itself supports up to 5 TCP connections at once.
+ */
+#define WIFIBEE_MAX_CONNECTIONS          4
+
+/*!
+ * \def WIFIBEE_MAX_BAUD_RATE
+ *
+ * The default upper limit for negotiateBaudRate(). The ESP8266 UART
+ * supports higher rates, but the host's UART may not keep up.
+ */
+#define WIFIBEE_MAX_BAUD_RATE            921600
+
+/*!
+ * \def WIFIBEE_DIAG_LEVEL
+ *
+ * The amount of diagnostic output written to the stream set with
+ * setDiag(). It is selected at compile time, e.g. with a compiler flag,
+ * the disabled output is compiled out.
+ * 0 = none, 1 = messages, 2 = messages and all the data received.
+ */
+#ifndef WIFIBEE_DIAG_LEVEL
+#define WIFIBEE_DIAG_LEVEL               2
+#endif
+
+/*!
+ * The power policies, what happens to the device after each connection.
+ */
+enum {
+  WIFIBEE_POWER_OFF,  /*!< It is switched off, each request starts with a full boot and join. */
+  WIFIBEE_POWER_KEEP_ALIVE,  /*!< It stays on and joined. */
+  WIFIBEE_POWER_MODEM_SLEEP,  /*!< It stays on and joined, with the radio in modem sleep between requests. */
+  WIFIBEE_POWER_DEEP_SLEEP  /*!< It goes into a timed deep sleep, after which it restarts without RF calibration. */
+};
+
+/*!
+ * The types of the events recorded in the trace buffer.
+ */
+enum {
+  WIFIBEE_TRACE_PROMPT,  /*!< A prompt was found, the detail is its index in the prompt set. */
+  WIFIBEE_TRACE_TIMEOUT,  /*!< A wait for a prompt timed out. */
+  WIFIBEE_TRACE_READ_BACK,  /*!< Received data was read back, the detail is 1 if successful. */
+  WIFIBEE_TRACE_POWER  /*!< The device was switched on (1) or off (0). */
+};
+
+/*!
+ * An event recorded in the trace buffer.
+ * The byte counts are those written to and read from the device since
+ * the previous event, limited to 65535.
+ */
+struct WifiBeeTraceEvent
+{
+  uint32_t timestamp;  /*!< The value of millis() when it was recorded. */
+  uint8_t type;  /*!< The type of the event, WIFIBEE_TRACE_... */
+  uint8_t detail;  /*!< The detail, which depends on the type. */
+  uint16_t bytesOut;  /*!< The number of bytes written. */
+  uint16_t bytesIn;  /*!< The number of bytes read. */
+};
+
+/*!
+ * The phases of an operation which are measured in the statistics.
+ */
+enum {
+  WIFIBEE_PHASE_POWER_ON,  /*!< Switching on, loading the helper and setting up the UART, on(). */
+  WIFIBEE_PHASE_JOIN,  /*!< Sending the join command and stopping the status events, connect(). */
+  WIFIBEE_PHASE_IP,  /*!< Waiting for an IP address, waitForIP(). */
+  WIFIBEE_PHASE_SOCKET,  /*!< Resolving and connecting to the server. */
+  WIFIBEE_PHASE_UPLOAD,  /*!< Uploading the data until it has been sent. */
+  WIFIBEE_PHASE_SERVER_WAIT,  /*!< Waiting for the server's response. */
+  WIFIBEE_PHASE_READ_BACK,  /*!< Reading the received data back, readServerResponse(). */
+  WIFIBEE_PHASE_CLOSE,  /*!< Closing the connection and switching off, closeConnection(). */
+  WIFIBEE_PHASE_COUNT  /*!< The number of phases. */
+};
+
+/*!
+ * The statistics of one phase. The time and bytes are those of the
+ * phase itself, a phase which runs inside another is not counted twice.
+ */
+struct WifiBeePhaseStats
+{
+  uint32_t runs;  /*!< The number of times the phase was entered. */
+  uint32_t timeMS;  /*!< The total time spent in the phase in milliseconds. */
+  uint32_t bytesOut;  /*!< The number of bytes written to the device. */
+  uint32_t bytesIn;  /*!< The number of bytes read from the device. */
+  uint16_t roundTrips;  /*!< The number of prompts waited for and found. */
+  uint16_t timeouts;  /*!< The number of waits for a prompt which timed out. */
+};
+
+/*!
+ * The statistics collected since they were last reset.
+ * The totals include the traffic outside of the phases, e.g. status requests.
+ */
+struct WifiBeeStats
+{
+  WifiBeePhaseStats phases[WIFIBEE_PHASE_COUNT];  /*!< The statistics per phase, WIFIBEE_PHASE_... */
+  uint32_t bytesOut;  /*!< The total number of bytes written to the device. */
+  uint32_t bytesIn;  /*!< The total number of bytes read from the device. */
+  uint32_t roundTrips;  /*!< The total number of prompts waited for and found. */
+  uint32_t timeouts;  /*!< The total number of waits for a prompt which timed out. */
+  uint32_t fastJoins;  /*!< The number of fast joins which succeeded. */
+  uint32_t fastJoinFailures;  /*!< The number of fast joins which failed and fell back to a full join. */
+  uint32_t bytesDropped;  /*!< The number of received bytes dropped by the NodeMCU as the connection's queue was full. */
+};
+
+/*!
+ * The network details cached for a fast join: the access point and the
+ * IP configuration of the last full join.
+ */
+struct WifiBeeJoinCache
+{
+  uint8_t bssid[6];  /*!< The MAC address of the access point. */
+  uint8_t ip[4];  /*!< The IP address. */
+  uint8_t netmask[4];  /*!< The netmask. */
+  uint8_t gateway[4];  /*!< The gateway's IP address. */
+  bool valid;  /*!< Set if the details can be used. */
+};
+
+/*!
+ * The state of a connection handle, kept while another one is selected.
+ */
+struct WifiBeeConnection
+{
+  uint8_t* buffer;  /*!< The buffer used to store the connection's received data. */
+  size_t bufferSize;  /*!< The allocated size of `buffer`. */
+  size_t bufferUsed;  /*!< The current amount of `buffer` which is in use. */
+  size_t responseLength;  /*!< The amount of data received, including any which did not fit in `buffer`. */
+  size_t responseDropped;  /*!< The amount of data received but dropped by the NodeMCU. */
+  bool open;  /*!< Set while the connection has not reported a disconnect. */
+};
+
+/*!
+ * The type of the function which is called when an asynchronous
+ * request completes.
+ * The first parameter is the result of the request, the second the
+ * HTTP response code (0 if no response was received).
+ */
+typedef void (*WifiBeeCompletionCallback)(bool result, uint16_t httpCode);
+
+/*!
+ * The type of the function which is called while the library waits for
+ * the device. The parameter is the remaining time budget of the wait in
+ * milliseconds. The function should return quickly, or once data has
+ * been received from the device.
+ */
+typedef void (*WifiBeeIdleCallback)(uint32_t remainingMS);
+
 class Sodaq_WifiBee : public Stream
 {
 public:
@@ -52,6 +256,37 @@ public:
 
   void setDiag(Stream& stream);
 
+  void setUploadWindow(const uint8_t lines);
+
+  void setSendWindow(const uint8_t count);
+
+  void setStatusEvents(const bool enabled);
+
+  void setRawReadBack(const bool enabled, const size_t chunkSize = WIFIBEE_READ_BACK_CHUNK);
+
+  void setBaudRate(const uint32_t baudRate);
+
+  void setEcho(const bool enabled);
+
+  bool negotiateBaudRate(HardwareSerial& serial,
+    const uint32_t maxRate=WIFIBEE_MAX_BAUD_RATE);
+
+  uint32_t getBaudRate();
+
+  uint32_t getThroughput();
+
+  void setIdleCallback(WifiBeeIdleCallback callback);
+
+  void setPowerPolicy(const uint8_t policy, const uint32_t timeMS=0);
+
+  uint32_t getWakeLatency();
+
+  void setFastJoin(const bool enabled);
+
+  const WifiBeeJoinCache& getJoinCache();
+
+  void setJoinCache(const WifiBeeJoinCache& cache);
+
   const char* getDeviceType();
 
   bool on();
@@ -87,6 +322,44 @@ public:
   bool HTTPPut(const String& server, const uint16_t port, const String& URI,
     const String& headers, const String& body, uint16_t& httpCode);
 
+  // HTTP session methods
+  // While a session is open, HTTP requests to the same server and port
+  // keep the device on and reuse the connection (Connection: keep-alive)
+  // Requests to another server on the session's connection are refused
+  bool openHTTPSession(const char* server, const uint16_t port);
+
+  bool openHTTPSession(const String& server, const uint16_t port);
+
+  bool closeHTTPSession();
+
+  // Asynchronous HTTP methods
+  // These start the request and return immediately, poll() must then
+  // be called (e.g. from loop()) until the request completes.
+  // The strings passed must remain valid until the request completes.
+  bool beginHTTPGet(const char* server, const uint16_t port, const char* URI,
+    const char* headers);
+
+  bool beginHTTPPost(const char* server, const uint16_t port, const char* URI,
+    const char* headers, const char* body);
+
+  bool beginHTTPPut(const char* server, const uint16_t port, const char* URI,
+    const char* headers, const char* body);
+
+  void setCompletionCallback(WifiBeeCompletionCallback callback);
+
+  bool isBusy();
+
+  void poll();
+
+  // Connection handles
+  // The TCP, UDP and HTTP methods use the selected connection (0 by default),
+  // several connections can be open at once and their traffic interleaved
+  bool setConnectionBuffer(const uint8_t handle, const size_t bufferSize);
+
+  bool selectConnection(const uint8_t handle);
+
+  uint8_t getConnection();
+
   // TCP methods
   bool openTCP(const char* server, uint16_t port);
 
@@ -100,6 +373,17 @@ public:
 
   bool closeTCP();
 
+  // TCP streaming methods
+  // The payloads are queued on the NodeMCU and sent one after another,
+  // only waiting once the send window is full
+  bool streamTCPAscii(const char* data);
+
+  bool streamTCPAscii(const String& data);
+
+  bool streamTCPBinary(const uint8_t* data, const size_t length);
+
+  bool flushTCP();
+
   // UDP methods
   bool openUDP(const char* server, uint16_t port);
 
@@ -118,10 +402,37 @@ public:
 
   bool readResponseBinary(uint8_t* buffer, const size_t size, size_t& bytesRead);
 
+  bool readBackResponse(const size_t maxLength = 0);
+
+  bool pollConnection(bool& received);
+
   bool readHTTPResponse(char* buffer, const size_t size, size_t& bytesRead, uint16_t& httpCode);
 
+  // Response streaming
+  // Received data is also written to the sink as it is read back,
+  // HTTP responses without their header
+  void setResponseSink(Print& sink);
+
+  void setResponseSink(Print* sink);
+
+  // Tracing
+  // Events are recorded in a ring buffer, without any output
+  void setTraceBuffer(WifiBeeTraceEvent* buffer, const size_t count);
+
+  void dumpTrace(Print& stream);
+
+  // Statistics
+  // The time, bytes and prompt waits of each phase of the requests
+  const WifiBeeStats& getStats();
+
+  void resetStats();
+
   // Stream implementations
   size_t write(uint8_t x);
+
+  size_t write(const uint8_t* buffer, size_t size);
+
+  using Print::write;
   
   int available();
   
@@ -145,6 +456,116 @@ private:
   size_t _bufferUsed;  /*!< The current amount of `_buffer` which is in use. */
   uint8_t* _buffer;  /*!< The buffer used to store received data. */
 
+  WifiBeeTraceEvent* _traceBuffer;  /*!< The trace ring buffer, NULL if tracing is off. */
+  size_t _traceSize;  /*!< The number of entries in `_traceBuffer`. */
+  size_t _traceHead;  /*!< The index of the next entry to record. */
+  size_t _traceCount;  /*!< The number of entries recorded. */
+  uint32_t _traceBytesOut;  /*!< The value of `_stats.bytesOut` at the last event. */
+  uint32_t _traceBytesIn;  /*!< The value of `_stats.bytesIn` at the last event. */
+
+  WifiBeeStats _stats;  /*!< The statistics collected since the last reset. */
+  uint8_t _phase;  /*!< The current phase, WIFIBEE_PHASE_COUNT if none. */
+  uint32_t _phaseTS;  /*!< The timestamp from which the current phase's time is counted. */
+  uint32_t _phaseBytesOut;  /*!< The value of `_stats.bytesOut` when the current phase's bytes are counted from. */
+  uint32_t _phaseBytesIn;  /*!< The value of `_stats.bytesIn` when the current phase's bytes are counted from. */
+
+  char* _uploadLine;  /*!< The buffer used to build each send buffer upload line. */
+  size_t _uploadUsed;  /*!< The current amount of `_uploadLine` which is in use, 0 if none. */
+  size_t _responseLength;  /*!< The amount of data received, including any which did not fit in `_buffer`. */
+  size_t _responseDropped;  /*!< The amount of data received but dropped by the NodeMCU, as its queue was full. */
+
+  Print* _responseSink;  /*!< An optional sink, received data is written to as it is read back. */
+  bool _sinkSkipHeader;  /*!< Set while an HTTP header is being kept from `_responseSink`. */
+  uint8_t _sinkHeaderIndex;  /*!< The progress matching the end of the HTTP header. */
+
+  uint8_t _uploadWindow;  /*!< The number of upload lines allowed in flight. */
+  uint8_t _uploadPending;  /*!< The number of upload lines awaiting a prompt. */
+  bool _uploadStart;  /*!< Set if the next upload line replaces the send buffer, instead of adding to it. */
+
+  uint8_t _sendWindow;  /*!< The number of streamed payloads allowed to wait to be sent. */
+  uint8_t _sendsPending;  /*!< The number of streamed payloads which have not been reported sent. */
+  char _sendPrompts[2][8];  /*!< The sent and disconnect prompts of the streaming connection. */
+  uint8_t _sendPromptIndex[2];  /*!< The match progress for each entry in `_sendPrompts`. */
+  uint8_t _sendPromptFallback[2][8];  /*!< The fall back table of each entry in `_sendPrompts`. */
+
+  bool _connectionOpen;  /*!< Set while the TCP/UDP connection has not reported a disconnect. */
+
+  WifiBeeConnection _connections[WIFIBEE_MAX_CONNECTIONS];  /*!< The state of each connection, the selected one's is in the members above. */
+  uint8_t _handle;  /*!< The handle of the selected connection. */
+  char _taggedPrompts[4][8];  /*!< The prompts of the selected connection, tagged with its handle (>= MAX_EVENT_PROMPTS). */
+  const char* _taggedEvents[4];  /*!< The entries of `_taggedPrompts` (>= MAX_EVENT_PROMPTS). */
+
+  bool _statusEvents;  /*!< Set if the NodeMCU should push station status changes. */
+
+  bool _rawReadBack;  /*!< Set if received data is read back as raw bytes instead of HEX. */
+  size_t _readBackChunk;  /*!< The maximum size of a raw read back, 0 for no limit. */
+
+  uint32_t _baudRate;  /*!< The baud rate of the stream, 0 if unknown. */
+
+  bool _echo;  /*!< Set if the NodeMCU should echo the commands sent. */
+
+  bool _echoOff;  /*!< Set while the NodeMCU's echo is switched off. */
+
+  HardwareSerial* _serial;  /*!< The serial port used, if the baud rate was negotiated. */
+
+  uint32_t _fastBaudRate;  /*!< The negotiated baud rate, 0 if none. */
+
+  bool _fastUART;  /*!< Set while the NodeMCU's UART runs at the negotiated rate. */
+
+  uint32_t _throughput;  /*!< The measured throughput in bytes per second, 0 if unknown. */
+
+  WifiBeeIdleCallback _idleCallback;  /*!< Called instead of delay() while waiting for the device. */
+
+  uint8_t _powerPolicy;  /*!< What happens to the device after each connection, WIFIBEE_POWER_... */
+  uint32_t _powerTimeMS;  /*!< The time it is kept on (0 = no limit), or the deep sleep time. */
+  bool _standby;  /*!< Set while it is kept on, ready, between connections. */
+  bool _sleeping;  /*!< Set while it is in (or restarting from) a timed deep sleep. */
+  uint32_t _standbyTS;  /*!< The timestamp at which the standby or the deep sleep started. */
+  bool _joined;  /*!< Set while it is known to be joined to the network. */
+
+  bool _fastJoin;  /*!< Set if the cached network details are used to join. */
+  bool _fastJoinTried;  /*!< Set while a fast join is being tried. */
+  WifiBeeJoinCache _joinCache;  /*!< The network details for a fast join. */
+
+  bool _waking;  /*!< Set while the wake latency is being measured. */
+  uint32_t _wakeTS;  /*!< The timestamp at which the device was last woken. */
+  uint32_t _wakeLatency;  /*!< The time from the last wake until it was ready to connect, in milliseconds. */
+
+  WifiBeeCompletionCallback _completionCallback;  /*!< Called when an asynchronous request completes. */
+
+  uint8_t _asyncState;  /*!< The state of the asynchronous request. */
+  uint8_t _asyncStep;  /*!< The step within the current state. */
+  uint8_t _asyncReadMode;  /*!< How received characters are handled. */
+  const char* const* _asyncPrompts;  /*!< The prompts being waited for. */
+  uint8_t _asyncPromptCount;  /*!< The number of entries in `_asyncPrompts`. */
+  uint8_t _asyncPromptIndex[4];  /*!< The match progress for each entry in `_asyncPrompts` (>= MAX_EVENT_PROMPTS). */
+  uint8_t _asyncPromptFallback[4][10];  /*!< The fall back table of each entry in `_asyncPrompts` (>= MAX_PROMPT_LENGTH). */
+  uint32_t _asyncTS;  /*!< The start of the current wait. */
+  uint32_t _asyncTimeout;  /*!< The time limit of the current wait. */
+  uint32_t _asyncJoinTS;  /*!< The start of the network join. */
+  int8_t _asyncLastEvent;  /*!< The event which triggered the last read back. */
+  size_t _asyncLastLength;  /*!< The response length before the last read back. */
+  size_t _asyncRemaining;  /*!< The number of raw bytes left in the read back. */
+  char _asyncHigh;  /*!< The pending high HEX nibble in the read back. */
+  uint8_t _asyncAddressByte;  /*!< The byte being parsed of the network details read for a fast join. */
+  uint8_t _asyncAddressDigits;  /*!< The number of digits of that byte received. */
+  bool _asyncKeepAlive;  /*!< Set if the request uses the open HTTP session. */
+  bool _asyncResult;  /*!< The result of the request, once it has been sent. */
+  uint16_t _asyncHttpCode;  /*!< The HTTP response code of the request. */
+  const char* _asyncServer;  /*!< The server of the request. */
+  uint16_t _asyncPort;  /*!< The port of the request. */
+  const char* _asyncSegments[WIFIBEE_ASYNC_SEGMENTS];  /*!< The pieces of the request to upload. */
+  uint8_t _asyncSegmentCount;  /*!< The number of entries in `_asyncSegments`. */
+  uint8_t _asyncSegment;  /*!< The piece being uploaded. */
+  size_t _asyncOffset;  /*!< The upload position within the piece. */
+  char _asyncPortText[6];  /*!< The port as text, for the HOST header. */
+  char _asyncLengthText[11];  /*!< The body length as text, for the Content-Length header. */
+
+  bool _sessionOpen;  /*!< Set while an HTTP session is open. */
+  String _sessionServer;  /*!< The server of the open HTTP session. */
+  uint16_t _sessionPort;  /*!< The port of the open HTTP session. */
+  uint8_t _sessionHandle;  /*!< The connection of the open HTTP session. */
+
   bool isOn();
 
   void flushInputStream();
@@ -153,37 +574,135 @@ private:
     
   bool skipTillPrompt(const char* prompt, const uint32_t timeMS);
 
+  int8_t skipTillEvent(const char* const* prompts, const uint8_t count,
+    const uint32_t timeMS);
+
+  int readInput();
+
   bool readChar(char& data, const uint32_t timeMS);
 
   bool readTillPrompt(uint8_t* buffer, const size_t size, size_t& bytesStored,
       const char* prompt, const uint32_t timeMS);
 
   bool readHexTillPrompt(uint8_t* buffer, const size_t size,
-    size_t& bytesStored, const char* prompt, const uint32_t timeMS);
+    size_t& bytesStored, size_t& bytesReceived, const char* prompt,
+    const uint32_t timeMS);
   
+  bool readRawTillPrompt(uint8_t* buffer, const size_t size,
+    size_t& bytesStored, size_t& bytesReceived, const char* prompt,
+    const uint32_t timeMS);
+
   void sendAscii(const char* data);
   
   void sendEscapedAscii(const char* data);
 
   void sendEscapedBinary(const uint8_t* data, const size_t length);
 
+  void reserveUpload(const size_t length);
+
+  void writeUploadLine(const size_t length);
+
+  void flushUploadLine();
+
+  void uploadLineSent();
+
+  bool waitForUpload();
+
+  bool beginStream();
+
+  bool waitForSends(const uint8_t limit);
+
+  void countSent(const char c);
+
+  bool loadHelper();
+
+  bool disableEcho();
+
+  void sendUARTCommand(const uint32_t baudRate);
+
+  bool ping();
+
+  bool switchBaudRate(const uint32_t baudRate);
+
+  void restart();
+
+  bool start();
+
+  bool resume();
+
+  bool wakeFromSleep();
+
+  void standby();
+
+  bool standbyExpired();
+
+  void clearDeviceState();
+
+  void wakeDone();
+
+  uint32_t measureThroughput();
+
+  void sendInstallCommand(const uint8_t step);
+
   bool openConnection(const char* server, const uint16_t port,
       const char* type);
 
+  bool openSocket(const char* server, const uint16_t port,
+      const char* type);
+
+  bool connectionInUse();
+
+  void sendOpenCommand(const char* server, const uint16_t port,
+    const char* type);
+
+  void sendConnectionCommand(const char* command, const size_t limit = 0);
+
+  const char* const* connectionEvents(const char* const* prompts, const uint8_t count);
+
+  void saveConnection();
+
+  void loadConnection();
+
+  bool otherConnectionOpen();
+
   bool closeConnection();
 
+  bool checkForEvents();
+
+  bool isSessionFor(const char* server, const uint16_t port);
+
   bool transmitAsciiData(const char* data, const bool waitForResponse);
 
   bool transmitBinaryData(const uint8_t* data, const size_t length, const bool waitForResponse);
 
-  bool readServerResponse();
+  bool readServerResponse(const bool append = false, const size_t limit = 0);
+
+  bool readDropped();
+
+  void writeToSink(const uint8_t* data, const size_t length);
+
+  bool readHTTPResponseData();
+
+  bool getHTTPResponseLength(size_t& length);
 
   bool connect();
 
+  bool join();
+
+  void sendJoinCommand();
+
+  void printAddress(const uint8_t* bytes, const size_t count, const bool hex);
+
+  bool readJoinCache();
+
+  bool fastJoinFailed(const bool result);
+
   void disconnect();
 
   bool getStatus(uint8_t& status);
 
+  bool readStatus(uint8_t& status);
+
   bool waitForIP(const uint32_t timeMS);
 
   bool HTTPAction(const char* server, const uint16_t port, const char* method,
@@ -192,17 +711,72 @@ private:
 
   bool parseHTTPResponse(uint16_t& httpCode);
 
+  bool beginHTTPAction(const char* server, const uint16_t port,
+    const char* method, const char* location, const char* headers,
+    const char* body);
+
+  void asyncPowerOn();
+
+  void asyncExpect(const char* const* prompts, const uint8_t count,
+    const uint32_t timeMS);
+
+  void asyncNext(const int8_t event);
+
+  void asyncReadData(const char c);
+
+  void asyncReadRaw();
+
+  void asyncReadAddress(const char c);
+
+  void asyncSendCommand(const uint8_t state);
+
+  void asyncUploadLine();
+
+  void asyncJoined(const bool result);
+
+  void asyncServerConnect();
+
+  void asyncReadBack(const bool append);
+
+  void asyncReadBackDone(const bool result);
+
+  void asyncFinish(const bool result);
+
   bool timedOut32(uint32_t startTS, uint32_t ms);
 
-  inline void setSimpleCallBack(const char* eventName, const char* tag);
+  void trace(const uint8_t type, const uint8_t detail);
+
+  uint8_t startPhase(const uint8_t phase);
+
+  void endPhase(const uint8_t outer);
+
+  void updatePhase();
+
+  void countWait(const bool found);
 
   inline void clearBuffer();
 
   inline void _delay(uint32_t ms);
 
+  inline void idle(const uint32_t startTS, const uint32_t timeMS);
+
+  inline uint32_t joinTimeout();
+
+  inline uint32_t statusDelay();
+
+  inline const char* luaPrompt();
+
+  inline const char* eofPrompt();
+
+  inline const char* const* luaEvents();
+
+  inline const char* const* eofEvents();
+
   inline void createSendBuffer();
 
   inline void transmitSendBuffer();
+
+  inline void queueSendBuffer();
 };
 
 #endif // SODAQ_WIFI_BEE_H_
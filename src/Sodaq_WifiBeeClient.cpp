@@ -0,0 +1,345 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#include "Sodaq_WifiBeeClient.h"
+
+// The interval at which an empty receive buffer is refilled, even if no
+// data received prompt has been seen, it may have been skipped while
+// waiting for another prompt
+#define POLL_INTERVAL 100
+
+/*!
+* This function formats a byte in decimal, without a terminating '\0'.
+* @param value The byte to format.
+* @param text The buffer to write to, with room for 3 characters.
+* @return A pointer to the character after the last one written.
+*/
+static char* formatByte(const uint8_t value, char* text)
+{
+  if (value >= 100) {
+    *text++ = '0' + (value / 100);
+  }
+  if (value >= 10) {
+    *text++ = '0' + ((value / 10) % 10);
+  }
+  *text++ = '0' + (value % 10);
+
+  return text;
+}
+
+/*!
+* Initialises member variables to default values.
+* @param bee The WifiBee to use, it must have been initialised.
+* @param handle The connection handle to use, see
+* Sodaq_WifiBee::selectConnection(). The connection's buffer must be
+* larger than WIFIBEE_CLIENT_RX_SIZE, one byte is kept for a '\0'.
+*/
+Sodaq_WifiBeeClient::Sodaq_WifiBeeClient(Sodaq_WifiBee& bee, const uint8_t handle)
+{
+  _bee = &bee;
+  _handle = handle;
+
+  _txUsed = 0;
+
+  _rxHead = 0;
+  _rxCount = 0;
+  _rxMore = false;
+  _pollTS = 0;
+}
+
+// Client implementations
+/*!
+* Implementation of Client::connect(ip, port) \n
+* @param ip The IP address of the server.
+* @param port The port to connect to.
+* @return 1 if the connection was opened, otherwise 0.
+*/
+int Sodaq_WifiBeeClient::connect(IPAddress ip, uint16_t port)
+{
+  char host[16];
+  char* end = host;
+
+  for (uint8_t i = 0; i < 4; i++) {
+    if (i > 0) {
+      *end++ = '.';
+    }
+    end = formatByte(ip[i], end);
+  }
+  *end = '\0';
+
+  return connect(host, port);
+}
+
+/*!
+* Implementation of Client::connect(host, port) \n
+* It switches the WifiBee on and joins the network if needed.
+* @param host The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @return 1 if the connection was opened, otherwise 0.
+*/
+int Sodaq_WifiBeeClient::connect(const char* host, uint16_t port)
+{
+  _txUsed = 0;
+  _rxHead = 0;
+  _rxCount = 0;
+  _rxMore = false;
+  _pollTS = millis();
+
+  if (!select()) {
+    return 0;
+  }
+
+  return _bee->openTCP(host, port) ? 1 : 0;
+}
+
+/*!
+* Implementation of Print::write(x) \n
+* The byte is sent with the bytes written after it.
+* @param x The byte to write.
+* @return 1 if the byte was buffered, otherwise 0.
+*/
+size_t Sodaq_WifiBeeClient::write(uint8_t x)
+{
+  return write(&x, 1);
+}
+
+/*!
+* Implementation of Print::write(buffer, size) \n
+* The bytes are collected in the send buffer, which is sent once it is
+* full, or once a response is waited for.
+* @param buffer The bytes to write.
+* @param size The size of `buffer`.
+* @return The number of bytes buffered.
+*/
+size_t Sodaq_WifiBeeClient::write(const uint8_t* buffer, size_t size)
+{
+  size_t count = 0;
+
+  while (count < size) {
+    if ((_txUsed == sizeof(_txBuffer)) && (!sendBuffer())) {
+      break;
+    }
+
+    size_t length = sizeof(_txBuffer) - _txUsed;
+    if (length > (size - count)) {
+      length = size - count;
+    }
+
+    memcpy(&_txBuffer[_txUsed], &buffer[count], length);
+    _txUsed += length;
+    count += length;
+  }
+
+  return count;
+}
+
+/*!
+* Implementation of Stream::available() \n
+* It sends any buffered bytes first, then reads back any received data
+* which fits in the receive buffer.
+* @return The number of bytes which can be read.
+*/
+int Sodaq_WifiBeeClient::available()
+{
+  if (_rxCount < sizeof(_rxBuffer)) {
+    fillBuffer();
+  }
+
+  return _rxCount;
+}
+
+/*!
+* Implementation of Stream::read() \n
+* @return The next byte received, or -1 if there is none available.
+*/
+int Sodaq_WifiBeeClient::read()
+{
+  if ((_rxCount == 0) && (available() == 0)) {
+    return -1;
+  }
+
+  uint8_t x = _rxBuffer[_rxHead];
+
+  _rxHead = (_rxHead + 1) % sizeof(_rxBuffer);
+  _rxCount--;
+
+  return x;
+}
+
+/*!
+* Implementation of Client::read(buffer, size) \n
+* @param buffer The buffer to copy the bytes received into.
+* @param size The size of `buffer`.
+* @return The number of bytes copied, or -1 if there are none available.
+*/
+int Sodaq_WifiBeeClient::read(uint8_t* buffer, size_t size)
+{
+  if ((_rxCount == 0) && (available() == 0)) {
+    return -1;
+  }
+
+  size_t count = 0;
+
+  while ((count < size) && (_rxCount > 0)) {
+    buffer[count++] = _rxBuffer[_rxHead];
+
+    _rxHead = (_rxHead + 1) % sizeof(_rxBuffer);
+    _rxCount--;
+  }
+
+  return count;
+}
+
+/*!
+* Implementation of Stream::peek() \n
+* @return The next byte received, or -1 if there is none available.
+*/
+int Sodaq_WifiBeeClient::peek()
+{
+  if ((_rxCount == 0) && (available() == 0)) {
+    return -1;
+  }
+
+  return _rxBuffer[_rxHead];
+}
+
+/*!
+* Implementation of Stream::flush() \n
+* It sends any buffered bytes and waits until all of them have been sent.
+*/
+void Sodaq_WifiBeeClient::flush()
+{
+  sendBuffer();
+
+  if (select()) {
+    _bee->flushTCP();
+  }
+}
+
+/*!
+* Implementation of Client::stop() \n
+* It sends any buffered bytes, then closes the connection and applies
+* the WifiBee's power policy. Any received bytes not read are dropped.
+*/
+void Sodaq_WifiBeeClient::stop()
+{
+  sendBuffer();
+
+  if (select()) {
+    _bee->closeTCP();
+  }
+
+  _rxCount = 0;
+  _rxMore = false;
+}
+
+/*!
+* Implementation of Client::connected() \n
+* @return 1 if the connection is open, or there is received data which
+* has not been read yet, otherwise 0.
+*/
+uint8_t Sodaq_WifiBeeClient::connected()
+{
+  if (_rxCount > 0) {
+    return 1;
+  }
+
+  if (!select()) {
+    return 0;
+  }
+
+  bool open = _bee->pollConnection(_rxMore);
+
+  return ((open) || (_rxMore)) ? 1 : 0;
+}
+
+/*!
+* Implementation of Client::operator bool() \n
+* @return `true` if connected() returns 1, otherwise `false`.
+*/
+Sodaq_WifiBeeClient::operator bool()
+{
+  return (connected() == 1);
+}
+
+/*!
+* This method selects the client's connection on the WifiBee.
+* @return `true` if it is selected, otherwise `false`.
+*/
+bool Sodaq_WifiBeeClient::select()
+{
+  return _bee->selectConnection(_handle);
+}
+
+/*!
+* This method streams the buffered bytes, if any, to the server.
+* It only waits for them to be sent once the WifiBee's send window is full.
+* @return `true` if there were none or they were queued, otherwise `false`.
+*/
+bool Sodaq_WifiBeeClient::sendBuffer()
+{
+  if (_txUsed == 0) {
+    return true;
+  }
+
+  bool result = (select()) && (_bee->streamTCPBinary(_txBuffer, _txUsed));
+  _txUsed = 0;
+
+  return result;
+}
+
+/*!
+* This method reads back received data into the free space at the end of
+* the receive buffer. It only costs a round-trip once data has been
+* reported received, or every POLL_INTERVAL while the buffer is empty.
+*/
+void Sodaq_WifiBeeClient::fillBuffer()
+{
+  // A request goes out before its response is waited for
+  sendBuffer();
+
+  if (!select()) {
+    return;
+  }
+
+  _bee->pollConnection(_rxMore);
+
+  if ((!_rxMore) && ((_rxCount > 0) || ((millis() - _pollTS) < POLL_INTERVAL))) {
+    return;
+  }
+  _pollTS = millis();
+
+  if (_rxCount == 0) {
+    _rxHead = 0;
+  }
+
+  // Only the contiguous free space is filled
+  size_t tail = (_rxHead + _rxCount) % sizeof(_rxBuffer);
+  size_t space = (tail < _rxHead) ? (_rxHead - tail) : (sizeof(_rxBuffer) - tail);
+  size_t bytesRead = 0;
+
+  if ((_bee->readBackResponse(space)) &&
+    (_bee->readResponseBinary(&_rxBuffer[tail], space, bytesRead))) {
+    _rxCount += bytesRead;
+  }
+
+  // A full chunk may have left more data queued
+  _rxMore = (bytesRead == space);
+}
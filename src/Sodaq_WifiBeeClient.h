@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SODAQ_WIFI_BEE_CLIENT_H_
+#define SODAQ_WIFI_BEE_CLIENT_H_
+
+#include <Arduino.h>
+#include <Client.h>
+#include <IPAddress.h>
+#include "Sodaq_WifiBee.h"
+
+/*!
+ * \def WIFIBEE_CLIENT_TX_SIZE
+ *
+ * The size of the client's send buffer. The bytes written are collected
+ * in it and uploaded as one payload once it is full, or once a response
+ * is waited for. It can be changed with a compiler flag.
+ */
+#ifndef WIFIBEE_CLIENT_TX_SIZE
+#define WIFIBEE_CLIENT_TX_SIZE           128
+#endif
+
+/*!
+ * \def WIFIBEE_CLIENT_RX_SIZE
+ *
+ * The size of the client's receive ring buffer. The received data is read
+ * back from the NodeMCU in chunks of up to this size. It can be changed
+ * with a compiler flag.
+ */
+#ifndef WIFIBEE_CLIENT_RX_SIZE
+#define WIFIBEE_CLIENT_RX_SIZE           128
+#endif
+
+/*!
+ * \brief This class provides the Arduino Client interface over a TCP
+ * connection of a Sodaq_WifiBee.
+ *
+ * It lets libraries written for a Client, e.g. MQTT clients, use the
+ * WifiBee. Each client uses one connection handle. The bytes written are
+ * coalesced into payloads which are streamed to the NodeMCU, and the
+ * bytes read are served from a buffer which is filled by reading back
+ * chunks of the received data, so a byte at a time protocol doesn't cost
+ * a UART round-trip per byte.
+ */
+class Sodaq_WifiBeeClient : public Client
+{
+public:
+  Sodaq_WifiBeeClient(Sodaq_WifiBee& bee, const uint8_t handle = 0);
+
+  // Client implementations
+  int connect(IPAddress ip, uint16_t port);
+
+  int connect(const char* host, uint16_t port);
+
+  size_t write(uint8_t x);
+
+  size_t write(const uint8_t* buffer, size_t size);
+
+  using Print::write;
+
+  int available();
+
+  int read();
+
+  int read(uint8_t* buffer, size_t size);
+
+  int peek();
+
+  void flush();
+
+  void stop();
+
+  uint8_t connected();
+
+  operator bool();
+
+private:
+  Sodaq_WifiBee* _bee;  /*!< The WifiBee the connection is on. */
+  uint8_t _handle;  /*!< The handle of the connection. */
+
+  uint8_t _txBuffer[WIFIBEE_CLIENT_TX_SIZE];  /*!< The bytes written which have not been sent yet. */
+  size_t _txUsed;  /*!< The number of bytes in `_txBuffer`. */
+
+  uint8_t _rxBuffer[WIFIBEE_CLIENT_RX_SIZE];  /*!< The ring buffer of bytes read back but not yet read. */
+  size_t _rxHead;  /*!< The index of the next byte to read in `_rxBuffer`. */
+  size_t _rxCount;  /*!< The number of bytes in `_rxBuffer`. */
+  bool _rxMore;  /*!< Set if more received data may be queued on the NodeMCU. */
+  uint32_t _pollTS;  /*!< The timestamp of the last read back. */
+
+  bool select();
+
+  bool sendBuffer();
+
+  void fillBuffer();
+};
+
+#endif // SODAQ_WIFI_BEE_CLIENT_H_
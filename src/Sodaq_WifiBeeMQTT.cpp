@@ -0,0 +1,498 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#include "Sodaq_WifiBeeMQTT.h"
+
+// MQTT 3.1.1 control packet types, in the upper nibble of the first byte
+#define MQTT_CONNECT 0x10
+#define MQTT_CONNACK 0x20
+#define MQTT_PUBLISH 0x30
+#define MQTT_PUBACK 0x40
+#define MQTT_PINGREQ 0xC0
+#define MQTT_PINGRESP 0xD0
+#define MQTT_DISCONNECT 0xE0
+
+#define MQTT_PROTOCOL "MQTT"
+#define MQTT_PROTOCOL_LEVEL 4
+#define MQTT_CLEAN_SESSION 0x02
+#define MQTT_PASSWORD_FLAG 0x40
+#define MQTT_USERNAME_FLAG 0x80
+#define MQTT_QOS_SHIFT 1
+#define MQTT_RETAIN 0x01
+#define MQTT_MAX_LENGTH 268435455 // The largest remaining length which can be encoded
+#define MQTT_MAX_STRING 65535 // The longest string which can be encoded
+
+// The time in ms to wait between reads while waiting for a packet
+#define IDLE_DELAY 1
+
+// Timeouts
+#define ACK_TIMEOUT 10000 // For a CONNACK or PUBACK
+#define PACKET_TIMEOUT 2000 // For the rest of a packet once its first byte is received
+
+/*!
+* Initialises member variables to default values.
+* @param bee The WifiBee to use, it must have been initialised.
+* @param handle The connection handle to use, see
+* Sodaq_WifiBee::selectConnection().
+*/
+Sodaq_WifiBeeMQTT::Sodaq_WifiBeeMQTT(Sodaq_WifiBee& bee, const uint8_t handle) :
+  _client(bee, handle)
+{
+  _host = NULL;
+  _port = 1883;
+  _keepAlive = WIFIBEE_MQTT_DEFAULT_KEEP_ALIVE;
+
+  _connected = false;
+  _nextPacketId = 1;
+  _inFlightCount = 0;
+  _sendTS = 0;
+  _pingTS = 0;
+  _pingPending = false;
+}
+
+/*!
+* Sets the broker to connect to.
+* @param host The broker's host (IP address or domain), it is not copied.
+* @param port The broker's port, normally 1883.
+*/
+void Sodaq_WifiBeeMQTT::setServer(const char* host, const uint16_t port)
+{
+  _host = host;
+  _port = port;
+}
+
+/*!
+* Sets the keep alive interval, it applies from the next connect().
+* A ping request is sent once nothing has been sent for this long.
+* @param seconds The interval in seconds, 0 disables the keep alive.
+*/
+void Sodaq_WifiBeeMQTT::setKeepAlive(const uint16_t seconds)
+{
+  _keepAlive = seconds;
+}
+
+/*!
+* Opens the TCP connection and a clean MQTT session. \n
+* It switches the WifiBee on and joins the network if needed.
+* @param clientId The client identifier.
+* @param username The user name, or NULL for none.
+* @param password The password, or NULL for none. It requires a user name.
+* @return `true` if the broker accepted the session, otherwise `false`.
+*/
+bool Sodaq_WifiBeeMQTT::connect(const char* clientId, const char* username,
+  const char* password)
+{
+  if (_connected) {
+    disconnect();
+  }
+
+  _inFlightCount = 0;
+  _pingPending = false;
+
+  if ((!_host) || (!username && password)) {
+    return false;
+  }
+
+  if (!_client.connect(_host, _port)) {
+    return false;
+  }
+
+  uint8_t flags = MQTT_CLEAN_SESSION;
+  size_t length = 2 + strlen(MQTT_PROTOCOL) + 4 + 2 + strlen(clientId);
+
+  if (username) {
+    flags |= MQTT_USERNAME_FLAG;
+    length += 2 + strlen(username);
+  }
+
+  if (password) {
+    flags |= MQTT_PASSWORD_FLAG;
+    length += 2 + strlen(password);
+  }
+
+  const uint8_t level[2] = { MQTT_PROTOCOL_LEVEL, flags };
+
+  bool result = (writeHeader(MQTT_CONNECT, length)) &&
+    (writeString(MQTT_PROTOCOL)) &&
+    (_client.write(level, sizeof(level)) == sizeof(level)) &&
+    (writeId(_keepAlive)) &&
+    (writeString(clientId)) &&
+    ((!username) || (writeString(username))) &&
+    ((!password) || (writeString(password)));
+
+  // The CONNACK sets _connected if the session was accepted
+  if ((!result) || (readPacket(ACK_TIMEOUT) != MQTT_CONNACK) || (!_connected)) {
+    connectionLost();
+    return false;
+  }
+
+  return true;
+}
+
+/*!
+* Publishes a message. \n
+* The packet is buffered with those published after it and sent once the
+* buffer is full, or by the next loop() or flush(). A QoS 1 message waits
+* for an acknowledgement first if WIFIBEE_MQTT_IN_FLIGHT are outstanding.
+* If a packet can't be written in full the session is closed, as the
+* broker would misread what follows it.
+* @param topic The topic to publish to, at most 65535 bytes.
+* @param payload The message.
+* @param length The size of `payload`.
+* @param qos The quality of service, 0 or 1.
+* @param retain If set the broker retains the message for new subscribers.
+* @return `true` if the message was sent or buffered, otherwise `false`.
+*/
+bool Sodaq_WifiBeeMQTT::publish(const char* topic, const uint8_t* payload,
+  const size_t length, const uint8_t qos, const bool retain)
+{
+  size_t topicLength = strlen(topic);
+  size_t packetLength = 2 + topicLength + ((qos == 1) ? 2 : 0) + length;
+
+  // Nothing is written unless the whole packet can be encoded
+  if ((!_connected) || (qos > 1) || (topicLength > MQTT_MAX_STRING) ||
+    (packetLength > MQTT_MAX_LENGTH)) {
+    return false;
+  }
+
+  if ((qos == 1) && (!waitForAcks(WIFIBEE_MQTT_IN_FLIGHT - 1))) {
+    return false;
+  }
+
+  uint8_t type = MQTT_PUBLISH | (qos << MQTT_QOS_SHIFT) | (retain ? MQTT_RETAIN : 0);
+  uint16_t id = 0;
+
+  if (qos == 1) {
+    id = _nextPacketId++;
+    if (_nextPacketId == 0) {
+      _nextPacketId = 1;
+    }
+  }
+
+  bool result = (writeHeader(type, packetLength)) &&
+    (writeString(topic)) &&
+    ((qos == 0) || (writeId(id))) &&
+    (_client.write(payload, length) == length);
+
+  // The part already sent can't be taken back, so the connection is closed
+  if (!result) {
+    connectionLost();
+    return false;
+  }
+
+  if (qos == 1) {
+    _inFlight[_inFlightCount++] = id;
+  }
+
+  return true;
+}
+
+/*!
+* Publishes a message, see publish(topic, payload, length, qos, retain).
+* @param topic The topic to publish to.
+* @param payload The message, a '\0' terminated string.
+* @param qos The quality of service, 0 or 1.
+* @param retain If set the broker retains the message for new subscribers.
+* @return `true` if the message was sent or buffered, otherwise `false`.
+*/
+bool Sodaq_WifiBeeMQTT::publish(const char* topic, const char* payload,
+  const uint8_t qos, const bool retain)
+{
+  return publish(topic, (const uint8_t*)payload, strlen(payload), qos, retain);
+}
+
+/*!
+* Services the session, it should be called regularly. \n
+* It sends any buffered packets, handles the acknowledgements received
+* and sends a ping request when the keep alive interval has elapsed.
+* It doesn't wait for any acknowledgement or ping response.
+* @return `true` if the session is still open, otherwise `false`.
+*/
+bool Sodaq_WifiBeeMQTT::loop()
+{
+  if (!_connected) {
+    return false;
+  }
+
+  // Any buffered packets are sent before checking for received data
+  while (_client.available() > 0) {
+    if (readPacket(0) < 0) {
+      connectionLost();
+      return false;
+    }
+  }
+
+  uint32_t interval = (uint32_t)_keepAlive * 1000;
+
+  if (_pingPending) {
+    if ((millis() - _pingTS) >= interval) {
+      connectionLost();
+      return false;
+    }
+  }
+  else if ((interval > 0) && ((millis() - _sendTS) >= interval)) {
+    if (!writeHeader(MQTT_PINGREQ, 0)) {
+      connectionLost();
+      return false;
+    }
+
+    _client.flush();
+    _pingPending = true;
+    _pingTS = millis();
+  }
+
+  return isConnected();
+}
+
+/*!
+* Sends any buffered packets and waits for all QoS 1 messages to be
+* acknowledged.
+* @return `true` if they were, otherwise `false`.
+*/
+bool Sodaq_WifiBeeMQTT::flush()
+{
+  if (!_connected) {
+    return false;
+  }
+
+  _client.flush();
+
+  return waitForAcks(0);
+}
+
+/*!
+* Closes the session and the TCP connection, after sending any buffered
+* packets. The WifiBee's power policy is then applied.
+* It doesn't wait for outstanding acknowledgements, see flush().
+*/
+void Sodaq_WifiBeeMQTT::disconnect()
+{
+  if (_connected) {
+    writeHeader(MQTT_DISCONNECT, 0);
+  }
+
+  connectionLost();
+}
+
+/*!
+* Checks whether the session is open.
+* @return `true` if it is, otherwise `false`.
+*/
+bool Sodaq_WifiBeeMQTT::isConnected()
+{
+  if ((_connected) && (!_client.connected())) {
+    connectionLost();
+  }
+
+  return _connected;
+}
+
+/*!
+* Returns the number of QoS 1 messages which have not been acknowledged.
+* After the session is lost these messages have not been delivered
+* with certainty, they are not resent.
+* @return The number of messages.
+*/
+uint8_t Sodaq_WifiBeeMQTT::getInFlight()
+{
+  return _inFlightCount;
+}
+
+/*!
+* This method writes a fixed header. \n
+* The remaining length is encoded with 7 bits per byte.
+* @param type The packet type and flags.
+* @param length The remaining length of the packet.
+* @return `true` if it was written, otherwise `false`.
+*/
+bool Sodaq_WifiBeeMQTT::writeHeader(const uint8_t type, const size_t length)
+{
+  if (length > MQTT_MAX_LENGTH) {
+    return false;
+  }
+
+  uint8_t header[5];
+  size_t count = 0;
+  size_t remaining = length;
+
+  header[count++] = type;
+  do {
+    header[count] = remaining & 0x7F;
+    remaining >>= 7;
+    if (remaining > 0) {
+      header[count] |= 0x80;
+    }
+    count++;
+  } while (remaining > 0);
+
+  _sendTS = millis();
+
+  return (_client.write(header, count) == count);
+}
+
+/*!
+* This method writes a string prefixed with its 16 bit length.
+* @param text The string to write, at most 65535 bytes.
+* @return `true` if it was written, otherwise `false`.
+*/
+bool Sodaq_WifiBeeMQTT::writeString(const char* text)
+{
+  size_t length = strlen(text);
+
+  return (length <= MQTT_MAX_STRING) &&
+    (writeId(length)) &&
+    (_client.write((const uint8_t*)text, length) == length);
+}
+
+/*!
+* This method writes a 16 bit value, most significant byte first.
+* @param id The value to write.
+* @return `true` if it was written, otherwise `false`.
+*/
+bool Sodaq_WifiBeeMQTT::writeId(const uint16_t id)
+{
+  const uint8_t bytes[2] = { (uint8_t)(id >> 8), (uint8_t)(id & 0xFF) };
+
+  return (_client.write(bytes, sizeof(bytes)) == sizeof(bytes));
+}
+
+/*!
+* This method reads one received byte. \n
+* It tries at least once and fails early if the connection is closed.
+* It waits IDLE_DELAY ms between tries.
+* @param x Is set to the byte read.
+* @param timeMS The time limit in ms.
+* @return `true` if a byte was read, otherwise `false`.
+*/
+bool Sodaq_WifiBeeMQTT::readByte(uint8_t& x, const uint32_t timeMS)
+{
+  uint32_t startTS = millis();
+
+  do {
+    int value = _client.read();
+    if (value >= 0) {
+      x = value;
+      return true;
+    }
+
+    if (!_client.connected()) {
+      return false;
+    }
+
+    delay(IDLE_DELAY);
+  } while ((millis() - startTS) < timeMS);
+
+  return false;
+}
+
+/*!
+* This method reads and handles one received packet. \n
+* A CONNACK sets `_connected`, a PUBACK removes the message from the
+* in-flight list and a PINGRESP clears the pending ping. The contents of
+* any other packet are skipped.
+* @param timeMS The time limit in ms for the packet to start.
+* @return The packet type, in the upper nibble, or -1 if none was read.
+*/
+int16_t Sodaq_WifiBeeMQTT::readPacket(const uint32_t timeMS)
+{
+  uint8_t type;
+  uint8_t x;
+  size_t length = 0;
+  uint8_t shift = 0;
+
+  if (!readByte(type, timeMS)) {
+    return -1;
+  }
+
+  do {
+    if ((shift > 21) || (!readByte(x, PACKET_TIMEOUT))) {
+      return -1;
+    }
+
+    length |= (size_t)(x & 0x7F) << shift;
+    shift += 7;
+  } while (x & 0x80);
+
+  // Only the first two bytes of the variable header are used
+  uint8_t body[2] = { 0, 0 };
+
+  for (size_t i = 0; i < length; i++) {
+    if (!readByte(x, PACKET_TIMEOUT)) {
+      return -1;
+    }
+
+    if (i < sizeof(body)) {
+      body[i] = x;
+    }
+  }
+
+  type &= 0xF0;
+
+  if (type == MQTT_CONNACK) {
+    // The return code follows the acknowledge flags
+    _connected = (length >= 2) && (body[1] == 0);
+  }
+  else if (type == MQTT_PUBACK) {
+    uint16_t id = ((uint16_t)body[0] << 8) | body[1];
+
+    for (uint8_t i = 0; i < _inFlightCount; i++) {
+      if (_inFlight[i] == id) {
+        _inFlight[i] = _inFlight[--_inFlightCount];
+        break;
+      }
+    }
+  }
+  else if (type == MQTT_PINGRESP) {
+    _pingPending = false;
+  }
+
+  return type;
+}
+
+/*!
+* This method handles received packets until no more than `limit`
+* QoS 1 messages are waiting to be acknowledged. \n
+* Each acknowledgement restarts the time limit.
+* @param limit The number of messages which may remain in flight.
+* @return `true` if successful, otherwise `false` and the session is closed.
+*/
+bool Sodaq_WifiBeeMQTT::waitForAcks(const uint8_t limit)
+{
+  while (_inFlightCount > limit) {
+    if (readPacket(ACK_TIMEOUT) < 0) {
+      connectionLost();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/*!
+* This method closes the TCP connection after the session has ended or
+* failed. Any buffered packets are sent first.
+*/
+void Sodaq_WifiBeeMQTT::connectionLost()
+{
+  _connected = false;
+  _pingPending = false;
+
+  _client.stop();
+}
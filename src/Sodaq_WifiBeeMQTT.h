@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SODAQ_WIFI_BEE_MQTT_H_
+#define SODAQ_WIFI_BEE_MQTT_H_
+
+#include <Arduino.h>
+#include "Sodaq_WifiBee.h"
+#include "Sodaq_WifiBeeClient.h"
+
+/*!
+ * \def WIFIBEE_MQTT_IN_FLIGHT
+ *
+ * The maximum number of QoS 1 messages which may be published before
+ * their acknowledgements have been received.
+ */
+#ifndef WIFIBEE_MQTT_IN_FLIGHT
+#define WIFIBEE_MQTT_IN_FLIGHT           8
+#endif
+
+/*!
+ * \def WIFIBEE_MQTT_DEFAULT_KEEP_ALIVE
+ *
+ * The default keep alive interval in seconds. It can be changed with
+ * setKeepAlive().
+ */
+#define WIFIBEE_MQTT_DEFAULT_KEEP_ALIVE  60
+
+/*!
+ * \brief This class publishes messages to an MQTT 3.1.1 broker over a
+ * TCP connection of a Sodaq_WifiBee.
+ *
+ * The session stays open across publishes. The packets are written to a
+ * Sodaq_WifiBeeClient, which coalesces them into payloads streamed to the
+ * NodeMCU. QoS 0 and 1 are supported, QoS 1 messages are not stored, so
+ * those not acknowledged when the connection is lost are not resent.
+ * Subscriptions are not supported.
+ */
+class Sodaq_WifiBeeMQTT
+{
+public:
+  Sodaq_WifiBeeMQTT(Sodaq_WifiBee& bee, const uint8_t handle = 0);
+
+  void setServer(const char* host, const uint16_t port);
+
+  void setKeepAlive(const uint16_t seconds);
+
+  bool connect(const char* clientId, const char* username = NULL,
+    const char* password = NULL);
+
+  bool publish(const char* topic, const uint8_t* payload, const size_t length,
+    const uint8_t qos = 0, const bool retain = false);
+
+  bool publish(const char* topic, const char* payload,
+    const uint8_t qos = 0, const bool retain = false);
+
+  bool loop();
+
+  bool flush();
+
+  void disconnect();
+
+  bool isConnected();
+
+  uint8_t getInFlight();
+
+private:
+  Sodaq_WifiBeeClient _client;  /*!< The client the packets are written to and read from. */
+
+  const char* _host;  /*!< The broker's host. */
+  uint16_t _port;  /*!< The broker's port. */
+  uint16_t _keepAlive;  /*!< The keep alive interval in seconds. */
+
+  bool _connected;  /*!< Set while the session is open. */
+  uint16_t _nextPacketId;  /*!< The packet identifier of the next QoS 1 message. */
+  uint16_t _inFlight[WIFIBEE_MQTT_IN_FLIGHT];  /*!< The packet identifiers of the unacknowledged QoS 1 messages. */
+  uint8_t _inFlightCount;  /*!< The number of entries in `_inFlight`. */
+  uint32_t _sendTS;  /*!< The timestamp of the last packet sent. */
+  uint32_t _pingTS;  /*!< The timestamp of the unanswered ping request, if any. */
+  bool _pingPending;  /*!< Set while a ping request has not been answered. */
+
+  bool writeHeader(const uint8_t type, const size_t length);
+
+  bool writeString(const char* text);
+
+  bool writeId(const uint16_t id);
+
+  bool readByte(uint8_t& x, const uint32_t timeMS);
+
+  int16_t readPacket(const uint32_t timeMS);
+
+  bool waitForAcks(const uint8_t limit);
+
+  void connectionLost();
+};
+
+#endif // SODAQ_WIFI_BEE_MQTT_H_
@@ -0,0 +1,328 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#include "Sodaq_WifiBeeQueue.h"
+
+#define RECORD_SEPARATOR '\n'
+#define LENGTH_PREFIX_SIZE 2
+
+/*!
+* Initialises member variables, the store starts empty.
+* @param buffer The buffer to keep the records in, it is not copied.
+* @param size The size of `buffer`. Each record takes its length plus 2 bytes.
+*/
+Sodaq_WifiBeeRAMStore::Sodaq_WifiBeeRAMStore(uint8_t* buffer, const size_t size)
+{
+  _buffer = buffer;
+  _size = size;
+  _head = 0;
+  _used = 0;
+  _count = 0;
+  _readIndex = 0;
+  _readOffset = 0;
+}
+
+// Sodaq_WifiBeeStore implementations
+/*!
+* Implementation of Sodaq_WifiBeeStore::append() \n
+* @param data The record.
+* @param length The size of `data`, at most 65535.
+* @return `true` if it was stored, `false` if there is no room.
+*/
+bool Sodaq_WifiBeeRAMStore::append(const uint8_t* data, const size_t length)
+{
+  if ((length > 0xFFFF) || ((length + LENGTH_PREFIX_SIZE) > (_size - _used))) {
+    return false;
+  }
+
+  size_t offset = wrap(_head + _used);
+
+  _buffer[offset] = length >> 8;
+  _buffer[wrap(offset + 1)] = length & 0xFF;
+  offset = wrap(offset + LENGTH_PREFIX_SIZE);
+
+  for (size_t i = 0; i < length; i++) {
+    _buffer[offset] = data[i];
+    offset = wrap(offset + 1);
+  }
+
+  _used += length + LENGTH_PREFIX_SIZE;
+  _count++;
+
+  return true;
+}
+
+/*!
+* Implementation of Sodaq_WifiBeeStore::count() \n
+* @return The number of records stored.
+*/
+size_t Sodaq_WifiBeeRAMStore::count()
+{
+  return _count;
+}
+
+/*!
+* Implementation of Sodaq_WifiBeeStore::read() \n
+* It continues from the record read last, if it is at or before `index`,
+* so reading the records in order doesn't scan from the oldest each time.
+* @param index The index of the record, 0 is the oldest.
+* @param buffer The buffer to copy the record into.
+* @param size The size of `buffer`.
+* @param length Is set to the length of the record.
+* @return `true` if the record was copied, `false` if it doesn't exist or
+* doesn't fit.
+*/
+bool Sodaq_WifiBeeRAMStore::read(const size_t index, uint8_t* buffer,
+  const size_t size, size_t& length)
+{
+  if (index >= _count) {
+    return false;
+  }
+
+  if (index < _readIndex) {
+    _readIndex = 0;
+    _readOffset = _head;
+  }
+
+  for (; _readIndex < index; _readIndex++) {
+    _readOffset = wrap(_readOffset + LENGTH_PREFIX_SIZE + recordLength(_readOffset));
+  }
+
+  size_t offset = _readOffset;
+
+  length = recordLength(offset);
+  if (length > size) {
+    return false;
+  }
+
+  offset = wrap(offset + LENGTH_PREFIX_SIZE);
+  for (size_t i = 0; i < length; i++) {
+    buffer[i] = _buffer[offset];
+    offset = wrap(offset + 1);
+  }
+
+  return true;
+}
+
+/*!
+* Implementation of Sodaq_WifiBeeStore::remove() \n
+* @param records The number of records to remove, from the oldest.
+* @return `true` if there were that many, otherwise `false` and all the
+* records are removed.
+*/
+bool Sodaq_WifiBeeRAMStore::remove(const size_t records)
+{
+  bool result = (records <= _count);
+
+  for (size_t i = 0; (i < records) && (_count > 0); i++) {
+    size_t consumed = LENGTH_PREFIX_SIZE + recordLength(_head);
+
+    _head = wrap(_head + consumed);
+    _used -= consumed;
+    _count--;
+  }
+
+  if (_count == 0) {
+    _head = 0;
+  }
+
+  _readIndex = 0;
+  _readOffset = _head;
+
+  return result;
+}
+
+/*!
+* This method reads the length prefix of a record.
+* @param offset The offset of the record in the ring buffer.
+* @return The length of the record, excluding the prefix.
+*/
+size_t Sodaq_WifiBeeRAMStore::recordLength(const size_t offset)
+{
+  return ((size_t)_buffer[offset] << 8) | _buffer[wrap(offset + 1)];
+}
+
+/*!
+* This method wraps an offset around the end of the ring buffer.
+* @param offset The offset, less than twice the size of the buffer.
+* @return The offset in the ring buffer.
+*/
+size_t Sodaq_WifiBeeRAMStore::wrap(const size_t offset)
+{
+  return (offset >= _size) ? (offset - _size) : offset;
+}
+
+/*!
+* Initialises member variables to default values.
+* @param bee The WifiBee to forward the records with, it must have been
+* initialised and its connection settings set.
+* @param store The store to keep the records in.
+*/
+Sodaq_WifiBeeQueue::Sodaq_WifiBeeQueue(Sodaq_WifiBee& bee, Sodaq_WifiBeeStore& store)
+{
+  _bee = &bee;
+  _store = &store;
+
+  _server = NULL;
+  _port = 80;
+  _URI = "/";
+  _headers = "";
+
+  _batch[0] = '\0';
+  _forwarded = 0;
+  _batches = 0;
+}
+
+/*!
+* Sets where the records are posted to. The strings are not copied.
+* @param server The server/host to connect to (IP address or domain).
+* @param port The port to connect to.
+* @param URI The resource location on the server/host.
+* @param headers Any additional headers, each must be followed by a CRLF.
+*/
+void Sodaq_WifiBeeQueue::setTarget(const char* server, const uint16_t port,
+  const char* URI, const char* headers)
+{
+  _server = server;
+  _port = port;
+  _URI = URI;
+  _headers = headers;
+}
+
+/*!
+* Adds a record to the store, the WifiBee isn't used.
+* @param record The record, it should not contain a LF.
+* @return `true` if it was stored, otherwise `false`. It will return
+* `false` if the store is full, or if the record is empty or too long to
+* fit in a batch.
+*/
+bool Sodaq_WifiBeeQueue::add(const char* record)
+{
+  size_t length = strlen(record);
+
+  // The record is followed by a separator and the body's '\0'
+  if ((length == 0) || (length > (sizeof(_batch) - 2))) {
+    return false;
+  }
+
+  return _store->append((const uint8_t*)record, length);
+}
+
+/*!
+* \overload
+*/
+bool Sodaq_WifiBeeQueue::add(const String& record)
+{
+  return add(record.c_str());
+}
+
+/*!
+* Returns the number of records waiting to be forwarded.
+* @return The number of records in the store.
+*/
+size_t Sodaq_WifiBeeQueue::getCount()
+{
+  return _store->count();
+}
+
+/*!
+* Forwards the stored records to the target set with setTarget(). \n
+* It opens an HTTP session, so the device is switched on and joins only
+* once, and posts the records in batches until the store is empty or a
+* request fails. The session is then closed and the power policy applied.
+* The records not accepted by the server remain stored for the next call.
+* @return `true` if all the records were forwarded, otherwise `false`.
+*/
+bool Sodaq_WifiBeeQueue::forward()
+{
+  _forwarded = 0;
+  _batches = 0;
+
+  if (_store->count() == 0) {
+    return true;
+  }
+
+  if ((!_server) || (!_bee->openHTTPSession(_server, _port))) {
+    return false;
+  }
+
+  bool result = true;
+
+  while ((result) && (_store->count() > 0)) {
+    size_t records = fillBatch();
+    uint16_t httpCode = 0;
+
+    result = (records > 0) &&
+      (_bee->HTTPPost(_server, _port, _URI, _headers, _batch, httpCode)) &&
+      (httpCode >= 200) && (httpCode < 300);
+
+    if (result) {
+      _store->remove(records);
+      _forwarded += records;
+      _batches++;
+    }
+  }
+
+  _bee->closeHTTPSession();
+
+  return result;
+}
+
+/*!
+* Returns the number of records forwarded by the last forward().
+* @return The number of records.
+*/
+size_t Sodaq_WifiBeeQueue::getForwarded()
+{
+  return _forwarded;
+}
+
+/*!
+* Returns the number of requests sent by the last forward().
+* @return The number of requests.
+*/
+size_t Sodaq_WifiBeeQueue::getBatches()
+{
+  return _batches;
+}
+
+/*!
+* This method collects the oldest records which fit in the batch buffer,
+* each followed by a separator.
+* @return The number of records in the batch.
+*/
+size_t Sodaq_WifiBeeQueue::fillBatch()
+{
+  size_t used = 0;
+  size_t records = 0;
+  size_t length;
+
+  // Room is kept for each record's separator and the '\0'
+  while ((records < _store->count()) && ((sizeof(_batch) - used) > 2) &&
+    (_store->read(records, (uint8_t*)&_batch[used], sizeof(_batch) - used - 2, length))) {
+    used += length;
+    _batch[used++] = RECORD_SEPARATOR;
+    records++;
+  }
+
+  _batch[used] = '\0';
+
+  return records;
+}
@@ -0,0 +1,121 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SODAQ_WIFI_BEE_QUEUE_H_
+#define SODAQ_WIFI_BEE_QUEUE_H_
+
+#include <Arduino.h>
+#include "Sodaq_WifiBee.h"
+#include "Sodaq_WifiBeeStore.h"
+
+/*!
+ * \def WIFIBEE_QUEUE_BATCH_SIZE
+ *
+ * The size of the queue's batch buffer. Each request's body is collected
+ * in it, so it limits the size of a batch and of a single record.
+ * It can be changed with a compiler flag.
+ */
+#ifndef WIFIBEE_QUEUE_BATCH_SIZE
+#define WIFIBEE_QUEUE_BATCH_SIZE         512
+#endif
+
+/*!
+ * \brief This class stores records in a RAM buffer supplied to it.
+ *
+ * The buffer is used as a ring, each record is prefixed with its 16 bit
+ * length. The records are lost on a reset.
+ */
+class Sodaq_WifiBeeRAMStore : public Sodaq_WifiBeeStore
+{
+public:
+  Sodaq_WifiBeeRAMStore(uint8_t* buffer, const size_t size);
+
+  // Sodaq_WifiBeeStore implementations
+  bool append(const uint8_t* data, const size_t length);
+
+  size_t count();
+
+  bool read(const size_t index, uint8_t* buffer, const size_t size,
+    size_t& length);
+
+  bool remove(const size_t records);
+
+private:
+  uint8_t* _buffer;  /*!< The ring buffer. */
+  size_t _size;  /*!< The size of `_buffer`. */
+  size_t _head;  /*!< The offset of the oldest record in `_buffer`. */
+  size_t _used;  /*!< The number of bytes used in `_buffer`. */
+  size_t _count;  /*!< The number of records stored. */
+  size_t _readIndex;  /*!< The index of the record at `_readOffset`. */
+  size_t _readOffset;  /*!< The offset of a record in `_buffer`, where read() continues. */
+
+  size_t recordLength(const size_t offset);
+
+  size_t wrap(const size_t offset);
+};
+
+/*!
+ * \brief This class queues telemetry records and forwards them in batches.
+ *
+ * Records are added to a Sodaq_WifiBeeStore without using the WifiBee, so
+ * it doesn't matter whether the network is available. forward() then
+ * switches the device on and joins once, and drains the backlog as a few
+ * HTTP POST requests on one HTTP session. Each request's body holds as
+ * many records as fit in WIFIBEE_QUEUE_BATCH_SIZE, each followed by a LF.
+ * The records are only removed from the store once the server has
+ * accepted them (HTTP 2xx).
+ */
+class Sodaq_WifiBeeQueue
+{
+public:
+  Sodaq_WifiBeeQueue(Sodaq_WifiBee& bee, Sodaq_WifiBeeStore& store);
+
+  void setTarget(const char* server, const uint16_t port, const char* URI,
+    const char* headers = "");
+
+  bool add(const char* record);
+
+  bool add(const String& record);
+
+  size_t getCount();
+
+  bool forward();
+
+  size_t getForwarded();
+
+  size_t getBatches();
+
+private:
+  Sodaq_WifiBee* _bee;  /*!< The WifiBee the records are forwarded with. */
+  Sodaq_WifiBeeStore* _store;  /*!< The store the records are kept in. */
+
+  const char* _server;  /*!< The server the records are posted to. */
+  uint16_t _port;  /*!< The server's port. */
+  const char* _URI;  /*!< The resource the records are posted to. */
+  const char* _headers;  /*!< Any additional headers, each followed by a CRLF. */
+
+  char _batch[WIFIBEE_QUEUE_BATCH_SIZE];  /*!< The body of the next request. */
+  size_t _forwarded;  /*!< The number of records forwarded by the last forward(). */
+  size_t _batches;  /*!< The number of requests sent by the last forward(). */
+
+  size_t fillBatch();
+};
+
+#endif // SODAQ_WIFI_BEE_QUEUE_H_
@@ -0,0 +1,68 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SODAQ_WIFI_BEE_STORE_H_
+#define SODAQ_WIFI_BEE_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * \brief This class is the interface through which a Sodaq_WifiBeeQueue
+ * keeps its records.
+ *
+ * Sodaq_WifiBeeRAMStore keeps the records in a RAM buffer. A store which
+ * implements the same methods on flash or an SD card keeps them across a
+ * reset. The records are kept in the order they were appended and are
+ * removed from the front.
+ */
+class Sodaq_WifiBeeStore
+{
+public:
+  virtual ~Sodaq_WifiBeeStore() {}
+
+  /*!
+   * Appends a record.
+   * @return `true` if it was stored, `false` if there is no room.
+   */
+  virtual bool append(const uint8_t* data, const size_t length) = 0;
+
+  /*!
+   * @return The number of records stored.
+   */
+  virtual size_t count() = 0;
+
+  /*!
+   * Copies the record at `index`, counted from the oldest, into `buffer`.
+   * The queue reads the records in order, from index 0.
+   * @param length Is set to the length of the record.
+   * @return `true` if it fits in `size` bytes, otherwise `false`.
+   */
+  virtual bool read(const size_t index, uint8_t* buffer, const size_t size,
+    size_t& length) = 0;
+
+  /*!
+   * Removes the `records` oldest records.
+   * @return `true` if there were that many, otherwise `false`.
+   */
+  virtual bool remove(const size_t records) = 0;
+};
+
+#endif // SODAQ_WIFI_BEE_STORE_H_
@@ -0,0 +1,441 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#include "Sodaq_WifiBeeTranscript.h"
+
+// The header at the start of a transcript, with the format's version
+#define TRANSCRIPT_HEADER "WBT1"
+#define TRANSCRIPT_HEADER_LENGTH 4
+
+// The direction bit and the length bits of a record's header byte
+#define RECORD_WRITE_FLAG 0x80
+#define RECORD_LENGTH_MASK 0x7F
+
+// The bits of each byte of a record's time delta
+#define DELTA_MORE_FLAG 0x80
+#define DELTA_VALUE_MASK 0x7F
+
+/*!
+* Initialises member variables to default values,
+* including any pointers to NULL.
+*/
+Sodaq_WifiBeeRecorder::Sodaq_WifiBeeRecorder()
+{
+  _device = NULL;
+  _log = NULL;
+
+  _recordUsed = 0;
+  _recordWrite = false;
+  _recordTS = 0;
+  _lastTS = 0;
+}
+
+/*!
+* This method starts a recording.
+* @param device The device's stream, which all calls are passed on to.
+* @param log The log to write the transcript to, e.g. an SD card file.
+*/
+void Sodaq_WifiBeeRecorder::begin(Stream& device, Print& log)
+{
+  _device = &device;
+  _log = &log;
+
+  _recordUsed = 0;
+  _lastTS = millis();
+
+  _log->print(TRANSCRIPT_HEADER);
+}
+
+/*!
+* This method ends the recording. It writes the last record to the log,
+* the log itself should be flushed or closed afterwards.
+* The calls are still passed on to the device.
+*/
+void Sodaq_WifiBeeRecorder::end()
+{
+  writeRecord();
+  _log = NULL;
+}
+
+/*!
+* This method adds bytes to the transcript. The current record is written
+* to the log first if the bytes don't belong in it.
+* @param isWrite `true` for bytes written to the device, `false` for bytes read.
+* @param data The bytes.
+* @param length The number of bytes.
+*/
+void Sodaq_WifiBeeRecorder::record(const bool isWrite, const uint8_t* data, size_t length)
+{
+  if (!_log) {
+    return;
+  }
+
+  uint32_t nowTS = millis();
+
+  if ((_recordUsed > 0) && ((_recordWrite != isWrite) || (_recordTS != nowTS))) {
+    writeRecord();
+  }
+
+  while (length > 0) {
+    if (_recordUsed == 0) {
+      _recordWrite = isWrite;
+      _recordTS = nowTS;
+    }
+
+    size_t count = sizeof(_record) - _recordUsed;
+    if (count > length) {
+      count = length;
+    }
+
+    memcpy(&_record[_recordUsed], data, count);
+    _recordUsed += count;
+    data += count;
+    length -= count;
+
+    if (_recordUsed == sizeof(_record)) {
+      writeRecord();
+    }
+  }
+}
+
+/*!
+* This method writes the current record, if any, to the log.
+*/
+void Sodaq_WifiBeeRecorder::writeRecord()
+{
+  if ((!_log) || (_recordUsed == 0)) {
+    return;
+  }
+
+  _log->write((uint8_t)((_recordWrite ? RECORD_WRITE_FLAG : 0) | (_recordUsed - 1)));
+
+  uint32_t delta = _recordTS - _lastTS;
+  while (delta > DELTA_VALUE_MASK) {
+    _log->write((uint8_t)(DELTA_MORE_FLAG | (delta & DELTA_VALUE_MASK)));
+    delta >>= 7;
+  }
+  _log->write((uint8_t)delta);
+
+  _log->write(_record, _recordUsed);
+
+  _lastTS = _recordTS;
+  _recordUsed = 0;
+}
+
+// Stream implementations
+/*!
+* Implementation of Stream::write(x) \n
+* It records `x` and passes it on to the device.
+* @param x The byte to write.
+* @return result of `_device->write(x)` or 0 if there is no device.
+*/
+size_t Sodaq_WifiBeeRecorder::write(uint8_t x)
+{
+  return write(&x, 1);
+}
+
+/*!
+* Implementation of Print::write(buffer, size) \n
+* It records the bytes written to the device.
+* @param buffer The bytes to write.
+* @param size The size of `buffer`.
+* @return result of `_device->write(buffer, size)` or 0 if there is no device.
+*/
+size_t Sodaq_WifiBeeRecorder::write(const uint8_t* buffer, size_t size)
+{
+  if (!_device) {
+    return 0;
+  }
+
+  size_t count = _device->write(buffer, size);
+  record(true, buffer, count);
+
+  return count;
+}
+
+/*!
+* Implementation of Stream::available() \n
+* @return result of `_device->available()` or 0 if there is no device.
+*/
+int Sodaq_WifiBeeRecorder::available()
+{
+  return _device ? _device->available() : 0;
+}
+
+/*!
+* Implementation of Stream::peek() \n
+* Peeked bytes are recorded once they are read.
+* @return result of `_device->peek()` or -1 if there is no device.
+*/
+int Sodaq_WifiBeeRecorder::peek()
+{
+  return _device ? _device->peek() : -1;
+}
+
+/*!
+* Implementation of Stream::read() \n
+* It records the byte read from the device.
+* @return result of `_device->read()` or -1 if there is no device.
+*/
+int Sodaq_WifiBeeRecorder::read()
+{
+  if (!_device) {
+    return -1;
+  }
+
+  int c = _device->read();
+  if (c >= 0) {
+    uint8_t data = c;
+    record(false, &data, 1);
+  }
+
+  return c;
+}
+
+/*!
+* Implementation of Stream::flush() \n
+* It calls `_device->flush()`, the log isn't flushed.
+*/
+void Sodaq_WifiBeeRecorder::flush()
+{
+  if (_device) {
+    _device->flush();
+  }
+}
+
+/*!
+* Initialises member variables to default values,
+* including any pointers to NULL.
+*/
+Sodaq_WifiBeeReplay::Sodaq_WifiBeeReplay()
+{
+  _log = NULL;
+  _speedUp = 1;
+
+  _recordWrite = false;
+  _recordRemaining = 0;
+  _recordTime = 0;
+  _anchorTime = 0;
+  _anchorTS = 0;
+
+  _finished = true;
+  _mismatches = 0;
+}
+
+/*!
+* This method starts a replay.
+* @param log The log to read the transcript from. All of it must be
+* readable without waiting, e.g. an SD card file.
+* @param speedUp The factor by which the recorded timing is shortened,
+* 1 for the original timing, 0 to replay without any delays.
+* @return `true` if the log starts with a transcript header, otherwise `false`.
+*/
+bool Sodaq_WifiBeeReplay::begin(Stream& log, const uint8_t speedUp)
+{
+  _log = &log;
+  _speedUp = speedUp;
+
+  _recordRemaining = 0;
+  _recordTime = 0;
+  _anchorTime = 0;
+  _anchorTS = millis();
+
+  _finished = false;
+  _mismatches = 0;
+
+  for (size_t i = 0; i < TRANSCRIPT_HEADER_LENGTH; i++) {
+    if (_log->read() != TRANSCRIPT_HEADER[i]) {
+      _finished = true;
+    }
+  }
+
+  return !_finished;
+}
+
+/*!
+* This method checks if the whole transcript has been replayed.
+* @return `true` if the end of the transcript has been reached, otherwise `false`.
+*/
+bool Sodaq_WifiBeeReplay::isFinished()
+{
+  if ((_recordRemaining == 0) && (!_finished)) {
+    nextRecord();
+  }
+
+  return _finished;
+}
+
+/*!
+* This method returns the number of bytes written which differ from
+* the recording, including those written after its end.
+* @return The number of mismatches.
+*/
+uint32_t Sodaq_WifiBeeReplay::getMismatches()
+{
+  return _mismatches;
+}
+
+/*!
+* This method reads the header of the next record from the log.
+* @return `true` if there is another record, otherwise `false`.
+*/
+bool Sodaq_WifiBeeReplay::nextRecord()
+{
+  if (_finished) {
+    return false;
+  }
+
+  int header = _log->read();
+
+  uint32_t delta = 0;
+  uint8_t shift = 0;
+  int value;
+
+  do {
+    value = _log->read();
+    if ((header < 0) || (value < 0)) {
+      _finished = true;
+      return false;
+    }
+
+    delta |= (uint32_t)(value & DELTA_VALUE_MASK) << shift;
+    shift += 7;
+  } while (value & DELTA_MORE_FLAG);
+
+  _recordWrite = (header & RECORD_WRITE_FLAG);
+  _recordRemaining = (header & RECORD_LENGTH_MASK) + 1;
+  _recordTime += delta;
+
+  return true;
+}
+
+/*!
+* This method returns the time until the current record is due, compared
+* to the time the replay was last anchored.
+* @return The time in milliseconds, 0 if it may be replayed now.
+*/
+uint32_t Sodaq_WifiBeeReplay::timeUntilDue()
+{
+  if (_speedUp == 0) {
+    return 0;
+  }
+
+  uint32_t elapsed = millis() - _anchorTS;
+  uint32_t due = (_recordTime - _anchorTime) / _speedUp;
+
+  return (elapsed < due) ? (due - elapsed) : 0;
+}
+
+// Stream implementations
+/*!
+* Implementation of Stream::write(x) \n
+* It compares `x` with the next recorded byte written to the device.
+* Any recorded bytes read from the device before it are dropped.
+* Each write record takes its recorded time, e.g. that of the UART, by
+* waiting until it is due. A late one anchors the timing of the records
+* which follow it.
+* @param x The byte written.
+* @return 1, the byte is always accepted.
+*/
+size_t Sodaq_WifiBeeReplay::write(uint8_t x)
+{
+  if (!_log) {
+    return 0;
+  }
+
+  while ((_recordRemaining == 0) || (!_recordWrite)) {
+    while (_recordRemaining > 0) {
+      _log->read();
+      _recordRemaining--;
+    }
+
+    if (!nextRecord()) {
+      _mismatches++;
+      return 1;
+    }
+
+    if (_recordWrite) {
+      uint32_t wait = timeUntilDue();
+
+      if (wait > 0) {
+        delay(wait);
+      }
+      else {
+        _anchorTime = _recordTime;
+        _anchorTS = millis();
+      }
+    }
+  }
+
+  if (_log->read() != x) {
+    _mismatches++;
+  }
+  _recordRemaining--;
+
+  return 1;
+}
+
+/*!
+* Implementation of Stream::available() \n
+* @return The number of recorded bytes of the current record which can
+* be read now, 0 if it isn't due yet or if it holds bytes written.
+*/
+int Sodaq_WifiBeeReplay::available()
+{
+  if ((!_log) || ((_recordRemaining == 0) && (!nextRecord()))) {
+    return 0;
+  }
+
+  return ((!_recordWrite) && (timeUntilDue() == 0)) ? _recordRemaining : 0;
+}
+
+/*!
+* Implementation of Stream::peek() \n
+* @return The next recorded byte read from the device, or -1 if there
+* is none available.
+*/
+int Sodaq_WifiBeeReplay::peek()
+{
+  return available() ? _log->peek() : -1;
+}
+
+/*!
+* Implementation of Stream::read() \n
+* @return The next recorded byte read from the device, or -1 if there
+* is none available.
+*/
+int Sodaq_WifiBeeReplay::read()
+{
+  if (!available()) {
+    return -1;
+  }
+
+  _recordRemaining--;
+
+  return _log->read();
+}
+
+/*!
+* Implementation of Stream::flush() \n
+* There is nothing to flush.
+*/
+void Sodaq_WifiBeeReplay::flush()
+{
+}
@@ -0,0 +1,141 @@
+/*
+* Copyright (c) 2015 Gabriel Notman & M2M4ALL BV.  All rights reserved.
+*
+* This file is part of Sodaq_WifiBee.
+*
+* Sodaq_WifiBee is free software: you can redistribute it and/or modify
+* it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation, either version 3 of
+* the License, or(at your option) any later version.
+*
+* Sodaq_WifiBee is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU Lesser General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public
+* License along with GPRSbee.  If not, see
+* <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SODAQ_WIFI_BEE_TRANSCRIPT_H_
+#define SODAQ_WIFI_BEE_TRANSCRIPT_H_
+
+#include <Arduino.h>
+#include <Stream.h>
+
+/*!
+ * \def WIFIBEE_TRANSCRIPT_RECORD_SIZE
+ *
+ * The maximum number of data bytes in one transcript record.
+ * It is limited to 128 by the record's header byte.
+ */
+#define WIFIBEE_TRANSCRIPT_RECORD_SIZE   128
+
+/*!
+ * \brief This class records the bytes exchanged with the WifiBee.
+ *
+ * It is passed to Sodaq_WifiBee::init() in place of the device's stream,
+ * and passes everything on to the device. The bytes written and read are
+ * written to the log, with their timing, in a compact binary transcript:
+ *
+ * A 4 byte header "WBT1", followed by records of:
+ * - A header byte, bit 7 set for bytes written to the device, clear for
+ *   bytes read from it, bits 0-6 the number of data bytes minus one.
+ * - The milliseconds since the previous record, 7 bits per byte,
+ *   least significant first, bit 7 set if more bytes follow.
+ * - The data bytes.
+ *
+ * Consecutive bytes in the same direction and millisecond share a record.
+ */
+class Sodaq_WifiBeeRecorder : public Stream
+{
+public:
+  Sodaq_WifiBeeRecorder();
+
+  void begin(Stream& device, Print& log);
+
+  void end();
+
+  // Stream implementations
+  size_t write(uint8_t x);
+
+  size_t write(const uint8_t* buffer, size_t size);
+
+  using Print::write;
+
+  int available();
+
+  int peek();
+
+  int read();
+
+  void flush();
+
+private:
+  Stream* _device;  /*!< The device's stream. */
+  Print* _log;  /*!< The log the transcript is written to, NULL if not recording. */
+
+  uint8_t _record[WIFIBEE_TRANSCRIPT_RECORD_SIZE];  /*!< The data of the record being collected. */
+  uint8_t _recordUsed;  /*!< The number of bytes in `_record`. */
+  bool _recordWrite;  /*!< `true` if the record holds bytes written to the device. */
+  uint32_t _recordTS;  /*!< The timestamp of the record's first byte. */
+  uint32_t _lastTS;  /*!< The timestamp of the previous record written to the log. */
+
+  void record(const bool isWrite, const uint8_t* data, size_t length);
+
+  void writeRecord();
+};
+
+/*!
+ * \brief This class replays the device's side of a recorded transcript.
+ *
+ * It is passed to Sodaq_WifiBee::init() in place of the device's stream.
+ * The recorded bytes are returned by read(), and the bytes written are
+ * accepted, with their original timing or faster. The bytes written
+ * are compared with the recorded ones, any difference is counted.
+ * Recorded data which isn't read before the next write is dropped.
+ */
+class Sodaq_WifiBeeReplay : public Stream
+{
+public:
+  Sodaq_WifiBeeReplay();
+
+  bool begin(Stream& log, const uint8_t speedUp = 1);
+
+  bool isFinished();
+
+  uint32_t getMismatches();
+
+  // Stream implementations
+  size_t write(uint8_t x);
+
+  using Print::write;
+
+  int available();
+
+  int peek();
+
+  int read();
+
+  void flush();
+
+private:
+  Stream* _log;  /*!< The log the transcript is read from, NULL if not replaying. */
+  uint8_t _speedUp;  /*!< The factor by which the timing is shortened, 0 for no delays. */
+
+  bool _recordWrite;  /*!< `true` if the current record holds bytes written to the device. */
+  uint8_t _recordRemaining;  /*!< The number of data bytes of the current record not yet replayed. */
+  uint32_t _recordTime;  /*!< The recorded time of the current record. */
+  uint32_t _anchorTime;  /*!< The recorded time the timing is anchored to, that of a write record. */
+  uint32_t _anchorTS;  /*!< The timestamp at which that record was replayed. */
+
+  bool _finished;  /*!< `true` once the end of the transcript has been reached. */
+  uint32_t _mismatches;  /*!< The number of bytes written which differ from the recording. */
+
+  bool nextRecord();
+
+  uint32_t timeUntilDue();
+};
+
+#endif // SODAQ_WIFI_BEE_TRANSCRIPT_H_